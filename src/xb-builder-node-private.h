@@ -24,10 +24,12 @@ GPtrArray *
 xb_builder_node_get_attrs(XbBuilderNode *self);
 guint32
 xb_builder_node_size(XbBuilderNode *self);
-guint32
+gboolean
+xb_builder_node_has_visible_children(XbBuilderNode *self);
+guint64
 xb_builder_node_get_offset(XbBuilderNode *self);
 void
-xb_builder_node_set_offset(XbBuilderNode *self, guint32 offset);
+xb_builder_node_set_offset(XbBuilderNode *self, guint64 offset);
 gint
 xb_builder_node_get_priority(XbBuilderNode *self);
 void
@@ -17,7 +17,7 @@
 #include "xb-string-private.h"
 
 typedef struct {
-	guint32 offset;
+	guint64 offset;
 	gint priority;
 	XbBuilderNodeFlags flags;
 	gchar *element;
@@ -828,7 +828,7 @@ xb_builder_node_sort_children(XbBuilderNode *self, XbBuilderNodeSortFunc func, g
 }
 
 /* private */
-guint32
+guint64
 xb_builder_node_get_offset(XbBuilderNode *self)
 {
 	XbBuilderNodePrivate *priv = GET_PRIVATE(self);
@@ -838,7 +838,7 @@ xb_builder_node_get_offset(XbBuilderNode *self)
 
 /* private */
 void
-xb_builder_node_set_offset(XbBuilderNode *self, guint32 offset)
+xb_builder_node_set_offset(XbBuilderNode *self, guint64 offset)
 {
 	XbBuilderNodePrivate *priv = GET_PRIVATE(self);
 	g_return_if_fail(XB_IS_BUILDER_NODE(self));
@@ -917,6 +917,19 @@ xb_builder_node_set_tail_idx(XbBuilderNode *self, guint32 tail_idx)
 	priv->tail_idx = tail_idx;
 }
 
+/* private */
+gboolean
+xb_builder_node_has_visible_children(XbBuilderNode *self)
+{
+	XbBuilderNodePrivate *priv = GET_PRIVATE(self);
+	for (guint i = 0; priv->children != NULL && i < priv->children->len; i++) {
+		XbBuilderNode *c = g_ptr_array_index(priv->children, i);
+		if (!xb_builder_node_has_flag(c, XB_BUILDER_NODE_FLAG_IGNORE))
+			return TRUE;
+	}
+	return FALSE;
+}
+
 /* private */
 guint32
 xb_builder_node_size(XbBuilderNode *self)
@@ -37,6 +37,8 @@ struct _XbBuilderNodeClass {
  * @XB_BUILDER_NODE_FLAG_TOKENIZE_TEXT:		Tokenize and fold text to ASCII (Since: 0.3.1)
  * @XB_BUILDER_NODE_FLAG_STRIP_TEXT:		Strip leading and trailing spaces from text (Since:
  *0.3.4)
+ * @XB_BUILDER_NODE_FLAG_TRIGRAM_INDEX:		Index the text and attribute values for contains()
+ *(Since: 0.3.12)
  *
  * The flags used when building a node.
  **/
@@ -48,6 +50,7 @@ typedef enum {
 	XB_BUILDER_NODE_FLAG_HAS_TAIL = 1 << 3,	     /* Since: 0.1.12 */
 	XB_BUILDER_NODE_FLAG_TOKENIZE_TEXT = 1 << 4, /* Since: 0.3.1 */
 	XB_BUILDER_NODE_FLAG_STRIP_TEXT = 1 << 5,    /* Since: 0.3.4 */
+	XB_BUILDER_NODE_FLAG_TRIGRAM_INDEX = 1 << 6, /* Since: 0.3.12 */
 	/*< private >*/
 	XB_BUILDER_NODE_FLAG_LAST
 } XbBuilderNodeFlags;
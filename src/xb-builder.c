@@ -16,6 +16,7 @@
 #include "xb-builder-fixup-private.h"
 #include "xb-builder-node-private.h"
 #include "xb-builder-source-private.h"
+#include "xb-common-private.h"
 #include "xb-opcode-private.h"
 #include "xb-silo-private.h"
 #include "xb-string-private.h"
@@ -44,6 +45,8 @@ typedef struct {
 	GHashTable *strtab_hash;
 	GString *strtab;
 	GPtrArray *locales;
+	GArray *trigrams_strs; /* of guint32 text or attr value index, transfer none */
+	gsize nodetabsz;
 } XbBuilderCompileHelper;
 
 static guint32
@@ -353,6 +356,8 @@ xb_builder_strtab_attr_value_cb(XbBuilderNode *bn, gpointer user_data)
 	for (guint i = 0; attrs != NULL && i < attrs->len; i++) {
 		XbBuilderNodeAttr *attr = g_ptr_array_index(attrs, i);
 		attr->value_idx = xb_builder_compile_add_to_strtab(helper, attr->value);
+		if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_TRIGRAM_INDEX))
+			g_array_append_val(helper->trigrams_strs, attr->value_idx);
 	}
 	return FALSE;
 }
@@ -369,8 +374,14 @@ xb_builder_strtab_text_cb(XbBuilderNode *bn, gpointer user_data)
 	if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE))
 		return FALSE;
 	if (xb_builder_node_get_text(bn) != NULL) {
+		guint32 idx;
 		tmp = xb_builder_node_get_text(bn);
-		xb_builder_node_set_text_idx(bn, xb_builder_compile_add_to_strtab(helper, tmp));
+		idx = xb_builder_compile_add_to_strtab(helper, tmp);
+		xb_builder_node_set_text_idx(bn, idx);
+
+		/* collected here to save walking the tree again */
+		if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_TRIGRAM_INDEX))
+			g_array_append_val(helper->trigrams_strs, idx);
 	}
 	if (xb_builder_node_get_tail(bn) != NULL) {
 		tmp = xb_builder_node_get_tail(bn);
@@ -401,6 +412,165 @@ xb_builder_strtab_tokens_cb(XbBuilderNode *bn, gpointer user_data)
 	return FALSE;
 }
 
+/* the folded strings are added to the strtab too, and so are also folded */
+static void
+xb_builder_strtab_casefold(XbBuilderCompileHelper *helper, GArray *lower, GArray *upper)
+{
+	for (guint32 idx = 0; idx < helper->strtab->len;) {
+		g_autofree gchar *str = g_strdup(helper->strtab->str + idx);
+		g_autofree gchar *str_lower = g_utf8_strdown(str, -1);
+		g_autofree gchar *str_upper = g_utf8_strup(str, -1);
+
+		if (g_strcmp0(str, str_lower) != 0) {
+			XbSiloStrtabFold fold = {
+			    .idx = idx,
+			    .idx_folded = xb_builder_compile_add_to_strtab(helper, str_lower),
+			};
+			g_array_append_val(lower, fold);
+		}
+		if (g_strcmp0(str, str_upper) != 0) {
+			XbSiloStrtabFold fold = {
+			    .idx = idx,
+			    .idx_folded = xb_builder_compile_add_to_strtab(helper, str_upper),
+			};
+			g_array_append_val(upper, fold);
+		}
+		idx += strlen(str) + 1;
+	}
+}
+
+static void
+xb_builder_strtab_numeric(XbBuilderCompileHelper *helper, GArray *numeric)
+{
+	for (guint32 idx = 0; idx < helper->strtab->len;) {
+		const gchar *str = helper->strtab->str + idx;
+		guint64 val = 0;
+
+		if (g_ascii_string_to_unsigned(str, 10, 0, G_MAXUINT64, &val, NULL)) {
+			XbSiloStrtabNumeric number = {
+			    .idx = idx,
+			    .val = val,
+			};
+			g_array_append_val(numeric, number);
+		}
+		idx += strlen(str) + 1;
+	}
+}
+
+static void
+xb_builder_strtab_version_keys(XbBuilderCompileHelper *helper, GArray *keys)
+{
+	for (guint32 idx = 0; idx < helper->strtab->len;) {
+		const gchar *str = helper->strtab->str + idx;
+		guint64 key = 0;
+
+		if (xb_string_version_key(str, &key)) {
+			XbSiloStrtabNumeric version = {
+			    .idx = idx,
+			    .val = key,
+			};
+			g_array_append_val(keys, version);
+		}
+		idx += strlen(str) + 1;
+	}
+}
+
+typedef struct {
+	XbBuilderCompileHelper *helper;
+	GArray *stems; /* of XbSiloStrtabStem */
+} XbBuilderStemHelper;
+
+static gboolean
+xb_builder_strtab_stem_cb(XbBuilderNode *bn, gpointer user_data)
+{
+	XbBuilderStemHelper *helper = (XbBuilderStemHelper *)user_data;
+	const gchar *lang;
+	const gchar *text;
+	g_autofree gchar *text_stem = NULL;
+	XbSiloStrtabStem stem = {
+	    .lang = XB_SILO_UNSET,
+	};
+
+	/* root node */
+	if (xb_builder_node_get_element(bn) == NULL)
+		return FALSE;
+	if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE))
+		return FALSE;
+	text = xb_builder_node_get_text(bn);
+	if (text == NULL)
+		return FALSE;
+
+	/* the stem depends on the language of the node */
+	lang = xb_builder_node_get_attr(bn, "xml:lang");
+	if (lang != NULL)
+		stem.lang = xb_builder_compile_add_to_strtab(helper->helper, lang);
+	text_stem = xb_string_stem(text, lang);
+	stem.idx = xb_builder_node_get_text_idx(bn);
+	stem.idx_stem = xb_builder_compile_add_to_strtab(helper->helper, text_stem);
+	g_array_append_val(helper->stems, stem);
+	return FALSE;
+}
+
+static gint
+xb_builder_strtab_stem_cmp(gconstpointer a, gconstpointer b)
+{
+	const XbSiloStrtabStem *stem1 = a;
+	const XbSiloStrtabStem *stem2 = b;
+	if (stem1->idx != stem2->idx)
+		return stem1->idx < stem2->idx ? -1 : 1;
+	if (stem1->lang != stem2->lang)
+		return stem1->lang < stem2->lang ? -1 : 1;
+	return 0;
+}
+
+/* the same text is often used by many nodes, so only one is kept */
+static void
+xb_builder_strtab_stem(XbBuilderCompileHelper *helper, GArray *stems)
+{
+	XbBuilderStemHelper stem_helper = {
+	    .helper = helper,
+	    .stems = stems,
+	};
+	XbSiloStrtabStem *stem_prev = NULL;
+	guint len = 0;
+
+	xb_builder_node_traverse(helper->root,
+				 G_PRE_ORDER,
+				 G_TRAVERSE_ALL,
+				 -1,
+				 xb_builder_strtab_stem_cb,
+				 &stem_helper);
+	g_array_sort(stems, xb_builder_strtab_stem_cmp);
+	for (guint i = 0; i < stems->len; i++) {
+		XbSiloStrtabStem *stem = &g_array_index(stems, XbSiloStrtabStem, i);
+		if (stem_prev != NULL && xb_builder_strtab_stem_cmp(stem, stem_prev) == 0)
+			continue;
+		stem_prev = &g_array_index(stems, XbSiloStrtabStem, len++);
+		*stem_prev = *stem;
+	}
+	g_array_set_size(stems, len);
+}
+
+static gint
+xb_builder_strtab_sorted_cmp(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	XbBuilderCompileHelper *helper = (XbBuilderCompileHelper *)user_data;
+	guint32 idx1 = *((const guint32 *)a);
+	guint32 idx2 = *((const guint32 *)b);
+	return strcmp(helper->strtab->str + idx1, helper->strtab->str + idx2);
+}
+
+/* the strtab is deduplicated, so every string appears exactly once */
+static void
+xb_builder_strtab_sorted(XbBuilderCompileHelper *helper, GArray *sorted)
+{
+	for (guint32 idx = 0; idx < helper->strtab->len;) {
+		g_array_append_val(sorted, idx);
+		idx += strlen(helper->strtab->str + idx) + 1;
+	}
+	g_array_sort_with_data(sorted, xb_builder_strtab_sorted_cmp, helper);
+}
+
 static gboolean
 xb_builder_xml_lang_prio_cb(XbBuilderNode *bn, gpointer user_data)
 {
@@ -454,19 +624,39 @@ xb_builder_xml_lang_prio_cb(XbBuilderNode *bn, gpointer user_data)
 static gboolean
 xb_builder_nodetab_size_cb(XbBuilderNode *bn, gpointer user_data)
 {
-	guint32 *sz = (guint32 *)user_data;
+	XbBuilderCompileHelper *helper = (XbBuilderCompileHelper *)user_data;
+	XbBuilderCompileFlags flags = helper->compile_flags;
 
 	/* root node */
 	if (xb_builder_node_get_element(bn) == NULL)
 		return FALSE;
 	if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE))
 		return FALSE;
-	*sz += xb_builder_node_size(bn) + 1; /* +1 for the sentinel */
+
+	/* the same as written by xb_builder_nodetab_write_node() */
+	if (flags & XB_BUILDER_COMPILE_FLAG_SPLIT_LAYOUT)
+		helper->nodetabsz += XB_SILO_NODE_SPLIT_SIZE;
+	else
+		helper->nodetabsz += xb_builder_node_size(bn);
+	if ((flags & XB_BUILDER_COMPILE_FLAG_BLOOM) && xb_builder_node_has_visible_children(bn))
+		helper->nodetabsz += sizeof(guint64);
+	if (flags & XB_BUILDER_COMPILE_FLAG_WIDE_OFFSETS)
+		helper->nodetabsz += 2 * sizeof(guint32);
+	helper->nodetabsz += 1; /* for the sentinel */
 	return FALSE;
 }
 
 typedef struct {
 	GString *buf;
+	gboolean wide;
+	gboolean bloom;
+	GArray *text;	    /* of guint32, ONLY when split */
+	GArray *tail;	    /* of guint32, ONLY when split */
+	GArray *attrs_idx;  /* of guint32, ONLY when split */
+	GArray *tokens_idx; /* of guint32, ONLY when split */
+	GArray *attrs;	    /* of XbSiloNodeAttr, ONLY when split */
+	GArray *tokens;	    /* of guint32, ONLY when split */
+	GArray *subtrees;   /* of XbSiloSubtree, ONLY when storing the subtree end */
 } XbBuilderNodetabHelper;
 
 static void
@@ -477,7 +667,61 @@ xb_builder_nodetab_write_sentinel(XbBuilderNodetabHelper *helper)
 	    .attr_count = 0,
 	};
 	//	g_debug ("SENT @%u", (guint) helper->buf->len);
-	XB_SILO_APPENDBUF(helper->buf, &sn, xb_silo_node_get_size(&sn));
+	XB_SILO_APPENDBUF(helper->buf, &sn, xb_silo_node_get_size(&sn, FALSE));
+}
+
+static void
+xb_builder_nodetab_write_node_extra(XbBuilderNodetabHelper *helper, XbSiloNode *sn)
+{
+	/* add placeholder bloom */
+	if (xb_silo_node_has_flag(sn, XB_SILO_NODE_FLAG_HAS_BLOOM)) {
+		guint64 bloom = 0;
+		XB_SILO_APPENDBUF(helper->buf, &bloom, sizeof(bloom));
+	}
+
+	/* add placeholder ->parent and ->next high bits */
+	if (helper->wide) {
+		guint32 hi[2] = {0x0};
+		XB_SILO_APPENDBUF(helper->buf, hi, sizeof(hi));
+	}
+}
+
+static void
+xb_builder_nodetab_write_node_split(XbBuilderNodetabHelper *helper,
+				    XbBuilderNode *bn,
+				    XbSiloNode *sn)
+{
+	GPtrArray *attrs = xb_builder_node_get_attrs(bn);
+	GArray *token_idxs = xb_builder_node_get_token_idxs(bn);
+	guint32 attrs_idx = helper->attrs->len;
+	guint32 tokens_idx = helper->tokens->len;
+
+	/* the cold data is indexed by node */
+	g_array_append_val(helper->text, sn->text);
+	g_array_append_val(helper->tail, sn->tail);
+	g_array_append_val(helper->attrs_idx, attrs_idx);
+	g_array_append_val(helper->tokens_idx, tokens_idx);
+	xb_silo_node_add_flag(sn, XB_SILO_NODE_FLAG_IS_SPLIT);
+	sn->text = helper->text->len - 1;
+	sn->tail = XB_SILO_UNSET;
+
+	/* add to the buf */
+	XB_SILO_APPENDBUF(helper->buf, sn, XB_SILO_NODE_SPLIT_SIZE);
+
+	/* add to the cold sections */
+	for (guint i = 0; attrs != NULL && i < attrs->len; i++) {
+		XbBuilderNodeAttr *ba = g_ptr_array_index(attrs, i);
+		XbSiloNodeAttr attr = {
+		    .attr_name = ba->name_idx,
+		    .attr_value = ba->value_idx,
+		};
+		g_array_append_val(helper->attrs, attr);
+	}
+	for (guint i = 0; i < sn->token_count; i++) {
+		guint32 idx = g_array_index(token_idxs, guint32, i);
+		g_array_append_val(helper->tokens, idx);
+	}
+	xb_builder_nodetab_write_node_extra(helper, sn);
 }
 
 static void
@@ -498,7 +742,11 @@ xb_builder_nodetab_write_node(XbBuilderNodetabHelper *helper, XbBuilderNode *bn)
 
 	/* add tokens */
 	if (token_idxs != NULL)
-		sn.flags |= XB_SILO_NODE_FLAG_IS_TOKENIZED;
+		xb_silo_node_add_flag(&sn, XB_SILO_NODE_FLAG_IS_TOKENIZED);
+
+	/* the bloom filter is filled in when all the children are written */
+	if (helper->bloom && xb_builder_node_has_visible_children(bn))
+		xb_silo_node_add_flag(&sn, XB_SILO_NODE_FLAG_HAS_BLOOM);
 
 	/* if the node had no children and the text is just whitespace then
 	 * remove it even in literal mode */
@@ -519,6 +767,12 @@ xb_builder_nodetab_write_node(XbBuilderNodetabHelper *helper, XbBuilderNode *bn)
 	if (token_idxs != NULL)
 		sn.token_count = MIN(token_idxs->len, XB_OPCODE_TOKEN_MAX);
 
+	/* only the navigation data goes into the nodetab */
+	if (helper->text != NULL) {
+		xb_builder_nodetab_write_node_split(helper, bn, &sn);
+		return;
+	}
+
 	/* add to the buf */
 	XB_SILO_APPENDBUF(helper->buf, &sn, sizeof(XbSiloNode));
 
@@ -537,16 +791,26 @@ xb_builder_nodetab_write_node(XbBuilderNodetabHelper *helper, XbBuilderNode *bn)
 		guint32 idx = g_array_index(token_idxs, guint32, i);
 		XB_SILO_APPENDBUF(helper->buf, &idx, sizeof(idx));
 	}
+	xb_builder_nodetab_write_node_extra(helper, &sn);
 }
 
-static void
+static XbSiloNode *
+xb_builder_get_node(GString *str, guint64 off)
+{
+	return (XbSiloNode *)(str->str + off);
+}
+
+/* returns the bloom filter of all the element names in the subtree */
+static guint64
 xb_builder_nodetab_write(XbBuilderNodetabHelper *helper, XbBuilderNode *bn)
 {
 	GPtrArray *children;
+	XbBuilderNode *last = NULL;
+	guint64 bloom = 0;
 
 	/* ignore this */
 	if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE))
-		return;
+		return 0;
 
 	/* element */
 	if (xb_builder_node_get_element(bn) != NULL)
@@ -556,18 +820,29 @@ xb_builder_nodetab_write(XbBuilderNodetabHelper *helper, XbBuilderNode *bn)
 	children = xb_builder_node_get_children(bn);
 	for (guint i = 0; i < children->len; i++) {
 		XbBuilderNode *bc = g_ptr_array_index(children, i);
-		xb_builder_nodetab_write(helper, bc);
+		bloom |= xb_builder_nodetab_write(helper, bc);
+		if (xb_builder_node_has_flag(bc, XB_BUILDER_NODE_FLAG_IGNORE))
+			continue;
+		last = bc;
+	}
+
+	/* the subtree of any other child ends where the next sibling starts */
+	if (helper->subtrees != NULL && last != NULL) {
+		XbSiloSubtree subtree = {
+		    .offset = xb_builder_node_get_offset(last),
+		    .end = helper->buf->len,
+		};
+		g_array_append_val(helper->subtrees, subtree);
 	}
 
 	/* sentinel */
-	if (xb_builder_node_get_element(bn) != NULL)
+	if (xb_builder_node_get_element(bn) != NULL) {
+		XbSiloNode *sn = xb_builder_get_node(helper->buf, xb_builder_node_get_offset(bn));
+		xb_silo_node_set_bloom(sn, bloom);
 		xb_builder_nodetab_write_sentinel(helper);
-}
-
-static XbSiloNode *
-xb_builder_get_node(GString *str, guint32 off)
-{
-	return (XbSiloNode *)(str->str + off);
+		bloom |= xb_silo_node_bloom_for_idx(xb_builder_node_get_element_idx(bn));
+	}
+	return bloom;
 }
 
 static gboolean
@@ -592,7 +867,7 @@ xb_builder_nodetab_fix_cb(XbBuilderNode *bn, gpointer user_data)
 
 	/* set the parent if the node has one */
 	if (xb_builder_node_get_element(parent) != NULL)
-		sn->parent = xb_builder_node_get_offset(parent);
+		xb_silo_node_set_parent(sn, xb_builder_node_get_offset(parent), helper->wide);
 
 	/* set ->next if the node has one */
 	siblings = xb_builder_node_get_children(parent);
@@ -605,7 +880,7 @@ xb_builder_nodetab_fix_cb(XbBuilderNode *bn, gpointer user_data)
 		if (!found)
 			continue;
 		if (!xb_builder_node_has_flag(bn2, XB_BUILDER_NODE_FLAG_IGNORE)) {
-			sn->next = xb_builder_node_get_offset(bn2);
+			xb_silo_node_set_next(sn, xb_builder_node_get_offset(bn2), helper->wide);
 			break;
 		}
 	}
@@ -613,6 +888,225 @@ xb_builder_nodetab_fix_cb(XbBuilderNode *bn, gpointer user_data)
 	return FALSE;
 }
 
+typedef struct {
+	GArray *children_idx; /* of XbSiloChildren */
+	GArray *children;     /* of guint64 */
+} XbBuilderChildrenHelper;
+
+static gboolean
+xb_builder_children_cb(XbBuilderNode *bn, gpointer user_data)
+{
+	XbBuilderChildrenHelper *helper = (XbBuilderChildrenHelper *)user_data;
+	GPtrArray *children = xb_builder_node_get_children(bn);
+	XbSiloChildren children_idx = {
+	    .parent = xb_builder_node_get_element(bn) != NULL ? xb_builder_node_get_offset(bn) : 0,
+	    .idx = helper->children->len,
+	};
+
+	if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE))
+		return FALSE;
+	for (guint i = 0; i < children->len; i++) {
+		XbBuilderNode *bc = g_ptr_array_index(children, i);
+		guint64 offset;
+		if (xb_builder_node_get_element(bc) == NULL)
+			continue;
+		if (xb_builder_node_has_flag(bc, XB_BUILDER_NODE_FLAG_IGNORE))
+			continue;
+		offset = xb_builder_node_get_offset(bc);
+		g_array_append_val(helper->children, offset);
+		children_idx.count++;
+	}
+
+	/* pre-order, so already sorted by parent offset */
+	if (children_idx.count > 0)
+		g_array_append_val(helper->children_idx, children_idx);
+	return FALSE;
+}
+
+static gboolean
+xb_builder_elements_cb(XbBuilderNode *bn, gpointer user_data)
+{
+	GHashTable *elements = (GHashTable *)user_data;
+	GArray *offsets;
+	guint32 element_idx;
+	guint64 offset;
+
+	if (xb_builder_node_get_element(bn) == NULL)
+		return FALSE;
+	if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE))
+		return FALSE;
+	element_idx = xb_builder_node_get_element_idx(bn);
+	offsets = g_hash_table_lookup(elements, GUINT_TO_POINTER(element_idx));
+	if (offsets == NULL) {
+		offsets = g_array_new(FALSE, FALSE, sizeof(guint64));
+		g_hash_table_insert(elements, GUINT_TO_POINTER(element_idx), offsets);
+	}
+
+	/* pre-order, so already sorted by offset */
+	offset = xb_builder_node_get_offset(bn);
+	g_array_append_val(offsets, offset);
+	return FALSE;
+}
+
+static gint
+xb_builder_elements_cmp(gconstpointer a, gconstpointer b)
+{
+	guint32 idx1 = GPOINTER_TO_UINT(a);
+	guint32 idx2 = GPOINTER_TO_UINT(b);
+	if (idx1 < idx2)
+		return -1;
+	if (idx1 > idx2)
+		return 1;
+	return 0;
+}
+
+static void
+xb_builder_elements(XbBuilderNode *root, GArray *elements_idx, GArray *elements)
+{
+	g_autoptr(GHashTable) hash = g_hash_table_new_full(g_direct_hash,
+							   g_direct_equal,
+							   NULL,
+							   (GDestroyNotify)g_array_unref);
+	g_autoptr(GList) keys = NULL;
+
+	xb_builder_node_traverse(root,
+				 G_PRE_ORDER,
+				 G_TRAVERSE_ALL,
+				 -1,
+				 xb_builder_elements_cb,
+				 hash);
+	keys = g_list_sort(g_hash_table_get_keys(hash), xb_builder_elements_cmp);
+	for (GList *l = keys; l != NULL; l = l->next) {
+		GArray *offsets = g_hash_table_lookup(hash, l->data);
+		XbSiloElements element = {
+		    .element_name = GPOINTER_TO_UINT(l->data),
+		    .idx = elements->len,
+		    .count = offsets->len,
+		};
+		g_array_append_val(elements_idx, element);
+		g_array_append_vals(elements, offsets->data, offsets->len);
+	}
+}
+
+static gint
+xb_builder_trigrams_strs_cmp(gconstpointer a, gconstpointer b)
+{
+	guint32 idx1 = *((const guint32 *)a);
+	guint32 idx2 = *((const guint32 *)b);
+	if (idx1 < idx2)
+		return -1;
+	if (idx1 > idx2)
+		return 1;
+	return 0;
+}
+
+/* @strs is the text and attr value index of each node with XB_BUILDER_NODE_FLAG_TRIGRAM_INDEX,
+ * and is indexed in strtab order so that each posting list is sorted */
+static void
+xb_builder_trigrams(XbBuilderCompileHelper *helper,
+		    GArray *trigrams_idx,
+		    GArray *trigrams,
+		    GArray *strs)
+{
+	guint len = 0;
+	g_autoptr(GHashTable) hash = g_hash_table_new_full(g_direct_hash,
+							   g_direct_equal,
+							   NULL,
+							   (GDestroyNotify)g_array_unref);
+	g_autoptr(GList) keys = NULL;
+
+	if (strs->len == 0)
+		return;
+	g_array_sort(strs, xb_builder_trigrams_strs_cmp);
+	for (guint i = 0; i < strs->len; i++) {
+		guint32 idx = g_array_index(strs, guint32, i);
+		const guchar *str = (const guchar *)helper->strtab->str + idx;
+
+		/* the same text is often used by many nodes */
+		if (len > 0 && g_array_index(strs, guint32, len - 1) == idx)
+			continue;
+		g_array_index(strs, guint32, len++) = idx;
+
+		/* a trigram can never be zero as the strings have no NUL bytes */
+		for (gsize j = 0; str[j] != '\0' && str[j + 1] != '\0' && str[j + 2] != '\0';
+		     j++) {
+			guint32 trigram = ((guint32)str[j] << 16) | ((guint32)str[j + 1] << 8) |
+					  (guint32)str[j + 2];
+			GArray *postings = g_hash_table_lookup(hash, GUINT_TO_POINTER(trigram));
+			if (postings == NULL) {
+				postings = g_array_new(FALSE, FALSE, sizeof(guint32));
+				g_hash_table_insert(hash, GUINT_TO_POINTER(trigram), postings);
+			}
+			if (postings->len > 0 && g_array_index(postings, guint32, postings->len - 1) == idx)
+				continue;
+			g_array_append_val(postings, idx);
+		}
+	}
+	g_array_set_size(strs, len);
+
+	keys = g_list_sort(g_hash_table_get_keys(hash), xb_builder_elements_cmp);
+	for (GList *l = keys; l != NULL; l = l->next) {
+		GArray *postings = g_hash_table_lookup(hash, l->data);
+		XbSiloTrigrams trigram = {
+		    .trigram = GPOINTER_TO_UINT(l->data),
+		    .idx = trigrams->len,
+		    .count = postings->len,
+		};
+		g_array_append_val(trigrams_idx, trigram);
+		g_array_append_vals(trigrams, postings->data, postings->len);
+	}
+}
+
+/* the subtrees are added when they are closed, so deeper nodes come first */
+static gint
+xb_builder_subtrees_cmp(gconstpointer a, gconstpointer b)
+{
+	const XbSiloSubtree *subtree1 = a;
+	const XbSiloSubtree *subtree2 = b;
+	if (subtree1->offset < subtree2->offset)
+		return -1;
+	if (subtree1->offset > subtree2->offset)
+		return 1;
+	return 0;
+}
+
+static void
+xb_builder_nodetab_helper_clear(XbBuilderNodetabHelper *helper)
+{
+	g_clear_pointer(&helper->text, g_array_unref);
+	g_clear_pointer(&helper->tail, g_array_unref);
+	g_clear_pointer(&helper->attrs_idx, g_array_unref);
+	g_clear_pointer(&helper->tokens_idx, g_array_unref);
+	g_clear_pointer(&helper->attrs, g_array_unref);
+	g_clear_pointer(&helper->tokens, g_array_unref);
+	g_clear_pointer(&helper->subtrees, g_array_unref);
+}
+
+G_DEFINE_AUTO_CLEANUP_CLEAR_FUNC(XbBuilderNodetabHelper, xb_builder_nodetab_helper_clear)
+
+/* sections are aligned so that the arrays can be used in-place */
+static void
+xb_builder_append_section(GString *buf,
+			  gsize hdrsz,
+			  guint8 idx,
+			  XbSiloSectionKind kind,
+			  gconstpointer data,
+			  gsize size)
+{
+	XbSiloSection sect = {
+	    .kind = kind,
+	    .size = size,
+	};
+	while (buf->len % 8 != 0)
+		g_string_append_c(buf, '\0');
+	sect.offset = buf->len;
+	if (size > 0)
+		XB_SILO_APPENDBUF(buf, data, size);
+	memcpy(buf->str + hdrsz + idx * sizeof(XbSiloSection),
+	       &sect,
+	       sizeof(sect));
+}
+
 static void
 xb_builder_compile_helper_free(XbBuilderCompileHelper *helper)
 {
@@ -751,7 +1245,21 @@ xb_builder_compile(XbBuilder *self,
 		   GError **error)
 {
 	XbBuilderPrivate *priv = GET_PRIVATE(self);
-	guint32 nodetabsz = sizeof(XbSiloHeader);
+	gsize hdrsz = sizeof(XbSiloHeader);
+	guint8 sect_idx = 0;
+	g_autoptr(GArray) strtab_lower = NULL;
+	g_autoptr(GArray) strtab_upper = NULL;
+	g_autoptr(GArray) strtab_sorted = NULL;
+	g_autoptr(GArray) strtab_numeric = NULL;
+	g_autoptr(GArray) strtab_versions = NULL;
+	g_autoptr(GArray) strtab_stems = NULL;
+	g_autoptr(GArray) trigrams_idx = g_array_new(FALSE, FALSE, sizeof(XbSiloTrigrams));
+	g_autoptr(GArray) trigrams = g_array_new(FALSE, FALSE, sizeof(guint32));
+	g_autoptr(GArray) trigrams_strs = g_array_new(FALSE, FALSE, sizeof(guint32));
+	g_autoptr(GArray) children_idx = NULL;
+	g_autoptr(GArray) children = NULL;
+	g_autoptr(GArray) elements_idx = NULL;
+	g_autoptr(GArray) elements = NULL;
 	g_autoptr(GBytes) blob = NULL;
 	g_autoptr(GString) buf = NULL;
 	XbSiloHeader hdr = {
@@ -759,10 +1267,11 @@ xb_builder_compile(XbBuilder *self,
 	    .version = XB_SILO_VERSION,
 	    .strtab = 0,
 	    .strtab_ntags = 0,
+	    .nsections = 0,
 	    .padding = {0x0},
 	    .guid = {0x0},
 	};
-	XbBuilderNodetabHelper nodetab_helper = {
+	g_auto(XbBuilderNodetabHelper) nodetab_helper = {
 	    .buf = NULL,
 	};
 	g_autoptr(GPtrArray) nodes_to_destroy = g_ptr_array_new_with_free_func((GDestroyNotify)g_object_unref);
@@ -794,6 +1303,10 @@ xb_builder_compile(XbBuilder *self,
 	helper->locales = priv->locales;
 	helper->strtab = g_string_new(NULL);
 	helper->strtab_hash = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	helper->trigrams_strs = trigrams_strs;
+	helper->nodetabsz = sizeof(XbSiloHeader);
+	if (flags & XB_BUILDER_COMPILE_FLAG_WIDE_OFFSETS)
+		helper->nodetabsz = sizeof(XbSiloHeaderWide);
 
 	/* build node tree */
 	for (guint i = 0; i < priv->sources->len; i++) {
@@ -868,8 +1381,8 @@ xb_builder_compile(XbBuilder *self,
 				 G_TRAVERSE_ALL,
 				 -1,
 				 xb_builder_nodetab_size_cb,
-				 &nodetabsz);
-	buf = g_string_sized_new(nodetabsz);
+				 helper);
+	buf = g_string_sized_new(helper->nodetabsz);
 	xb_silo_add_profile(priv->silo, timer, "get size nodetab");
 
 	/* add everything to the strtab */
@@ -909,9 +1422,85 @@ xb_builder_compile(XbBuilder *self,
 				 xb_builder_strtab_tokens_cb,
 				 helper);
 	xb_silo_add_profile(priv->silo, timer, "adding strtab tokens");
+	if (flags & XB_BUILDER_COMPILE_FLAG_STEM) {
+		strtab_stems = g_array_new(FALSE, FALSE, sizeof(XbSiloStrtabStem));
+		xb_builder_strtab_stem(helper, strtab_stems);
+		hdr.nsections += 1;
+		xb_silo_add_profile(priv->silo, timer, "adding strtab stems");
+	}
 
-	/* add the initial header */
-	hdr.strtab = nodetabsz;
+	/* only the text of the nodes that were selected is indexed */
+	xb_builder_trigrams(helper, trigrams_idx, trigrams, trigrams_strs);
+	if (trigrams_strs->len > 0) {
+		hdr.nsections += 3;
+		xb_silo_add_profile(priv->silo, timer, "indexing trigrams");
+	}
+	if (flags & XB_BUILDER_COMPILE_FLAG_CASEFOLD) {
+		strtab_lower = g_array_new(FALSE, FALSE, sizeof(XbSiloStrtabFold));
+		strtab_upper = g_array_new(FALSE, FALSE, sizeof(XbSiloStrtabFold));
+		xb_builder_strtab_casefold(helper, strtab_lower, strtab_upper);
+		hdr.nsections += 2;
+		xb_silo_add_profile(priv->silo, timer, "adding strtab casefold");
+	}
+	if (flags & XB_BUILDER_COMPILE_FLAG_STRTAB_INDEX) {
+		strtab_sorted = g_array_new(FALSE, FALSE, sizeof(guint32));
+		xb_builder_strtab_sorted(helper, strtab_sorted);
+		hdr.nsections += 1;
+		xb_silo_add_profile(priv->silo, timer, "sorting strtab");
+	}
+	if (flags & XB_BUILDER_COMPILE_FLAG_NUMERIC) {
+		strtab_numeric = g_array_new(FALSE, FALSE, sizeof(XbSiloStrtabNumeric));
+		xb_builder_strtab_numeric(helper, strtab_numeric);
+		hdr.nsections += 1;
+		xb_silo_add_profile(priv->silo, timer, "parsing strtab numbers");
+	}
+	if (flags & XB_BUILDER_COMPILE_FLAG_VERSION_KEYS) {
+		strtab_versions = g_array_new(FALSE, FALSE, sizeof(XbSiloStrtabNumeric));
+		xb_builder_strtab_version_keys(helper, strtab_versions);
+		hdr.nsections += 1;
+		xb_silo_add_profile(priv->silo, timer, "parsing strtab versions");
+	}
+
+	/* offsets into the strtab are always 32 bit */
+	if (helper->strtab->len > G_MAXUINT32) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "strtab is too large");
+		return NULL;
+	}
+
+	/* the header is followed by the 64 bit strtab offset */
+	if (flags & XB_BUILDER_COMPILE_FLAG_WIDE_OFFSETS) {
+		hdr.version = XB_SILO_VERSION_WIDE;
+		hdrsz = sizeof(XbSiloHeaderWide);
+		nodetab_helper.wide = TRUE;
+	}
+
+	/* the bloom filters are filled in when all the children are written */
+	if (flags & XB_BUILDER_COMPILE_FLAG_BLOOM)
+		nodetab_helper.bloom = TRUE;
+
+	/* the cold data is written to sections after the nodetab */
+	if (flags & XB_BUILDER_COMPILE_FLAG_SPLIT_LAYOUT) {
+		nodetab_helper.text = g_array_new(FALSE, FALSE, sizeof(guint32));
+		nodetab_helper.tail = g_array_new(FALSE, FALSE, sizeof(guint32));
+		nodetab_helper.attrs_idx = g_array_new(FALSE, FALSE, sizeof(guint32));
+		nodetab_helper.tokens_idx = g_array_new(FALSE, FALSE, sizeof(guint32));
+		nodetab_helper.attrs = g_array_new(FALSE, FALSE, sizeof(XbSiloNodeAttr));
+		nodetab_helper.tokens = g_array_new(FALSE, FALSE, sizeof(guint32));
+		hdr.nsections += 6;
+	}
+	if (flags & XB_BUILDER_COMPILE_FLAG_CHILD_INDEX)
+		hdr.nsections += 2;
+	if (flags & XB_BUILDER_COMPILE_FLAG_ELEMENT_INDEX)
+		hdr.nsections += 2;
+	if (flags & XB_BUILDER_COMPILE_FLAG_SUBTREE_END) {
+		nodetab_helper.subtrees = g_array_new(FALSE, FALSE, sizeof(XbSiloSubtree));
+		hdr.nsections += 1;
+	}
+
+	/* add the initial header, and a placeholder for the section directory */
 	if (priv->guid->len > 0) {
 		XbGuid guid_tmp;
 		xb_guid_compute_for_data(&guid_tmp,
@@ -920,6 +1509,14 @@ xb_builder_compile(XbBuilder *self,
 		memcpy(&hdr.guid, &guid_tmp, sizeof(guid_tmp));
 	}
 	XB_SILO_APPENDBUF(buf, &hdr, sizeof(XbSiloHeader));
+	if (nodetab_helper.wide) {
+		guint64 strtab = 0;
+		XB_SILO_APPENDBUF(buf, &strtab, sizeof(strtab));
+	}
+	for (guint8 i = 0; i < hdr.nsections; i++) {
+		XbSiloSection sect = {.kind = XB_SILO_SECTION_KIND_UNKNOWN};
+		XB_SILO_APPENDBUF(buf, &sect, sizeof(sect));
+	}
 
 	/* write nodes to the nodetab */
 	nodetab_helper.buf = buf;
@@ -935,7 +1532,203 @@ xb_builder_compile(XbBuilder *self,
 				 &nodetab_helper);
 	xb_silo_add_profile(priv->silo, timer, "fixing ->parent and ->next");
 
+	/* list the children of each node so they can be walked from the end */
+	if (flags & XB_BUILDER_COMPILE_FLAG_CHILD_INDEX) {
+		XbBuilderChildrenHelper children_helper = {
+		    .children_idx = g_array_new(FALSE, FALSE, sizeof(XbSiloChildren)),
+		    .children = g_array_new(FALSE, FALSE, sizeof(guint64)),
+		};
+		xb_builder_node_traverse(helper->root,
+					 G_PRE_ORDER,
+					 G_TRAVERSE_ALL,
+					 -1,
+					 xb_builder_children_cb,
+					 &children_helper);
+		children_idx = children_helper.children_idx;
+		children = children_helper.children;
+		xb_silo_add_profile(priv->silo, timer, "listing children");
+	}
+
+	/* list the nodes with each element name so they can be found at any depth */
+	if (flags & XB_BUILDER_COMPILE_FLAG_ELEMENT_INDEX) {
+		elements_idx = g_array_new(FALSE, FALSE, sizeof(XbSiloElements));
+		elements = g_array_new(FALSE, FALSE, sizeof(guint64));
+		xb_builder_elements(helper->root, elements_idx, elements);
+		xb_silo_add_profile(priv->silo, timer, "listing elements");
+	}
+
+	/* append the cold sections */
+	if (flags & XB_BUILDER_COMPILE_FLAG_SPLIT_LAYOUT) {
+		xb_builder_append_section(buf,
+					  hdrsz,
+					  sect_idx++,
+					  XB_SILO_SECTION_KIND_NODE_TEXT,
+					  nodetab_helper.text->data,
+					  nodetab_helper.text->len * sizeof(guint32));
+		xb_builder_append_section(buf,
+					  hdrsz,
+					  sect_idx++,
+					  XB_SILO_SECTION_KIND_NODE_TAIL,
+					  nodetab_helper.tail->data,
+					  nodetab_helper.tail->len * sizeof(guint32));
+		xb_builder_append_section(buf,
+					  hdrsz,
+					  sect_idx++,
+					  XB_SILO_SECTION_KIND_NODE_ATTRS,
+					  nodetab_helper.attrs_idx->data,
+					  nodetab_helper.attrs_idx->len * sizeof(guint32));
+		xb_builder_append_section(buf,
+					  hdrsz,
+					  sect_idx++,
+					  XB_SILO_SECTION_KIND_NODE_TOKENS,
+					  nodetab_helper.tokens_idx->data,
+					  nodetab_helper.tokens_idx->len * sizeof(guint32));
+		xb_builder_append_section(buf,
+					  hdrsz,
+					  sect_idx++,
+					  XB_SILO_SECTION_KIND_ATTRS,
+					  nodetab_helper.attrs->data,
+					  nodetab_helper.attrs->len * sizeof(XbSiloNodeAttr));
+		xb_builder_append_section(buf,
+					  hdrsz,
+					  sect_idx++,
+					  XB_SILO_SECTION_KIND_TOKENS,
+					  nodetab_helper.tokens->data,
+					  nodetab_helper.tokens->len * sizeof(guint32));
+		xb_silo_add_profile(priv->silo, timer, "appending sections");
+	}
+	if (flags & XB_BUILDER_COMPILE_FLAG_CASEFOLD) {
+		xb_builder_append_section(buf,
+					  hdrsz,
+					  sect_idx++,
+					  XB_SILO_SECTION_KIND_STRTAB_LOWER,
+					  strtab_lower->data,
+					  strtab_lower->len * sizeof(XbSiloStrtabFold));
+		xb_builder_append_section(buf,
+					  hdrsz,
+					  sect_idx++,
+					  XB_SILO_SECTION_KIND_STRTAB_UPPER,
+					  strtab_upper->data,
+					  strtab_upper->len * sizeof(XbSiloStrtabFold));
+		xb_silo_add_profile(priv->silo, timer, "appending casefold sections");
+	}
+	if (flags & XB_BUILDER_COMPILE_FLAG_STEM) {
+		xb_builder_append_section(buf,
+					  hdrsz,
+					  sect_idx++,
+					  XB_SILO_SECTION_KIND_STRTAB_STEM,
+					  strtab_stems->data,
+					  strtab_stems->len * sizeof(XbSiloStrtabStem));
+		xb_silo_add_profile(priv->silo, timer, "appending stem strtab section");
+	}
+	if (trigrams_strs->len > 0) {
+		xb_builder_append_section(buf,
+					  hdrsz,
+					  sect_idx++,
+					  XB_SILO_SECTION_KIND_TRIGRAMS_IDX,
+					  trigrams_idx->data,
+					  trigrams_idx->len * sizeof(XbSiloTrigrams));
+		xb_builder_append_section(buf,
+					  hdrsz,
+					  sect_idx++,
+					  XB_SILO_SECTION_KIND_TRIGRAMS,
+					  trigrams->data,
+					  trigrams->len * sizeof(guint32));
+		xb_builder_append_section(buf,
+					  hdrsz,
+					  sect_idx++,
+					  XB_SILO_SECTION_KIND_TRIGRAMS_STRS,
+					  trigrams_strs->data,
+					  trigrams_strs->len * sizeof(guint32));
+		xb_silo_add_profile(priv->silo, timer, "appending trigram sections");
+	}
+	if (flags & XB_BUILDER_COMPILE_FLAG_STRTAB_INDEX) {
+		xb_builder_append_section(buf,
+					  hdrsz,
+					  sect_idx++,
+					  XB_SILO_SECTION_KIND_STRTAB_SORTED,
+					  strtab_sorted->data,
+					  strtab_sorted->len * sizeof(guint32));
+		xb_silo_add_profile(priv->silo, timer, "appending sorted strtab section");
+	}
+	if (flags & XB_BUILDER_COMPILE_FLAG_NUMERIC) {
+		xb_builder_append_section(buf,
+					  hdrsz,
+					  sect_idx++,
+					  XB_SILO_SECTION_KIND_STRTAB_NUMERIC,
+					  strtab_numeric->data,
+					  strtab_numeric->len * sizeof(XbSiloStrtabNumeric));
+		xb_silo_add_profile(priv->silo, timer, "appending numeric strtab section");
+	}
+	if (flags & XB_BUILDER_COMPILE_FLAG_VERSION_KEYS) {
+		xb_builder_append_section(buf,
+					  hdrsz,
+					  sect_idx++,
+					  XB_SILO_SECTION_KIND_STRTAB_VERSION,
+					  strtab_versions->data,
+					  strtab_versions->len * sizeof(XbSiloStrtabNumeric));
+		xb_silo_add_profile(priv->silo, timer, "appending version strtab section");
+	}
+	if (flags & XB_BUILDER_COMPILE_FLAG_CHILD_INDEX) {
+		xb_builder_append_section(buf,
+					  hdrsz,
+					  sect_idx++,
+					  XB_SILO_SECTION_KIND_CHILDREN_IDX,
+					  children_idx->data,
+					  children_idx->len * sizeof(XbSiloChildren));
+		xb_builder_append_section(buf,
+					  hdrsz,
+					  sect_idx++,
+					  XB_SILO_SECTION_KIND_CHILDREN,
+					  children->data,
+					  children->len * sizeof(guint64));
+		xb_silo_add_profile(priv->silo, timer, "appending children sections");
+	}
+	if (flags & XB_BUILDER_COMPILE_FLAG_ELEMENT_INDEX) {
+		xb_builder_append_section(buf,
+					  hdrsz,
+					  sect_idx++,
+					  XB_SILO_SECTION_KIND_ELEMENTS_IDX,
+					  elements_idx->data,
+					  elements_idx->len * sizeof(XbSiloElements));
+		xb_builder_append_section(buf,
+					  hdrsz,
+					  sect_idx++,
+					  XB_SILO_SECTION_KIND_ELEMENTS,
+					  elements->data,
+					  elements->len * sizeof(guint64));
+		xb_silo_add_profile(priv->silo, timer, "appending elements sections");
+	}
+	if (flags & XB_BUILDER_COMPILE_FLAG_SUBTREE_END) {
+		g_array_sort(nodetab_helper.subtrees, xb_builder_subtrees_cmp);
+		xb_builder_append_section(buf,
+					  hdrsz,
+					  sect_idx++,
+					  XB_SILO_SECTION_KIND_SUBTREE_END,
+					  nodetab_helper.subtrees->data,
+					  nodetab_helper.subtrees->len * sizeof(XbSiloSubtree));
+		xb_silo_add_profile(priv->silo, timer, "appending subtree end section");
+	}
+
 	/* append the string table */
+	if (nodetab_helper.wide) {
+		XbSiloHeaderWide hdr_wide = {
+		    .hdr = hdr,
+		    .strtab = buf->len,
+		};
+		memcpy(buf->str, &hdr_wide, sizeof(XbSiloHeaderWide));
+	} else {
+		if (buf->len > G_MAXUINT32) {
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "nodetab is too large, use "
+					    "XB_BUILDER_COMPILE_FLAG_WIDE_OFFSETS");
+			return NULL;
+		}
+		hdr.strtab = buf->len;
+		memcpy(buf->str, &hdr, sizeof(XbSiloHeader));
+	}
 	XB_SILO_APPENDBUF(buf, helper->strtab->str, helper->strtab->len);
 	xb_silo_add_profile(priv->silo, timer, "appending strtab");
 
@@ -40,6 +40,17 @@ struct _XbBuilderClass {
  * @XB_BUILDER_COMPILE_FLAG_WATCH_BLOB:		Watch the XMLB file for changes
  * @XB_BUILDER_COMPILE_FLAG_IGNORE_GUID:	Ignore the cache GUID value
  * @XB_BUILDER_COMPILE_FLAG_SINGLE_ROOT:	Require at most one root node
+ * @XB_BUILDER_COMPILE_FLAG_SPLIT_LAYOUT:	Store node text and attributes away from the tree
+ * @XB_BUILDER_COMPILE_FLAG_WIDE_OFFSETS:	Use 64 bit node offsets for silos over 4GB
+ * @XB_BUILDER_COMPILE_FLAG_CASEFOLD:		Store lower and upper case versions of all strings
+ * @XB_BUILDER_COMPILE_FLAG_STRTAB_INDEX:	Store a sorted index of all strings for queries
+ * @XB_BUILDER_COMPILE_FLAG_NUMERIC:		Store the value of all strings that are numbers
+ * @XB_BUILDER_COMPILE_FLAG_VERSION_KEYS:	Store sortable keys for version strings
+ * @XB_BUILDER_COMPILE_FLAG_CHILD_INDEX:	Store the children of each node for reverse queries
+ * @XB_BUILDER_COMPILE_FLAG_ELEMENT_INDEX:	Store the nodes with each element name
+ * @XB_BUILDER_COMPILE_FLAG_SUBTREE_END:	Store where the subtree of each node ends
+ * @XB_BUILDER_COMPILE_FLAG_STEM:		Store the stem of all node text
+ * @XB_BUILDER_COMPILE_FLAG_BLOOM:		Store a filter of the elements below each node
  *
  * The flags for converting to XML.
  **/
@@ -51,6 +62,17 @@ typedef enum {
 	XB_BUILDER_COMPILE_FLAG_WATCH_BLOB = 1 << 4,	 /* Since: 0.1.0 */
 	XB_BUILDER_COMPILE_FLAG_IGNORE_GUID = 1 << 5,	 /* Since: 0.1.7 */
 	XB_BUILDER_COMPILE_FLAG_SINGLE_ROOT = 1 << 6,	 /* Since: 0.3.4 */
+	XB_BUILDER_COMPILE_FLAG_SPLIT_LAYOUT = 1 << 7,	 /* Since: 0.3.12 */
+	XB_BUILDER_COMPILE_FLAG_WIDE_OFFSETS = 1 << 8,	 /* Since: 0.3.12 */
+	XB_BUILDER_COMPILE_FLAG_CASEFOLD = 1 << 9,	 /* Since: 0.3.12 */
+	XB_BUILDER_COMPILE_FLAG_STRTAB_INDEX = 1 << 10,	 /* Since: 0.3.12 */
+	XB_BUILDER_COMPILE_FLAG_NUMERIC = 1 << 11,	 /* Since: 0.3.12 */
+	XB_BUILDER_COMPILE_FLAG_VERSION_KEYS = 1 << 12,	 /* Since: 0.3.12 */
+	XB_BUILDER_COMPILE_FLAG_CHILD_INDEX = 1 << 13,	 /* Since: 0.3.12 */
+	XB_BUILDER_COMPILE_FLAG_ELEMENT_INDEX = 1 << 14, /* Since: 0.3.12 */
+	XB_BUILDER_COMPILE_FLAG_SUBTREE_END = 1 << 15,	 /* Since: 0.3.12 */
+	XB_BUILDER_COMPILE_FLAG_STEM = 1 << 16,		 /* Since: 0.3.12 */
+	XB_BUILDER_COMPILE_FLAG_BLOOM = 1 << 17,	 /* Since: 0.3.12 */
 	/*< private >*/
 	XB_BUILDER_COMPILE_FLAG_LAST
 } XbBuilderCompileFlags;
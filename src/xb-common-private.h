@@ -16,3 +16,13 @@ xb_file_set_contents(GFile *file,
 		     gsize bufsz,
 		     GCancellable *cancellable,
 		     GError **error);
+
+#if !GLIB_CHECK_VERSION(2, 54, 0)
+gboolean
+g_ascii_string_to_unsigned(const gchar *str,
+			   guint base,
+			   guint64 min,
+			   guint64 max,
+			   guint64 *out_num,
+			   GError **error);
+#endif
@@ -19,4 +19,64 @@ xb_machine_stack_pop_two(XbMachine *self,
 void
 xb_machine_opcode_tokenize(XbMachine *self, XbOpcode *op);
 
+typedef gboolean (*XbMachineOpcodeFusionFunc)(XbMachine *self,
+					      XbStack *stack,
+					      const XbOpcode *opcodes,
+					      gpointer user_data,
+					      gpointer exec_data,
+					      GError **error);
+typedef struct _XbMachineProgram XbMachineProgram;
+
+gboolean
+xb_machine_stack_push_integer64(XbMachine *self, XbStack *stack, guint64 val, GError **error);
+
+void
+xb_machine_add_method_fixed(XbMachine *self,
+			    const gchar *name,
+			    guint n_opcodes,
+			    XbMachineMethodFunc method_cb,
+			    gpointer user_data,
+			    GDestroyNotify user_data_free);
+void
+xb_machine_override_method_fixed(XbMachine *self,
+				 const gchar *name,
+				 guint n_opcodes,
+				 XbMachineMethodFunc method_cb,
+				 gpointer user_data,
+				 GDestroyNotify user_data_free);
+void
+xb_machine_add_opcode_fusion(XbMachine *self,
+			     const gchar *opcodes_sig,
+			     XbMachineOpcodeFusionFunc fusion_cb,
+			     gpointer user_data);
+XbMachineProgram *
+xb_machine_compile(XbMachine *self, XbStack *opcodes);
+gboolean
+xb_machine_run_with_bindings_offset(XbMachine *self,
+				    XbStack *opcodes,
+				    XbValueBindings *bindings,
+				    guint bindings_offset,
+				    gboolean *result,
+				    gpointer exec_data,
+				    GError **error);
+gboolean
+xb_machine_program_run(XbMachine *self,
+		       XbMachineProgram *program,
+		       XbValueBindings *bindings,
+		       guint bindings_offset,
+		       gboolean *result,
+		       gpointer exec_data,
+		       GError **error);
+void
+xb_machine_program_free(XbMachineProgram *program);
+gboolean
+xb_machine_func_contains_cb(XbMachine *self,
+			    XbStack *stack,
+			    gboolean *result,
+			    gpointer user_data,
+			    gpointer exec_data,
+			    GError **error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(XbMachineProgram, xb_machine_program_free)
+
 G_END_DECLS
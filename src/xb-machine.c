@@ -11,15 +11,13 @@
 #include <gio/gio.h>
 #include <string.h>
 
-#if !GLIB_CHECK_VERSION(2, 54, 0)
-#include <errno.h>
-#endif
-
+#include "xb-common-private.h"
 #include "xb-machine-private.h"
 #include "xb-opcode-private.h"
 #include "xb-silo-private.h"
 #include "xb-stack-private.h"
 #include "xb-string-private.h"
+#include "xb-value-bindings-private.h"
 
 typedef struct {
 	XbMachineDebugFlags debug_flags;
@@ -27,6 +25,7 @@ typedef struct {
 	GPtrArray *operators;	   /* of XbMachineOperator */
 	GPtrArray *text_handlers;  /* of XbMachineTextHandlerItem */
 	GHashTable *opcode_fixup;  /* of str[XbMachineOpcodeFixupItem] */
+	GPtrArray *opcode_fusions; /* of XbMachineOpcodeFusionItem */
 	GHashTable *opcode_tokens; /* of utf8 */
 	guint stack_size;
 } XbMachinePrivate;
@@ -46,6 +45,13 @@ typedef struct {
 	GDestroyNotify user_data_free;
 } XbMachineOpcodeFixupItem;
 
+typedef struct {
+	gchar *sig;
+	guint n_opcodes;
+	XbMachineOpcodeFusionFunc fusion_cb;
+	gpointer user_data;
+} XbMachineOpcodeFusionItem;
+
 typedef struct {
 	XbMachineTextHandlerFunc handler_cb;
 	gpointer user_data;
@@ -56,11 +62,36 @@ typedef struct {
 	guint32 idx;
 	gchar *name;
 	guint n_opcodes;
+	gboolean fixed_arity; /* pops exactly @n_opcodes and pushes one result */
 	XbMachineMethodFunc method_cb;
 	gpointer user_data;
 	GDestroyNotify user_data_free;
 } XbMachineMethodItem;
 
+typedef enum {
+	XB_MACHINE_INSN_KIND_PUSH,
+	XB_MACHINE_INSN_KIND_PUSH_BOUND,
+	XB_MACHINE_INSN_KIND_CALL,
+	XB_MACHINE_INSN_KIND_FUSED,
+	XB_MACHINE_INSN_KIND_JUMP_IF_FALSE,
+	XB_MACHINE_INSN_KIND_JUMP_IF_TRUE,
+} XbMachineInsnKind;
+
+typedef struct {
+	XbMachineInsnKind kind;
+	guint32 val;		/* binding index, or the number of instructions to skip */
+	const XbOpcode *opcode;	/* the first source opcode */
+	XbMachineMethodItem *method;
+	XbMachineOpcodeFusionItem *fusion;
+} XbMachineInsn;
+
+struct _XbMachineProgram {
+	XbStack *opcodes; /* the source of the pushed values */
+	guint stack_size;
+	guint insns_len;
+	XbMachineInsn insns[]; /* allocated as part of XbMachineProgram */
+};
+
 #define XB_MACHINE_STACK_LEVELS_MAX 20
 
 /**
@@ -158,6 +189,24 @@ xb_machine_add_method(XbMachine *self,
 	g_ptr_array_add(priv->methods, item);
 }
 
+/* private: a method that always pops exactly @n_opcodes and pushes one result,
+ * which allows predicates using it to be compiled with xb_machine_compile() */
+void
+xb_machine_add_method_fixed(XbMachine *self,
+			    const gchar *name,
+			    guint n_opcodes,
+			    XbMachineMethodFunc method_cb,
+			    gpointer user_data,
+			    GDestroyNotify user_data_free)
+{
+	XbMachinePrivate *priv = GET_PRIVATE(self);
+	XbMachineMethodItem *item;
+
+	xb_machine_add_method(self, name, n_opcodes, method_cb, user_data, user_data_free);
+	item = g_ptr_array_index(priv->methods, priv->methods->len - 1);
+	item->fixed_arity = TRUE;
+}
+
 /**
  * xb_machine_add_opcode_fixup:
  * @self: a #XbMachine
@@ -187,6 +236,24 @@ xb_machine_add_opcode_fixup(XbMachine *self,
 	g_hash_table_insert(priv->opcode_fixup, g_strdup(opcodes_sig), item);
 }
 
+/* private: replace a run of opcodes matching @opcodes_sig with a single call
+ * when compiling; the run has to push exactly one result */
+void
+xb_machine_add_opcode_fusion(XbMachine *self,
+			     const gchar *opcodes_sig,
+			     XbMachineOpcodeFusionFunc fusion_cb,
+			     gpointer user_data)
+{
+	XbMachineOpcodeFusionItem *item = g_slice_new0(XbMachineOpcodeFusionItem);
+	XbMachinePrivate *priv = GET_PRIVATE(self);
+	g_auto(GStrv) split = g_strsplit(opcodes_sig, ",", -1);
+	item->sig = g_strdup(opcodes_sig);
+	item->n_opcodes = g_strv_length(split);
+	item->fusion_cb = fusion_cb;
+	item->user_data = user_data;
+	g_ptr_array_add(priv->opcode_fusions, item);
+}
+
 /**
  * xb_machine_add_text_handler:
  * @self: a #XbMachine
@@ -225,6 +292,36 @@ xb_machine_find_func(XbMachine *self, const gchar *func_name)
 	return NULL;
 }
 
+/* private: replaces the implementation of an existing method, e.g. a built-in
+ * one, keeping the same index; the method is added if it does not exist */
+void
+xb_machine_override_method_fixed(XbMachine *self,
+				 const gchar *name,
+				 guint n_opcodes,
+				 XbMachineMethodFunc method_cb,
+				 gpointer user_data,
+				 GDestroyNotify user_data_free)
+{
+	XbMachineMethodItem *item = xb_machine_find_func(self, name);
+
+	if (item == NULL) {
+		xb_machine_add_method_fixed(self,
+					    name,
+					    n_opcodes,
+					    method_cb,
+					    user_data,
+					    user_data_free);
+		return;
+	}
+	if (item->user_data_free != NULL)
+		item->user_data_free(item->user_data);
+	item->n_opcodes = n_opcodes;
+	item->fixed_arity = TRUE;
+	item->method_cb = method_cb;
+	item->user_data = user_data;
+	item->user_data_free = user_data_free;
+}
+
 /**
  * xb_machine_opcode_func_init:
  * @self: a #XbMachine
@@ -278,80 +375,6 @@ xb_machine_parse_add_func(XbMachine *self,
 	return TRUE;
 }
 
-#if !GLIB_CHECK_VERSION(2, 54, 0)
-static gboolean
-str_has_sign(const gchar *str)
-{
-	return str[0] == '-' || str[0] == '+';
-}
-
-static gboolean
-str_has_hex_prefix(const gchar *str)
-{
-	return str[0] == '0' && g_ascii_tolower(str[1]) == 'x';
-}
-
-static gboolean
-g_ascii_string_to_unsigned(const gchar *str,
-			   guint base,
-			   guint64 min,
-			   guint64 max,
-			   guint64 *out_num,
-			   GError **error)
-{
-	const gchar *end_ptr = NULL;
-	gint saved_errno = 0;
-	guint64 number;
-
-	g_return_val_if_fail(str != NULL, FALSE);
-	g_return_val_if_fail(base >= 2 && base <= 36, FALSE);
-	g_return_val_if_fail(min <= max, FALSE);
-	g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
-
-	if (str[0] == '\0') {
-		g_set_error_literal(error,
-				    G_IO_ERROR,
-				    G_IO_ERROR_INVALID_DATA,
-				    "Empty string is not a number");
-		return FALSE;
-	}
-
-	errno = 0;
-	number = g_ascii_strtoull(str, (gchar **)&end_ptr, base);
-	saved_errno = errno;
-
-	if (g_ascii_isspace(str[0]) || str_has_sign(str) ||
-	    (base == 16 && str_has_hex_prefix(str)) ||
-	    (saved_errno != 0 && saved_errno != ERANGE) || end_ptr == NULL || *end_ptr != '\0') {
-		if (error != NULL) {
-			g_set_error(error,
-				    G_IO_ERROR,
-				    G_IO_ERROR_INVALID_DATA,
-				    "“%s” is not an unsigned number",
-				    str);
-		}
-		return FALSE;
-	}
-	if (saved_errno == ERANGE || number < min || number > max) {
-		if (error != NULL) {
-			g_autofree gchar *min_str = g_strdup_printf("%" G_GUINT64_FORMAT, min);
-			g_autofree gchar *max_str = g_strdup_printf("%" G_GUINT64_FORMAT, max);
-			g_set_error(error,
-				    G_IO_ERROR,
-				    G_IO_ERROR_INVALID_DATA,
-				    "Number “%s” is out of bounds [%s, %s]",
-				    str,
-				    min_str,
-				    max_str);
-		}
-		return FALSE;
-	}
-	if (out_num != NULL)
-		*out_num = number;
-	return TRUE;
-}
-#endif
-
 static gboolean
 xb_machine_parse_add_text(XbMachine *self,
 			  XbStack *opcodes,
@@ -439,11 +462,11 @@ xb_machine_parse_add_text(XbMachine *self,
 	}
 
 	/* check for plain integer */
-	if (g_ascii_string_to_unsigned(str, 10, 0, G_MAXUINT32, &val, NULL)) {
+	if (g_ascii_string_to_unsigned(str, 10, 0, G_MAXUINT64, &val, NULL)) {
 		XbOpcode *opcode;
 		if (!_xb_stack_push(opcodes, &opcode, error))
 			return FALSE;
-		xb_opcode_integer_init(opcode, val);
+		xb_opcode_integer64_init(opcode, val);
 		xb_opcode_set_level(opcode, level);
 		return TRUE;
 	}
@@ -835,6 +858,90 @@ xb_machine_parse_text(XbMachine *self,
 	return 0;
 }
 
+/* insert a conditional jump before the second operand of each and() and or()
+ * so that it can be skipped when the first operand already decides the result;
+ * returns a new reference to @opcodes if there is nothing to do */
+static XbStack *
+xb_machine_opcodes_add_jumps(XbMachine *self, XbStack *opcodes, GError **error)
+{
+	XbMachinePrivate *priv = GET_PRIVATE(self);
+	guint opcodes_sz = _xb_stack_get_size(opcodes);
+	guint depth = 0;
+	guint njumps = 0;
+	g_autofree guint *starts = g_new0(guint, opcodes_sz + 1);
+	g_autofree guint *jump_ends = g_new0(guint, opcodes_sz);
+	g_autofree XbOpcodeKind *jump_kinds = g_new0(XbOpcodeKind, opcodes_sz);
+	g_autofree guint *offsets = g_new0(guint, opcodes_sz);
+	g_autoptr(XbStack) results = NULL;
+
+	/* simulate the stack, tracking where each value started being computed */
+	for (guint i = 0; i < opcodes_sz; i++) {
+		XbOpcode *op = _xb_stack_peek(opcodes, i);
+		XbMachineMethodItem *item;
+		guint start = i;
+
+		if (_xb_opcode_get_kind(op) != XB_OPCODE_KIND_FUNCTION) {
+			starts[depth++] = i;
+			continue;
+		}
+
+		/* in() consumes a variable number of arguments */
+		item = g_ptr_array_index(priv->methods, _xb_opcode_get_val(op));
+		if (g_strcmp0(item->name, "in") == 0 || item->n_opcodes > depth)
+			return xb_stack_ref(opcodes);
+		if (item->n_opcodes > 0)
+			start = starts[depth - item->n_opcodes];
+		if (item->n_opcodes == 2 &&
+		    (g_strcmp0(item->name, "and") == 0 || g_strcmp0(item->name, "or") == 0)) {
+			guint idx = starts[depth - 1];
+			jump_kinds[idx] = g_strcmp0(item->name, "and") == 0
+					      ? XB_OPCODE_KIND_JUMP_IF_FALSE
+					      : XB_OPCODE_KIND_JUMP_IF_TRUE;
+			jump_ends[idx] = i;
+			njumps++;
+		}
+		depth -= item->n_opcodes;
+		starts[depth++] = start;
+	}
+	if (njumps == 0)
+		return xb_stack_ref(opcodes);
+
+	/* number of jumps inserted at or before each opcode */
+	for (guint i = 0, cnt = 0; i < opcodes_sz; i++) {
+		if (jump_kinds[i] != XB_OPCODE_KIND_UNKNOWN)
+			cnt++;
+		offsets[i] = cnt;
+	}
+
+	/* copy the opcodes, skipping the second operand and the operator itself */
+	results = xb_stack_new(MAX(xb_stack_get_max_size(opcodes), opcodes_sz + njumps));
+	for (guint i = 0; i < opcodes_sz; i++) {
+		XbOpcode *op_out;
+		if (jump_kinds[i] != XB_OPCODE_KIND_UNKNOWN) {
+			guint end = jump_ends[i];
+			XbOpcode *op_end = _xb_stack_peek(opcodes, end);
+			if (!_xb_stack_push(results, &op_out, error))
+				return NULL;
+			xb_opcode_init(op_out,
+				       jump_kinds[i],
+				       NULL,
+				       (end + offsets[end]) - (i + offsets[i]) + 1,
+				       NULL);
+			xb_opcode_set_level(op_out, _xb_opcode_get_level(op_end));
+		}
+		if (!_xb_stack_push(results, &op_out, error))
+			return NULL;
+		*op_out = xb_opcode_steal(_xb_stack_peek(opcodes, i));
+	}
+
+	/* debug */
+	if (priv->debug_flags & XB_MACHINE_DEBUG_FLAG_SHOW_OPTIMIZER) {
+		g_autofree gchar *str = xb_stack_to_string(results);
+		g_debug("after adding jumps: %s", str);
+	}
+	return g_steal_pointer(&results);
+}
+
 /**
  * xb_machine_parse_full:
  * @self: a #XbMachine
@@ -910,6 +1017,15 @@ xb_machine_parse_full(XbMachine *self,
 		}
 	}
 
+	/* short-circuit and() and or() */
+	if (flags & XB_MACHINE_PARSE_FLAG_OPTIMIZE) {
+		XbStack *opcodes_new = xb_machine_opcodes_add_jumps(self, opcodes, error);
+		if (opcodes_new == NULL)
+			return NULL;
+		xb_stack_unref(opcodes);
+		opcodes = opcodes_new;
+	}
+
 	/* success */
 	return g_steal_pointer(&opcodes);
 }
@@ -983,6 +1099,41 @@ xb_machine_run_func(XbMachine *self,
 	return TRUE;
 }
 
+static gboolean
+xb_machine_stack_get_result(XbStack *stack, gboolean *result, GError **error)
+{
+	g_auto(XbOpcode) opcode_success = XB_OPCODE_INIT();
+
+	/* the stack should have one boolean left on the stack */
+	if (_xb_stack_get_size(stack) != 1) {
+		if (error != NULL) {
+			g_autofree gchar *tmp = xb_stack_to_string(stack);
+			g_set_error(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "%u opcodes remain on the stack (%s)",
+				    _xb_stack_get_size(stack),
+				    tmp);
+		}
+		return FALSE;
+	}
+	if (!_xb_stack_pop(stack, &opcode_success, error))
+		return FALSE;
+	if (_xb_opcode_get_kind(&opcode_success) != XB_OPCODE_KIND_BOOLEAN) {
+		if (error != NULL) {
+			g_autofree gchar *tmp = xb_stack_to_string(stack);
+			g_set_error(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "Expected boolean, got: %s",
+				    tmp);
+		}
+		return FALSE;
+	}
+	*result = _xb_opcode_get_val(&opcode_success);
+	return TRUE;
+}
+
 /**
  * xb_machine_run:
  * @self: a #XbMachine
@@ -1039,12 +1190,32 @@ xb_machine_run_with_bindings(XbMachine *self,
 			     gboolean *result,
 			     gpointer exec_data,
 			     GError **error)
+{
+	return xb_machine_run_with_bindings_offset(self,
+						   opcodes,
+						   bindings,
+						   0,
+						   result,
+						   exec_data,
+						   error);
+}
+
+/* private: as xb_machine_run_with_bindings(), but the first bound opcode uses
+ * the value at @bindings_offset so that several predicates can share one
+ * #XbValueBindings without copying it */
+gboolean
+xb_machine_run_with_bindings_offset(XbMachine *self,
+				    XbStack *opcodes,
+				    XbValueBindings *bindings,
+				    guint bindings_offset,
+				    gboolean *result,
+				    gpointer exec_data,
+				    GError **error)
 {
 	XbMachinePrivate *priv = GET_PRIVATE(self);
-	g_auto(XbOpcode) opcode_success = XB_OPCODE_INIT();
 	g_autoptr(XbStack) stack = NULL;
 	guint opcodes_stack_size = _xb_stack_get_size(opcodes);
-	guint bound_opcode_idx = 0;
+	guint bound_opcode_idx = bindings_offset;
 
 	g_return_val_if_fail(XB_IS_MACHINE(self), FALSE);
 	g_return_val_if_fail(opcodes != NULL, FALSE);
@@ -1102,6 +1273,35 @@ xb_machine_run_with_bindings(XbMachine *self,
 			continue;
 		}
 
+		/* skip the second operand of and() or or() if the result is known; if
+		 * the head is not a value then let the operator report the error */
+		if (kind == XB_OPCODE_KIND_JUMP_IF_FALSE || kind == XB_OPCODE_KIND_JUMP_IF_TRUE) {
+			XbOpcode *head = _xb_stack_peek_head(stack);
+			gboolean val = kind == XB_OPCODE_KIND_JUMP_IF_TRUE;
+			guint skip = MIN(_xb_opcode_get_val(opcode), opcodes_stack_size - (i + 1));
+			g_auto(XbOpcode) op_tmp = XB_OPCODE_INIT();
+
+			if (head == NULL || !_xb_opcode_cmp_val(head) ||
+			    (_xb_opcode_get_val64(head) != 0) != val)
+				continue;
+			if (priv->debug_flags & XB_MACHINE_DEBUG_FLAG_SHOW_STACK)
+				g_debug("jumping over %u opcodes", skip);
+			for (guint j = i + 1; bindings != NULL && j <= i + skip; j++) {
+				XbOpcode *op_skip = _xb_stack_peek(opcodes, j);
+				XbOpcodeKind kind_tmp = _xb_opcode_get_kind(op_skip);
+				if (kind_tmp == XB_OPCODE_KIND_BOUND_TEXT ||
+				    kind_tmp == XB_OPCODE_KIND_BOUND_INDEXED_TEXT ||
+				    kind_tmp == XB_OPCODE_KIND_BOUND_INTEGER)
+					bound_opcode_idx++;
+			}
+			if (!xb_machine_stack_pop(self, stack, &op_tmp, error))
+				return FALSE;
+			if (!_xb_stack_push_bool(stack, val, error))
+				return FALSE;
+			i += skip;
+			continue;
+		}
+
 		/* add to stack; this uses a const copy of the input opcode,
 		 * so ownership of anything allocated on the heap remains with
 		 * the caller */
@@ -1130,35 +1330,237 @@ xb_machine_run_with_bindings(XbMachine *self,
 	}
 
 	/* the stack should have one boolean left on the stack */
-	if (_xb_stack_get_size(stack) != 1) {
-		if (error != NULL) {
-			g_autofree gchar *tmp = xb_stack_to_string(stack);
-			g_set_error(error,
-				    G_IO_ERROR,
-				    G_IO_ERROR_INVALID_DATA,
-				    "%u opcodes remain on the stack (%s)",
-				    _xb_stack_get_size(stack),
-				    tmp);
+	return xb_machine_stack_get_result(stack, result, error);
+}
+
+/* returns the fusion that can replace the opcodes starting at @idx, if any */
+static XbMachineOpcodeFusionItem *
+xb_machine_find_opcode_fusion(XbMachine *self, XbStack *opcodes, guint idx)
+{
+	XbMachinePrivate *priv = GET_PRIVATE(self);
+
+	for (guint i = 0; i < priv->opcode_fusions->len; i++) {
+		XbMachineOpcodeFusionItem *item = g_ptr_array_index(priv->opcode_fusions, i);
+		g_autoptr(GString) sig = g_string_new(NULL);
+
+		if (idx + item->n_opcodes > _xb_stack_get_size(opcodes))
+			continue;
+		for (guint j = idx; j < idx + item->n_opcodes; j++) {
+			XbOpcode *op = _xb_stack_peek(opcodes, j);
+			g_autofree gchar *tmp = xb_opcode_get_sig(op);
+
+			/* a replaced method cannot be bypassed */
+			if (_xb_opcode_get_kind(op) == XB_OPCODE_KIND_FUNCTION) {
+				XbMachineMethodItem *method =
+				    g_ptr_array_index(priv->methods, _xb_opcode_get_val(op));
+				if (!method->fixed_arity)
+					break;
+			}
+			if (sig->len > 0)
+				g_string_append_c(sig, ',');
+			g_string_append(sig, tmp);
 		}
-		return FALSE;
+		if (g_strcmp0(sig->str, item->sig) == 0)
+			return item;
 	}
-	if (!_xb_stack_pop(stack, &opcode_success, error))
-		return FALSE;
-	if (_xb_opcode_get_kind(&opcode_success) != XB_OPCODE_KIND_BOOLEAN) {
-		if (error != NULL) {
-			g_autofree gchar *tmp = xb_stack_to_string(stack);
-			g_set_error(error,
-				    G_IO_ERROR,
-				    G_IO_ERROR_INVALID_DATA,
-				    "Expected boolean, got: %s",
-				    tmp);
+	return NULL;
+}
+
+/* private: lowers the opcodes into instructions with the methods already
+ * resolved, fusing common patterns and checking the stack usage up front;
+ * returns %NULL if the opcodes have to be run with xb_machine_run_with_bindings(),
+ * e.g. if a method was added with xb_machine_add_method() */
+XbMachineProgram *
+xb_machine_compile(XbMachine *self, XbStack *opcodes)
+{
+	XbMachinePrivate *priv = GET_PRIVATE(self);
+	XbMachineProgram *program;
+	guint opcodes_sz = _xb_stack_get_size(opcodes);
+	guint depth = 0;
+	guint depth_max = 0;
+	guint bound_idx = 0;
+	guint insns_len = 0;
+	g_autofree guint *insn_idxs = g_new0(guint, opcodes_sz + 1);
+	g_autofree XbMachineInsn *insns = g_new0(XbMachineInsn, opcodes_sz);
+
+	for (guint i = 0; i < opcodes_sz; i++) {
+		XbOpcode *op = _xb_stack_peek(opcodes, i);
+		XbOpcodeKind kind = _xb_opcode_get_kind(op);
+		XbMachineInsn *insn = &insns[insns_len];
+		XbMachineOpcodeFusionItem *fusion = xb_machine_find_opcode_fusion(self, opcodes, i);
+
+		insn_idxs[i] = insns_len++;
+		insn->opcode = op;
+		if (fusion != NULL) {
+			insn->kind = XB_MACHINE_INSN_KIND_FUSED;
+			insn->fusion = fusion;
+			for (guint j = 1; j < fusion->n_opcodes; j++)
+				insn_idxs[i + j] = G_MAXUINT;
+			i += fusion->n_opcodes - 1;
+			depth++;
+		} else if (kind == XB_OPCODE_KIND_FUNCTION) {
+			XbMachineMethodItem *method =
+			    g_ptr_array_index(priv->methods, _xb_opcode_get_val(op));
+			if (!method->fixed_arity || method->n_opcodes > depth)
+				return NULL;
+			insn->kind = XB_MACHINE_INSN_KIND_CALL;
+			insn->method = method;
+			depth = depth - method->n_opcodes + 1;
+		} else if (kind == XB_OPCODE_KIND_JUMP_IF_FALSE) {
+			insn->kind = XB_MACHINE_INSN_KIND_JUMP_IF_FALSE;
+			insn->val = _xb_opcode_get_val(op);
+		} else if (kind == XB_OPCODE_KIND_JUMP_IF_TRUE) {
+			insn->kind = XB_MACHINE_INSN_KIND_JUMP_IF_TRUE;
+			insn->val = _xb_opcode_get_val(op);
+		} else if (kind == XB_OPCODE_KIND_BOUND_TEXT ||
+			   kind == XB_OPCODE_KIND_BOUND_INDEXED_TEXT ||
+			   kind == XB_OPCODE_KIND_BOUND_INTEGER) {
+			insn->kind = XB_MACHINE_INSN_KIND_PUSH_BOUND;
+			insn->val = bound_idx++;
+			depth++;
+		} else if (kind == XB_OPCODE_KIND_TEXT || kind == XB_OPCODE_KIND_BOOLEAN ||
+			   kind == XB_OPCODE_KIND_INTEGER || kind == XB_OPCODE_KIND_INDEXED_TEXT) {
+			insn->kind = XB_MACHINE_INSN_KIND_PUSH;
+			depth++;
+		} else {
+			return NULL;
 		}
-		return FALSE;
+		depth_max = MAX(depth_max, depth);
+	}
+	if (depth != 1)
+		return NULL;
+	insn_idxs[opcodes_sz] = insns_len;
+
+	/* convert the jumps over opcodes into jumps over instructions */
+	for (guint i = 0; i < opcodes_sz; i++) {
+		XbMachineInsn *insn;
+		guint target;
+
+		if (insn_idxs[i] == G_MAXUINT)
+			continue;
+		insn = &insns[insn_idxs[i]];
+		if (insn->kind != XB_MACHINE_INSN_KIND_JUMP_IF_FALSE &&
+		    insn->kind != XB_MACHINE_INSN_KIND_JUMP_IF_TRUE)
+			continue;
+		target = i + insn->val + 1;
+		if (target > opcodes_sz || insn_idxs[target] == G_MAXUINT)
+			return NULL;
+		insn->val = insn_idxs[target] - insn_idxs[i] - 1;
 	}
-	*result = _xb_opcode_get_val(&opcode_success);
 
 	/* success */
-	return TRUE;
+	program = g_malloc0(sizeof(XbMachineProgram) + insns_len * sizeof(XbMachineInsn));
+	program->opcodes = xb_stack_ref(opcodes);
+	program->stack_size = depth_max;
+	program->insns_len = insns_len;
+	memcpy(program->insns, insns, insns_len * sizeof(XbMachineInsn));
+	return program;
+}
+
+/* private */
+void
+xb_machine_program_free(XbMachineProgram *program)
+{
+	if (program == NULL)
+		return;
+	xb_stack_unref(program->opcodes);
+	g_free(program);
+}
+
+/* private: the equivalent of xb_machine_run_with_bindings() for a compiled
+ * program, although the stack is still shown when debugging */
+gboolean
+xb_machine_program_run(XbMachine *self,
+		       XbMachineProgram *program,
+		       XbValueBindings *bindings,
+		       guint bindings_offset,
+		       gboolean *result,
+		       gpointer exec_data,
+		       GError **error)
+{
+	XbMachinePrivate *priv = GET_PRIVATE(self);
+	g_autoptr(XbStack) stack = NULL;
+
+	if (priv->debug_flags & XB_MACHINE_DEBUG_FLAG_SHOW_STACK) {
+		return xb_machine_run_with_bindings_offset(self,
+							   program->opcodes,
+							   bindings,
+							   bindings_offset,
+							   result,
+							   exec_data,
+							   error);
+	}
+
+	stack = xb_stack_new_inline(program->stack_size);
+	for (guint i = 0; i < program->insns_len; i++) {
+		XbMachineInsn *insn = &program->insns[i];
+		XbOpcode *op;
+
+		switch (insn->kind) {
+		case XB_MACHINE_INSN_KIND_PUSH:
+			if (!_xb_stack_push(stack, &op, error))
+				return FALSE;
+			*op = *insn->opcode;
+			op->destroy_func = NULL;
+			break;
+		case XB_MACHINE_INSN_KIND_PUSH_BOUND:
+			if (!_xb_stack_push(stack, &op, error))
+				return FALSE;
+			if (bindings == NULL) {
+				*op = *insn->opcode;
+				op->destroy_func = NULL;
+				break;
+			}
+			if (!xb_value_bindings_lookup_opcode(bindings,
+							     bindings_offset + insn->val,
+							     op)) {
+				g_set_error(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "opcode %u was not bound at runtime",
+					    bindings_offset + insn->val);
+				return FALSE;
+			}
+			break;
+		case XB_MACHINE_INSN_KIND_CALL:
+			if (!insn->method->method_cb(self,
+						     stack,
+						     NULL,
+						     insn->method->user_data,
+						     exec_data,
+						     error)) {
+				g_prefix_error(error, "failed to call %s(): ", insn->method->name);
+				return FALSE;
+			}
+			break;
+		case XB_MACHINE_INSN_KIND_FUSED:
+			if (!insn->fusion->fusion_cb(self,
+						     stack,
+						     insn->opcode,
+						     insn->fusion->user_data,
+						     exec_data,
+						     error))
+				return FALSE;
+			break;
+		case XB_MACHINE_INSN_KIND_JUMP_IF_FALSE:
+		case XB_MACHINE_INSN_KIND_JUMP_IF_TRUE: {
+			XbOpcode *head = _xb_stack_peek_head(stack);
+			gboolean val = insn->kind == XB_MACHINE_INSN_KIND_JUMP_IF_TRUE;
+			if (head == NULL || !_xb_opcode_cmp_val(head) ||
+			    (_xb_opcode_get_val64(head) != 0) != val)
+				break;
+			_xb_opcode_clear(head);
+			xb_opcode_bool_init(head, val);
+			i += insn->val;
+			break;
+		}
+		default:
+			g_assert_not_reached();
+		}
+	}
+
+	/* the stack should have one boolean left on the stack */
+	return xb_machine_stack_get_result(stack, result, error);
 }
 
 /**
@@ -1373,16 +1775,23 @@ xb_machine_stack_push_text_steal(XbMachine *self, XbStack *stack, gchar *str, GE
  **/
 gboolean
 xb_machine_stack_push_integer(XbMachine *self, XbStack *stack, guint32 val, GError **error)
+{
+	return xb_machine_stack_push_integer64(self, stack, val, error);
+}
+
+/* private */
+gboolean
+xb_machine_stack_push_integer64(XbMachine *self, XbStack *stack, guint64 val, GError **error)
 {
 	XbMachinePrivate *priv = GET_PRIVATE(self);
 	XbOpcode *opcode;
 
 	if (priv->debug_flags & XB_MACHINE_DEBUG_FLAG_SHOW_STACK)
-		g_debug("pushing: %u", val);
+		g_debug("pushing: %" G_GUINT64_FORMAT, val);
 
 	if (!_xb_stack_push(stack, &opcode, error))
 		return FALSE;
-	xb_opcode_integer_init(opcode, val);
+	xb_opcode_integer64_init(opcode, val);
 	if (priv->debug_flags & XB_MACHINE_DEBUG_FLAG_SHOW_STACK)
 		xb_machine_debug_show_stack(self, stack);
 
@@ -1539,7 +1948,9 @@ xb_machine_func_and_cb(XbMachine *self,
 		return FALSE;
 
 	/* INTE:INTE */
-	return _xb_stack_push_bool(stack, _xb_opcode_get_val(&op1) && _xb_opcode_get_val(&op2), error);
+	return _xb_stack_push_bool(stack,
+				   _xb_opcode_get_val64(&op1) && _xb_opcode_get_val64(&op2),
+				   error);
 }
 
 static gboolean
@@ -1559,7 +1970,9 @@ xb_machine_func_or_cb(XbMachine *self,
 		return FALSE;
 
 	/* INTE:INTE */
-	return _xb_stack_push_bool(stack, _xb_opcode_get_val(&op1) || _xb_opcode_get_val(&op2), error);
+	return _xb_stack_push_bool(stack,
+				   _xb_opcode_get_val64(&op1) || _xb_opcode_get_val64(&op2),
+				   error);
 }
 
 static gboolean
@@ -1571,9 +1984,26 @@ xb_machine_func_eq_cb(XbMachine *self,
 		      GError **error)
 {
 	XbMachinePrivate *priv = GET_PRIVATE(self);
+	XbOpcode *head1 = _xb_stack_peek(stack, _xb_stack_get_size(stack) - 1);
+	XbOpcode *head2 = _xb_stack_peek(stack, _xb_stack_get_size(stack) - 2);
 	g_auto(XbOpcode) op1 = XB_OPCODE_INIT();
 	g_auto(XbOpcode) op2 = XB_OPCODE_INIT();
 
+	/* SET:TEXT or SET:INTE */
+	if (head1 != NULL && head2 != NULL &&
+	    (_xb_opcode_get_kind(head1) == XB_OPCODE_KIND_BOUND_SET ||
+	     _xb_opcode_get_kind(head2) == XB_OPCODE_KIND_BOUND_SET)) {
+		if (!xb_machine_stack_pop_two(self, stack, &op1, &op2, error))
+			return FALSE;
+		if (_xb_opcode_get_kind(&op1) == XB_OPCODE_KIND_BOUND_SET)
+			return _xb_stack_push_bool(stack,
+						   xb_value_bindings_set_contains(op1.ptr, &op2),
+						   error);
+		return _xb_stack_push_bool(stack,
+					   xb_value_bindings_set_contains(op2.ptr, &op1),
+					   error);
+	}
+
 	if (!xb_machine_check_two_args(stack,
 				       _xb_opcode_cmp_val_or_str,
 				       _xb_opcode_cmp_val_or_str,
@@ -1585,7 +2015,7 @@ xb_machine_func_eq_cb(XbMachine *self,
 	/* INTE:INTE */
 	if (_xb_opcode_cmp_val(&op1) && _xb_opcode_cmp_val(&op2))
 		return _xb_stack_push_bool(stack,
-					   _xb_opcode_get_val(&op1) == _xb_opcode_get_val(&op2),
+					   _xb_opcode_get_val64(&op1) == _xb_opcode_get_val64(&op2),
 					   error);
 
 	/* TEXT:TEXT */
@@ -1614,12 +2044,12 @@ xb_machine_func_eq_cb(XbMachine *self,
 		if (!g_ascii_string_to_unsigned(_xb_opcode_get_str(&op2),
 						10,
 						0,
-						G_MAXUINT32,
+						G_MAXUINT64,
 						&val,
 						error)) {
 			return FALSE;
 		}
-		return _xb_stack_push_bool(stack, val == _xb_opcode_get_val(&op1), error);
+		return _xb_stack_push_bool(stack, val == _xb_opcode_get_val64(&op1), error);
 	}
 
 	/* TEXT:INTE */
@@ -1635,12 +2065,12 @@ xb_machine_func_eq_cb(XbMachine *self,
 		if (!g_ascii_string_to_unsigned(_xb_opcode_get_str(&op1),
 						10,
 						0,
-						G_MAXUINT32,
+						G_MAXUINT64,
 						&val,
 						error)) {
 			return FALSE;
 		}
-		return _xb_stack_push_bool(stack, val == _xb_opcode_get_val(&op2), error);
+		return _xb_stack_push_bool(stack, val == _xb_opcode_get_val64(&op2), error);
 	}
 
 	/* should have been checked above */
@@ -1677,7 +2107,7 @@ xb_machine_func_ne_cb(XbMachine *self,
 	/* INTE:INTE */
 	if (_xb_opcode_cmp_val(&op1) && _xb_opcode_cmp_val(&op2)) {
 		return _xb_stack_push_bool(stack,
-					   _xb_opcode_get_val(&op1) != _xb_opcode_get_val(&op2),
+					   _xb_opcode_get_val64(&op1) != _xb_opcode_get_val64(&op2),
 					   error);
 	}
 
@@ -1697,12 +2127,12 @@ xb_machine_func_ne_cb(XbMachine *self,
 		if (!g_ascii_string_to_unsigned(_xb_opcode_get_str(&op2),
 						10,
 						0,
-						G_MAXUINT32,
+						G_MAXUINT64,
 						&val,
 						error)) {
 			return FALSE;
 		}
-		return _xb_stack_push_bool(stack, val != _xb_opcode_get_val(&op1), error);
+		return _xb_stack_push_bool(stack, val != _xb_opcode_get_val64(&op1), error);
 	}
 
 	/* TEXT:INTE */
@@ -1713,12 +2143,12 @@ xb_machine_func_ne_cb(XbMachine *self,
 		if (!g_ascii_string_to_unsigned(_xb_opcode_get_str(&op1),
 						10,
 						0,
-						G_MAXUINT32,
+						G_MAXUINT64,
 						&val,
 						error)) {
 			return FALSE;
 		}
-		return _xb_stack_push_bool(stack, val != _xb_opcode_get_val(&op2), error);
+		return _xb_stack_push_bool(stack, val != _xb_opcode_get_val64(&op2), error);
 	}
 
 	/* should have been checked above */
@@ -1755,7 +2185,7 @@ xb_machine_func_lt_cb(XbMachine *self,
 	/* INTE:INTE */
 	if (_xb_opcode_cmp_val(&op1) && _xb_opcode_cmp_val(&op2)) {
 		return _xb_stack_push_bool(stack,
-					   _xb_opcode_get_val(&op2) < _xb_opcode_get_val(&op1),
+					   _xb_opcode_get_val64(&op2) < _xb_opcode_get_val64(&op1),
 					   error);
 	}
 
@@ -1775,12 +2205,12 @@ xb_machine_func_lt_cb(XbMachine *self,
 		if (!g_ascii_string_to_unsigned(_xb_opcode_get_str(&op2),
 						10,
 						0,
-						G_MAXUINT32,
+						G_MAXUINT64,
 						&val,
 						error)) {
 			return FALSE;
 		}
-		return _xb_stack_push_bool(stack, val < _xb_opcode_get_val(&op1), error);
+		return _xb_stack_push_bool(stack, val < _xb_opcode_get_val64(&op1), error);
 	}
 
 	/* TEXT:INTE */
@@ -1791,12 +2221,12 @@ xb_machine_func_lt_cb(XbMachine *self,
 		if (!g_ascii_string_to_unsigned(_xb_opcode_get_str(&op1),
 						10,
 						0,
-						G_MAXUINT32,
+						G_MAXUINT64,
 						&val,
 						error)) {
 			return FALSE;
 		}
-		return _xb_stack_push_bool(stack, val < _xb_opcode_get_val(&op2), error);
+		return _xb_stack_push_bool(stack, val < _xb_opcode_get_val64(&op2), error);
 	}
 
 	/* should have been checked above */
@@ -1833,7 +2263,7 @@ xb_machine_func_gt_cb(XbMachine *self,
 	/* INTE:INTE */
 	if (_xb_opcode_cmp_val(&op1) && _xb_opcode_cmp_val(&op2)) {
 		return _xb_stack_push_bool(stack,
-					  _xb_opcode_get_val(&op2) > _xb_opcode_get_val(&op1),
+					  _xb_opcode_get_val64(&op2) > _xb_opcode_get_val64(&op1),
 					  error);
 	}
 
@@ -1853,12 +2283,12 @@ xb_machine_func_gt_cb(XbMachine *self,
 		if (!g_ascii_string_to_unsigned(_xb_opcode_get_str(&op2),
 						10,
 						0,
-						G_MAXUINT32,
+						G_MAXUINT64,
 						&val,
 						error)) {
 			return FALSE;
 		}
-		return _xb_stack_push_bool(stack, val > _xb_opcode_get_val(&op1), error);
+		return _xb_stack_push_bool(stack, val > _xb_opcode_get_val64(&op1), error);
 	}
 
 	/* TEXT:INTE */
@@ -1869,12 +2299,12 @@ xb_machine_func_gt_cb(XbMachine *self,
 		if (!g_ascii_string_to_unsigned(_xb_opcode_get_str(&op1),
 						10,
 						0,
-						G_MAXUINT32,
+						G_MAXUINT64,
 						&val,
 						error)) {
 			return FALSE;
 		}
-		return _xb_stack_push_bool(stack, val > _xb_opcode_get_val(&op2), error);
+		return _xb_stack_push_bool(stack, val > _xb_opcode_get_val64(&op2), error);
 	}
 
 	/* should have been checked above */
@@ -1911,7 +2341,7 @@ xb_machine_func_le_cb(XbMachine *self,
 	/* INTE:INTE */
 	if (_xb_opcode_cmp_val(&op1) && _xb_opcode_cmp_val(&op2)) {
 		return _xb_stack_push_bool(stack,
-					  _xb_opcode_get_val(&op2) <= _xb_opcode_get_val(&op1),
+					  _xb_opcode_get_val64(&op2) <= _xb_opcode_get_val64(&op1),
 					  error);
 	}
 
@@ -1932,12 +2362,12 @@ xb_machine_func_le_cb(XbMachine *self,
 		if (!g_ascii_string_to_unsigned(_xb_opcode_get_str(&op2),
 						10,
 						0,
-						G_MAXUINT32,
+						G_MAXUINT64,
 						&val,
 						error)) {
 			return FALSE;
 		}
-		return _xb_stack_push_bool(stack, val <= _xb_opcode_get_val(&op1), error);
+		return _xb_stack_push_bool(stack, val <= _xb_opcode_get_val64(&op1), error);
 	}
 
 	/* TEXT:INTE */
@@ -1948,12 +2378,12 @@ xb_machine_func_le_cb(XbMachine *self,
 		if (!g_ascii_string_to_unsigned(_xb_opcode_get_str(&op1),
 						10,
 						0,
-						G_MAXUINT32,
+						G_MAXUINT64,
 						&val,
 						error)) {
 			return FALSE;
 		}
-		return _xb_stack_push_bool(stack, val <= _xb_opcode_get_val(&op2), error);
+		return _xb_stack_push_bool(stack, val <= _xb_opcode_get_val64(&op2), error);
 	}
 
 	/* should have been checked above */
@@ -2033,7 +2463,7 @@ xb_machine_func_not_cb(XbMachine *self,
 
 	/* INTE */
 	if (_xb_opcode_cmp_val(&op))
-		return _xb_stack_push_bool(stack, _xb_opcode_get_val(&op) == 0, error);
+		return _xb_stack_push_bool(stack, _xb_opcode_get_val64(&op) == 0, error);
 
 	/* should have been checked above */
 	if (error != NULL) {
@@ -2076,7 +2506,7 @@ xb_machine_func_ge_cb(XbMachine *self,
 	/* INTE:INTE */
 	if (_xb_opcode_cmp_val(&op1) && _xb_opcode_cmp_val(&op2)) {
 		return _xb_stack_push_bool(stack,
-					  _xb_opcode_get_val(&op2) >= _xb_opcode_get_val(&op1),
+					  _xb_opcode_get_val64(&op2) >= _xb_opcode_get_val64(&op1),
 					  error);
 	}
 
@@ -2088,12 +2518,12 @@ xb_machine_func_ge_cb(XbMachine *self,
 		if (!g_ascii_string_to_unsigned(_xb_opcode_get_str(&op2),
 						10,
 						0,
-						G_MAXUINT32,
+						G_MAXUINT64,
 						&val,
 						error)) {
 			return FALSE;
 		}
-		return _xb_stack_push_bool(stack, val >= _xb_opcode_get_val(&op1), error);
+		return _xb_stack_push_bool(stack, val >= _xb_opcode_get_val64(&op1), error);
 	}
 
 	/* TEXT:INTE */
@@ -2104,12 +2534,12 @@ xb_machine_func_ge_cb(XbMachine *self,
 		if (!g_ascii_string_to_unsigned(_xb_opcode_get_str(&op1),
 						10,
 						0,
-						G_MAXUINT32,
+						G_MAXUINT64,
 						&val,
 						error)) {
 			return FALSE;
 		}
-		return _xb_stack_push_bool(stack, val >= _xb_opcode_get_val(&op2), error);
+		return _xb_stack_push_bool(stack, val >= _xb_opcode_get_val64(&op2), error);
 	}
 
 	/* should have been checked above */
@@ -2124,7 +2554,7 @@ xb_machine_func_ge_cb(XbMachine *self,
 	return FALSE;
 }
 
-static gboolean
+gboolean
 xb_machine_func_contains_cb(XbMachine *self,
 			    XbStack *stack,
 			    gboolean *result,
@@ -2212,10 +2642,10 @@ xb_machine_func_number_cb(XbMachine *self,
 	/* TEXT */
 	if (_xb_opcode_get_str(&op) == NULL)
 		return _xb_stack_push_bool(stack, FALSE, error);
-	if (!g_ascii_string_to_unsigned(_xb_opcode_get_str(&op), 10, 0, G_MAXUINT32, &val, error)) {
+	if (!g_ascii_string_to_unsigned(_xb_opcode_get_str(&op), 10, 0, G_MAXUINT64, &val, error)) {
 		return FALSE;
 	}
-	return xb_machine_stack_push_integer(self, stack, val, error);
+	return xb_machine_stack_push_integer64(self, stack, val, error);
 }
 
 static gboolean
@@ -2256,7 +2686,7 @@ xb_machine_func_string_cb(XbMachine *self,
 		return FALSE;
 
 	/* INTE */
-	tmp = g_strdup_printf("%" G_GUINT32_FORMAT, _xb_opcode_get_val(&op));
+	tmp = g_strdup_printf("%" G_GUINT64_FORMAT, _xb_opcode_get_val64(&op));
 	return xb_machine_stack_push_text_steal(self, stack, tmp, error);
 }
 
@@ -2335,6 +2765,13 @@ xb_machine_opcode_fixup_free(XbMachineOpcodeFixupItem *item)
 	g_slice_free(XbMachineOpcodeFixupItem, item);
 }
 
+static void
+xb_machine_opcode_fusion_free(XbMachineOpcodeFusionItem *item)
+{
+	g_free(item->sig);
+	g_slice_free(XbMachineOpcodeFusionItem, item);
+}
+
 static void
 xb_machine_func_free(XbMachineMethodItem *item)
 {
@@ -2373,27 +2810,39 @@ xb_machine_init(XbMachine *self)
 						   g_str_equal,
 						   g_free,
 						   (GDestroyNotify)xb_machine_opcode_fixup_free);
+	priv->opcode_fusions =
+	    g_ptr_array_new_with_free_func((GDestroyNotify)xb_machine_opcode_fusion_free);
 	priv->opcode_tokens = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 
 	/* built-in functions */
-	xb_machine_add_method(self, "and", 2, xb_machine_func_and_cb, NULL, NULL);
-	xb_machine_add_method(self, "or", 2, xb_machine_func_or_cb, NULL, NULL);
-	xb_machine_add_method(self, "eq", 2, xb_machine_func_eq_cb, NULL, NULL);
-	xb_machine_add_method(self, "ne", 2, xb_machine_func_ne_cb, NULL, NULL);
-	xb_machine_add_method(self, "lt", 2, xb_machine_func_lt_cb, NULL, NULL);
-	xb_machine_add_method(self, "gt", 2, xb_machine_func_gt_cb, NULL, NULL);
-	xb_machine_add_method(self, "le", 2, xb_machine_func_le_cb, NULL, NULL);
-	xb_machine_add_method(self, "ge", 2, xb_machine_func_ge_cb, NULL, NULL);
-	xb_machine_add_method(self, "not", 1, xb_machine_func_not_cb, NULL, NULL);
-	xb_machine_add_method(self, "lower-case", 1, xb_machine_func_lower_cb, NULL, NULL);
-	xb_machine_add_method(self, "upper-case", 1, xb_machine_func_upper_cb, NULL, NULL);
-	xb_machine_add_method(self, "contains", 2, xb_machine_func_contains_cb, NULL, NULL);
-	xb_machine_add_method(self, "starts-with", 2, xb_machine_func_starts_with_cb, NULL, NULL);
-	xb_machine_add_method(self, "ends-with", 2, xb_machine_func_ends_with_cb, NULL, NULL);
-	xb_machine_add_method(self, "string", 1, xb_machine_func_string_cb, NULL, NULL);
-	xb_machine_add_method(self, "number", 1, xb_machine_func_number_cb, NULL, NULL);
-	xb_machine_add_method(self, "string-length", 1, xb_machine_func_strlen_cb, NULL, NULL);
-	xb_machine_add_method(self, "in", 0, xb_machine_func_in_cb, NULL, NULL);
+	xb_machine_add_method_fixed(self, "and", 2, xb_machine_func_and_cb, NULL, NULL);
+	xb_machine_add_method_fixed(self, "or", 2, xb_machine_func_or_cb, NULL, NULL);
+	xb_machine_add_method_fixed(self, "eq", 2, xb_machine_func_eq_cb, NULL, NULL);
+	xb_machine_add_method_fixed(self, "ne", 2, xb_machine_func_ne_cb, NULL, NULL);
+	xb_machine_add_method_fixed(self, "lt", 2, xb_machine_func_lt_cb, NULL, NULL);
+	xb_machine_add_method_fixed(self, "gt", 2, xb_machine_func_gt_cb, NULL, NULL);
+	xb_machine_add_method_fixed(self, "le", 2, xb_machine_func_le_cb, NULL, NULL);
+	xb_machine_add_method_fixed(self, "ge", 2, xb_machine_func_ge_cb, NULL, NULL);
+	xb_machine_add_method_fixed(self, "not", 1, xb_machine_func_not_cb, NULL, NULL);
+	xb_machine_add_method_fixed(self, "lower-case", 1, xb_machine_func_lower_cb, NULL, NULL);
+	xb_machine_add_method_fixed(self, "upper-case", 1, xb_machine_func_upper_cb, NULL, NULL);
+	xb_machine_add_method_fixed(self, "contains", 2, xb_machine_func_contains_cb, NULL, NULL);
+	xb_machine_add_method_fixed(self,
+				    "starts-with",
+				    2,
+				    xb_machine_func_starts_with_cb,
+				    NULL,
+				    NULL);
+	xb_machine_add_method_fixed(self, "ends-with", 2, xb_machine_func_ends_with_cb, NULL, NULL);
+	xb_machine_add_method_fixed(self, "string", 1, xb_machine_func_string_cb, NULL, NULL);
+	xb_machine_add_method_fixed(self, "number", 1, xb_machine_func_number_cb, NULL, NULL);
+	xb_machine_add_method_fixed(self,
+				    "string-length",
+				    1,
+				    xb_machine_func_strlen_cb,
+				    NULL,
+				    NULL);
+	xb_machine_add_method(self, "in", 0, xb_machine_func_in_cb, NULL, NULL); /* variadic */
 
 	/* built-in operators */
 	xb_machine_add_operator(self, " and ", "and");
@@ -2418,6 +2867,7 @@ xb_machine_finalize(GObject *obj)
 	g_ptr_array_unref(priv->operators);
 	g_ptr_array_unref(priv->text_handlers);
 	g_hash_table_unref(priv->opcode_fixup);
+	g_ptr_array_unref(priv->opcode_fusions);
 	g_hash_table_unref(priv->opcode_tokens);
 	G_OBJECT_CLASS(xb_machine_parent_class)->finalize(obj);
 }
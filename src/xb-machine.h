@@ -55,6 +55,9 @@ typedef enum {
  * @XB_MACHINE_PARSE_FLAG_OPTIMIZE:		Run an optimization pass on the predicate
  *
  * The flags to control the parsing behaviour.
+ *
+ * When optimizing, `and` and `or` operators are also compiled so that the
+ * second operand is not evaluated if the first already decides the result.
  **/
 typedef enum {
 	XB_MACHINE_PARSE_FLAG_NONE = 0,
@@ -623,7 +623,14 @@ xb_node_attr_iter_next(XbNodeAttrIter *iter, const gchar **name, const gchar **v
 	}
 
 	ri->position--;
-	a = xb_silo_node_get_attr(priv->sn, ri->position);
+	a = xb_silo_get_node_attr(priv->silo, priv->sn, ri->position);
+	if (a == NULL) {
+		if (name != NULL)
+			*name = NULL;
+		if (value != NULL)
+			*value = NULL;
+		return FALSE;
+	}
 	if (name != NULL)
 		*name = xb_silo_from_strtab(priv->silo, a->attr_name);
 	if (value != NULL)
@@ -652,6 +659,34 @@ xb_node_get_depth(XbNode *self)
 	return xb_silo_get_node_depth(priv->silo, priv->sn);
 }
 
+/**
+ * xb_node_is_descendant:
+ * @self: a #XbNode
+ * @ancestor: a #XbNode from the same silo
+ *
+ * Checks if the node is inside the subtree of @ancestor, at any depth.
+ *
+ * This is fastest when the silo was built with
+ * %XB_BUILDER_COMPILE_FLAG_SUBTREE_END.
+ *
+ * Returns: %TRUE if @ancestor is a parent, grandparent or older
+ *
+ * Since: 0.3.12
+ **/
+gboolean
+xb_node_is_descendant(XbNode *self, XbNode *ancestor)
+{
+	XbNodePrivate *priv = GET_PRIVATE(self);
+	XbNodePrivate *priv_ancestor = GET_PRIVATE(ancestor);
+	g_return_val_if_fail(XB_IS_NODE(self), FALSE);
+	g_return_val_if_fail(XB_IS_NODE(ancestor), FALSE);
+	if (priv->sn == NULL || priv_ancestor->sn == NULL)
+		return FALSE;
+	if (priv->silo != priv_ancestor->silo)
+		return FALSE;
+	return xb_silo_is_descendant(priv->silo, priv->sn, priv_ancestor->sn);
+}
+
 /**
  * xb_node_export:
  * @self: a #XbNode
@@ -108,6 +108,8 @@ guint64
 xb_node_get_attr_as_uint(XbNode *self, const gchar *name);
 guint
 xb_node_get_depth(XbNode *self);
+gboolean
+xb_node_is_descendant(XbNode *self, XbNode *ancestor);
 
 void
 xb_node_attr_iter_init(XbNodeAttrIter *iter, XbNode *self);
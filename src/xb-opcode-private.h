@@ -18,17 +18,18 @@ G_BEGIN_DECLS
 
 struct _XbOpcode {
 	XbOpcodeKind kind;
-	guint32 val;
+	guint32 val; /* the low 32 bits of integers */
 	gpointer ptr;
 	guint8 tokens_len;
+	guint8 level;
+	guint32 val_hi; /* the high 32 bits of integers, in what would be padding */
 	const gchar *tokens[XB_OPCODE_TOKEN_MAX + 1];
 	GDestroyNotify destroy_func;
-	guint8 level;
 };
 
 #define XB_OPCODE_INIT()                                                                           \
 	{                                                                                          \
-		0, 0, NULL, 0, {NULL}, NULL, 0                                                     \
+		0, 0, NULL, 0, 0, 0, {NULL}, NULL                                                  \
 	}
 
 /**
@@ -66,11 +67,15 @@ void
 xb_opcode_bind_str(XbOpcode *self, gchar *str, GDestroyNotify destroy_func);
 G_DEPRECATED_FOR(xb_value_bindings_bind_val)
 void
-xb_opcode_bind_val(XbOpcode *self, guint32 val);
+xb_opcode_bind_val(XbOpcode *self, guint64 val);
 void
 xb_opcode_set_kind(XbOpcode *self, XbOpcodeKind kind);
 void
 xb_opcode_set_val(XbOpcode *self, guint32 val);
+void
+xb_opcode_set_val64(XbOpcode *self, guint64 val);
+void
+xb_opcode_integer64_init(XbOpcode *self, guint64 val);
 gboolean
 xb_opcode_append_token(XbOpcode *self, const gchar *val);
 const gchar **
@@ -119,6 +124,12 @@ _xb_opcode_get_val(const XbOpcode *self)
 	return self->val;
 }
 
+static inline guint64
+_xb_opcode_get_val64(const XbOpcode *self)
+{
+	return ((guint64)self->val_hi << 32) | self->val;
+}
+
 static inline gboolean
 _xb_opcode_cmp_val(const XbOpcode *self)
 {
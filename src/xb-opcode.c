@@ -40,6 +40,12 @@ xb_opcode_kind_to_string(XbOpcodeKind kind)
 		return "TEXI";
 	if (kind == XB_OPCODE_KIND_BOOLEAN)
 		return "BOOL";
+	if (kind == XB_OPCODE_KIND_JUMP_IF_FALSE)
+		return "JMPF";
+	if (kind == XB_OPCODE_KIND_JUMP_IF_TRUE)
+		return "JMPT";
+	if (kind == XB_OPCODE_KIND_BOUND_SET)
+		return "?SET";
 
 	/* bitwise fallbacks */
 	if (kind & XB_OPCODE_FLAG_FUNCTION)
@@ -80,6 +86,12 @@ xb_opcode_kind_from_string(const gchar *str)
 		return XB_OPCODE_KIND_INDEXED_TEXT;
 	if (g_strcmp0(str, "BOOL") == 0)
 		return XB_OPCODE_KIND_BOOLEAN;
+	if (g_strcmp0(str, "JMPF") == 0)
+		return XB_OPCODE_KIND_JUMP_IF_FALSE;
+	if (g_strcmp0(str, "JMPT") == 0)
+		return XB_OPCODE_KIND_JUMP_IF_TRUE;
+	if (g_strcmp0(str, "?SET") == 0)
+		return XB_OPCODE_KIND_BOUND_SET;
 	return XB_OPCODE_KIND_UNKNOWN;
 }
 
@@ -117,14 +129,20 @@ xb_opcode_to_string_internal(XbOpcode *self)
 	if (self->kind == XB_OPCODE_KIND_INDEXED_TEXT)
 		g_string_append_printf(str, "$'%s'", xb_opcode_get_str_for_display(self));
 	else if (self->kind == XB_OPCODE_KIND_INTEGER)
-		g_string_append_printf(str, "%u", xb_opcode_get_val(self));
+		g_string_append_printf(str, "%" G_GUINT64_FORMAT, _xb_opcode_get_val64(self));
 	else if (self->kind == XB_OPCODE_KIND_BOUND_TEXT ||
 		 self->kind == XB_OPCODE_KIND_BOUND_INDEXED_TEXT)
 		g_string_append_printf(str, "?'%s'", xb_opcode_get_str_for_display(self));
 	else if (self->kind == XB_OPCODE_KIND_BOUND_INTEGER)
-		g_string_append_printf(str, "?%u", xb_opcode_get_val(self));
+		g_string_append_printf(str, "?%" G_GUINT64_FORMAT, _xb_opcode_get_val64(self));
+	else if (self->kind == XB_OPCODE_KIND_BOUND_SET)
+		g_string_append_printf(str, "?{%u}", xb_opcode_get_val(self));
 	else if (self->kind == XB_OPCODE_KIND_BOOLEAN)
 		return g_strdup(xb_opcode_get_val(self) ? "True" : "False");
+	else if (self->kind == XB_OPCODE_KIND_JUMP_IF_FALSE)
+		g_string_append_printf(str, "jf(%u)", xb_opcode_get_val(self));
+	else if (self->kind == XB_OPCODE_KIND_JUMP_IF_TRUE)
+		g_string_append_printf(str, "jt(%u)", xb_opcode_get_val(self));
 	else if (self->kind & XB_OPCODE_FLAG_FUNCTION)
 		g_string_append_printf(str, "%s()", xb_opcode_get_str_for_display(self));
 	else if (self->kind & XB_OPCODE_FLAG_TEXT)
@@ -353,6 +371,7 @@ xb_opcode_init(XbOpcode *self,
 	self->kind = kind;
 	self->ptr = (gpointer)str;
 	self->val = val;
+	self->val_hi = 0;
 	self->tokens_len = 0;
 	self->destroy_func = destroy_func;
 }
@@ -437,14 +456,14 @@ xb_opcode_bind_str(XbOpcode *self, gchar *str, GDestroyNotify destroy_func)
 
 /* private */
 void
-xb_opcode_bind_val(XbOpcode *self, guint32 val)
+xb_opcode_bind_val(XbOpcode *self, guint64 val)
 {
 	if (self->destroy_func) {
 		self->destroy_func(self->ptr);
 		self->destroy_func = NULL;
 	}
 	self->kind = XB_OPCODE_KIND_BOUND_INTEGER;
-	self->val = val;
+	xb_opcode_set_val64(self, val);
 }
 
 /* private */
@@ -452,6 +471,15 @@ void
 xb_opcode_set_val(XbOpcode *self, guint32 val)
 {
 	self->val = val;
+	self->val_hi = 0;
+}
+
+/* private */
+void
+xb_opcode_set_val64(XbOpcode *self, guint64 val)
+{
+	self->val = val & G_MAXUINT32;
+	self->val_hi = val >> 32;
 }
 
 /* private */
@@ -489,6 +517,14 @@ xb_opcode_integer_init(XbOpcode *self, guint32 val)
 	xb_opcode_init(self, XB_OPCODE_KIND_INTEGER, NULL, val, NULL);
 }
 
+/* private */
+void
+xb_opcode_integer64_init(XbOpcode *self, guint64 val)
+{
+	xb_opcode_init(self, XB_OPCODE_KIND_INTEGER, NULL, 0, NULL);
+	xb_opcode_set_val64(self, val);
+}
+
 /* private */
 void
 xb_opcode_bool_init(XbOpcode *self, gboolean val)
@@ -18,6 +18,8 @@ G_BEGIN_DECLS
  * @XB_OPCODE_FLAG_FUNCTION:			An operator
  * @XB_OPCODE_FLAG_BOUND:			A bound value, assigned later
  * @XB_OPCODE_FLAG_TOKENIZED:			Tokenized text
+ * @XB_OPCODE_FLAG_JUMP:			A conditional jump over later opcodes
+ * @XB_OPCODE_FLAG_SET:				A set of values
  *
  * The opcode flags. The values have been carefully chosen so that a simple
  * bitmask can be done to know how to compare for equality.
@@ -36,6 +38,8 @@ typedef enum {
 	XB_OPCODE_FLAG_BOUND = 1 << 3,	   /* Since: 0.1.4 */
 	XB_OPCODE_FLAG_BOOLEAN = 1 << 4,   /* Since: 0.1.11 */
 	XB_OPCODE_FLAG_TOKENIZED = 1 << 5, /* Since: 0.3.1 */
+	XB_OPCODE_FLAG_JUMP = 1 << 6,	   /* Since: 0.3.12 */
+	XB_OPCODE_FLAG_SET = 1 << 7,	   /* Since: 0.3.12 */
 	/*< private >*/
 	XB_OPCODE_FLAG_LAST
 } XbOpcodeFlags;
@@ -50,6 +54,11 @@ typedef enum {
  * @XB_OPCODE_KIND_BOUND_TEXT:			A bound text value
  * @XB_OPCODE_KIND_INDEXED_TEXT:		An indexed text value
  * @XB_OPCODE_KIND_BOUND_INDEXED_TEXT:		An bound indexed text value
+ * @XB_OPCODE_KIND_JUMP_IF_FALSE:		Skip the next opcodes if the stack head is false
+ * @XB_OPCODE_KIND_JUMP_IF_TRUE:		Skip the next opcodes if the stack head is true
+ * @XB_OPCODE_KIND_BOUND_SET:			A bound set of text or integer values
+ *
+ * The jump opcodes store the number of opcodes to skip as the integer value.
  **/
 typedef enum {
 	XB_OPCODE_KIND_UNKNOWN = 0x0,						 /* Since: 0.1.1 */
@@ -67,6 +76,10 @@ typedef enum {
 	    XB_OPCODE_FLAG_INTEGER | XB_OPCODE_FLAG_BOOLEAN,			 /* Since: 0.1.11 */
 	XB_OPCODE_KIND_BOUND_INDEXED_TEXT =
 	    XB_OPCODE_FLAG_BOUND | XB_OPCODE_FLAG_INTEGER | XB_OPCODE_FLAG_TEXT, /* Since: 0.3.12 */
+	XB_OPCODE_KIND_JUMP_IF_FALSE = XB_OPCODE_FLAG_JUMP,			 /* Since: 0.3.12 */
+	XB_OPCODE_KIND_JUMP_IF_TRUE =
+	    XB_OPCODE_FLAG_JUMP | XB_OPCODE_FLAG_BOOLEAN,			 /* Since: 0.3.12 */
+	XB_OPCODE_KIND_BOUND_SET = XB_OPCODE_FLAG_BOUND | XB_OPCODE_FLAG_SET,	 /* Since: 0.3.12 */
 	/*< private >*/
 	XB_OPCODE_KIND_LAST
 } XbOpcodeKind;
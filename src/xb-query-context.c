@@ -29,7 +29,8 @@ typedef struct {
 	guint limit;
 	XbQueryFlags flags;
 	XbValueBindings bindings;
-	gpointer dummy[5];
+	guint offset;
+	gpointer dummy[4];
 } RealQueryContext;
 
 G_STATIC_ASSERT(sizeof(XbQueryContext) == sizeof(RealQueryContext));
@@ -55,6 +56,7 @@ xb_query_context_init(XbQueryContext *self)
 
 	_self->limit = 0;
 	_self->flags = XB_QUERY_FLAG_NONE;
+	_self->offset = 0;
 	xb_value_bindings_init(&_self->bindings);
 }
 
@@ -98,6 +100,7 @@ xb_query_context_copy(XbQueryContext *self)
 
 	_copy->limit = _self->limit;
 	_copy->flags = _self->flags;
+	_copy->offset = _self->offset;
 
 	while (xb_value_bindings_copy_binding(&_self->bindings, i, &_copy->bindings, i))
 		i++;
@@ -184,6 +187,48 @@ xb_query_context_set_limit(XbQueryContext *self, guint limit)
 	_self->limit = limit;
 }
 
+/**
+ * xb_query_context_get_offset:
+ * @self: an #XbQueryContext
+ *
+ * Get the number of query results to skip. See xb_query_context_set_offset().
+ *
+ * Returns: number of results to skip, or `0` for none
+ * Since: 0.3.12
+ */
+guint
+xb_query_context_get_offset(XbQueryContext *self)
+{
+	RealQueryContext *_self = (RealQueryContext *)self;
+
+	g_return_val_if_fail(self != NULL, 0);
+
+	return _self->offset;
+}
+
+/**
+ * xb_query_context_set_offset:
+ * @self: an #XbQueryContext
+ * @offset: number of query results to skip, or `0` for none
+ *
+ * Set the number of results to skip before any are returned from the query,
+ * for instance to show a page of results. The limit applies to the results
+ * after the skipped ones.
+ *
+ * No #XbNode objects are created for the skipped results.
+ *
+ * Since: 0.3.12
+ */
+void
+xb_query_context_set_offset(XbQueryContext *self, guint offset)
+{
+	RealQueryContext *_self = (RealQueryContext *)self;
+
+	g_return_if_fail(self != NULL);
+
+	_self->offset = offset;
+}
+
 /**
  * xb_query_context_get_flags:
  * @self: an #XbQueryContext
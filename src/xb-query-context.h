@@ -78,6 +78,11 @@ xb_query_context_get_limit(XbQueryContext *self);
 void
 xb_query_context_set_limit(XbQueryContext *self, guint limit);
 
+guint
+xb_query_context_get_offset(XbQueryContext *self);
+void
+xb_query_context_set_offset(XbQueryContext *self, guint offset);
+
 XbQueryFlags
 xb_query_context_get_flags(XbQueryContext *self);
 void
@@ -22,8 +22,14 @@ typedef enum {
 typedef struct {
 	gchar *element;
 	guint32 element_idx;
-	GPtrArray *predicates; /* of XbStack */
+	GPtrArray *predicates;	  /* of XbStack */
+	GPtrArray *programs;	  /* of XbMachineProgram, or NULL if not compiled */
+	GArray *bindings_offsets; /* of guint, the first bound value of each predicate */
+	guint n_bindings;	  /* bound values used by all the predicates */
 	XbSiloQueryKind kind;
+	gboolean descendant;	  /* matches at any depth, from `//` */
+	guint64 bloom;		  /* element names required below a matching node */
+	gboolean never_matches;	  /* a predicate is always FALSE */
 } XbQuerySection;
 
 GPtrArray *
@@ -10,7 +10,7 @@
 
 #include <gio/gio.h>
 
-#include "xb-machine.h"
+#include "xb-machine-private.h"
 #include "xb-opcode-private.h"
 #include "xb-query-private.h"
 #include "xb-silo-private.h"
@@ -77,13 +77,11 @@ xb_query_section_to_string(XbQuerySection *sect)
 	else
 		g_string_append(str, sect->element);
 	if (sect->predicates != NULL && sect->predicates->len > 0) {
-		g_string_append(str, "[");
 		for (guint j = 0; j < sect->predicates->len; j++) {
 			XbStack *stack = g_ptr_array_index(sect->predicates, j);
 			g_autofree gchar *tmp = xb_stack_to_string(stack);
-			g_string_append(str, tmp);
+			g_string_append_printf(str, "[%s]", tmp);
 		}
-		g_string_append(str, "]");
 	}
 	return g_string_free(str, FALSE);
 }
@@ -92,7 +90,8 @@ xb_query_section_to_string(XbQuerySection *sect)
  * xb_query_to_string:
  * @self: a #XbQuery
  *
- * Gets the XPath that was used for the query.
+ * Gets the XPath that was used for the query. Each predicate is shown in the
+ * order it is run, which may have been changed by %XB_QUERY_FLAG_OPTIMIZE.
  *
  * Returns: string
  *
@@ -106,6 +105,8 @@ xb_query_to_string(XbQuery *self)
 	for (guint i = 0; i < priv->sections->len; i++) {
 		XbQuerySection *sect = g_ptr_array_index(priv->sections, i);
 		g_autofree gchar *tmp = xb_query_section_to_string(sect);
+		if (sect->descendant)
+			g_string_append(str, i == 0 ? "//" : "/");
 		g_string_append(str, tmp);
 		if (i != priv->sections->len - 1)
 			g_string_append(str, "/");
@@ -273,6 +274,30 @@ xb_query_bind_str(XbQuery *self, guint idx, const gchar *str, GError **error)
  **/
 gboolean
 xb_query_bind_val(XbQuery *self, guint idx, guint32 val, GError **error)
+{
+	G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+	return xb_query_bind_val64(self, idx, val, error);
+	G_GNUC_END_IGNORE_DEPRECATIONS
+}
+
+/**
+ * xb_query_bind_val64:
+ * @self: a #XbQuery
+ * @idx: an integer index
+ * @val: 64 bit value to assign to the bound variable
+ * @error: a #GError, or %NULL
+ *
+ * Assigns a 64 bit integer to a bound value specified using `?`.
+ *
+ * Returns: %TRUE if the @idx existed
+ *
+ * Since: 0.3.12
+ * Deprecated: 0.3.12: Use #XbValueBindings and xb_value_bindings_bind_val64()
+ *     instead. That keeps the value bindings separate from the #XbQuery,
+ *     allowing queries to be re-used over time and between threads.
+ **/
+gboolean
+xb_query_bind_val64(XbQuery *self, guint idx, guint64 val, GError **error)
 {
 	G_GNUC_BEGIN_IGNORE_DEPRECATIONS
 	XbOpcode *op;
@@ -300,6 +325,10 @@ xb_query_section_free(XbQuerySection *section)
 {
 	if (section->predicates != NULL)
 		g_ptr_array_unref(section->predicates);
+	if (section->programs != NULL)
+		g_ptr_array_unref(section->programs);
+	if (section->bindings_offsets != NULL)
+		g_array_unref(section->bindings_offsets);
 	g_free(section->element);
 	g_slice_free(XbQuerySection, section);
 }
@@ -328,6 +357,75 @@ xb_query_repair_opcode_texi(XbQuery *self,
 	return TRUE;
 }
 
+static gboolean
+xb_query_opcode_is_func(XbOpcode *op, const gchar *name)
+{
+	return op != NULL && _xb_opcode_get_kind(op) == XB_OPCODE_KIND_FUNCTION &&
+	       g_strcmp0(_xb_opcode_get_str(op), name) == 0;
+}
+
+/* the literal is only ever compared with a string from the silo */
+static gboolean
+xb_query_opcode_is_internable(XbStack *opcodes, guint idx)
+{
+	XbOpcode *prev = idx > 0 ? _xb_stack_peek(opcodes, idx - 1) : NULL;
+	XbOpcode *next = _xb_stack_peek(opcodes, idx + 1);
+	XbOpcode *next2 = _xb_stack_peek(opcodes, idx + 2);
+
+	/* 'type',attr(), 'type','desktop',attr-eq() and 'priority',attr-number() */
+	if (xb_query_opcode_is_func(next, "attr") || xb_query_opcode_is_func(next, "attr-eq") ||
+	    xb_query_opcode_is_func(next2, "attr-eq") ||
+	    xb_query_opcode_is_func(next, "attr-number"))
+		return TRUE;
+
+	/* text(),'foo',eq() */
+	if (xb_query_opcode_is_func(next, "eq") || xb_query_opcode_is_func(next, "ne")) {
+		return xb_query_opcode_is_func(prev, "text") ||
+		       xb_query_opcode_is_func(prev, "tail") ||
+		       xb_query_opcode_is_func(prev, "attr");
+	}
+
+	/* 'foo',text(),eq() */
+	if (xb_query_opcode_is_func(next, "text") || xb_query_opcode_is_func(next, "tail"))
+		return xb_query_opcode_is_func(next2, "eq") || xb_query_opcode_is_func(next2, "ne");
+	return FALSE;
+}
+
+/* Converts the literals compared against node text and attributes into string
+ * table offsets, which works as the strtab is deduplicated. Returns %FALSE if
+ * the predicate is a single equality test for a string not in the silo. */
+static gboolean
+xb_query_intern_predicate(XbQueryParseContext *context, XbStack *opcodes)
+{
+	gboolean absent = FALSE;
+	XbOpcode *tail = _xb_stack_peek_tail(opcodes);
+
+	/* without the sorted strtab every string would have to be compared */
+	if (xb_silo_get_section(context->silo, XB_SILO_SECTION_KIND_STRTAB_SORTED, NULL) == NULL)
+		return TRUE;
+	for (guint i = 0; i < _xb_stack_get_size(opcodes); i++) {
+		XbOpcode *op = _xb_stack_peek(opcodes, i);
+		guint32 val;
+
+		if (_xb_opcode_get_kind(op) != XB_OPCODE_KIND_TEXT ||
+		    _xb_opcode_get_str(op) == NULL)
+			continue;
+		if (!xb_query_opcode_is_internable(opcodes, i))
+			continue;
+		val = xb_silo_strtab_find(context->silo, _xb_opcode_get_str(op));
+		if (val == XB_SILO_UNSET) {
+			absent = TRUE;
+			continue;
+		}
+		xb_opcode_set_kind(op, XB_OPCODE_KIND_INDEXED_TEXT);
+		xb_opcode_set_val(op, val);
+	}
+	if (absent && _xb_stack_get_size(opcodes) == 3 &&
+	    (xb_query_opcode_is_func(tail, "eq") || xb_query_opcode_is_func(tail, "attr-eq")))
+		return FALSE;
+	return TRUE;
+}
+
 /* Returns an error if the XPath is invalid. */
 static gboolean
 xb_query_parse_predicate(XbQuery *self,
@@ -371,6 +469,19 @@ xb_query_parse_predicate(XbQuery *self,
 		}
 	}
 
+	/* compare by offset, and skip the section if it can never match */
+	if (priv->flags & XB_QUERY_FLAG_OPTIMIZE) {
+		if (!xb_query_intern_predicate(context, opcodes)) {
+			XbOpcode *op;
+			g_clear_pointer(&opcodes, xb_stack_unref);
+			opcodes = xb_stack_new(1);
+			if (!_xb_stack_push(opcodes, &op, error))
+				return FALSE;
+			xb_opcode_bool_init(op, FALSE);
+			section->never_matches = TRUE;
+		}
+	}
+
 	/* create array if it does not exist */
 	if (section->predicates == NULL)
 		section->predicates =
@@ -379,6 +490,149 @@ xb_query_parse_predicate(XbQuery *self,
 	return TRUE;
 }
 
+/* a rough relative cost of running the opcode, where unknown functions are
+ * assumed to be expensive */
+static guint
+xb_query_opcode_get_cost(XbOpcode *op)
+{
+	const gchar *cheap[] = {"and", "or", "not", "attr", "text", "tail", "first", "last",
+				"position", NULL};
+	const gchar *compare[] = {"eq", "ne", "lt", "gt", "le", "ge", "attr-eq", NULL};
+	const gchar *convert[] = {"lower-case", "upper-case", "string", "number",
+				  "string-length", "starts-with", "ends-with", "in", "stem", NULL};
+	const gchar *scan[] = {"contains", "search", NULL};
+	const gchar *name;
+
+	/* integers and indexed strings compare as integers */
+	if (_xb_opcode_get_kind(op) == XB_OPCODE_KIND_TEXT ||
+	    _xb_opcode_get_kind(op) == XB_OPCODE_KIND_BOUND_TEXT)
+		return 1;
+	if (_xb_opcode_get_kind(op) != XB_OPCODE_KIND_FUNCTION)
+		return 0;
+	name = _xb_opcode_get_str(op);
+	if (g_strv_contains(cheap, name))
+		return 1;
+	if (g_strv_contains(compare, name))
+		return 2;
+	if (g_strv_contains(convert, name))
+		return 4;
+	if (g_strv_contains(scan, name))
+		return 16;
+	return 8;
+}
+
+static guint
+xb_query_predicate_get_cost(XbStack *opcodes)
+{
+	guint cost = 0;
+	for (guint i = 0; i < _xb_stack_get_size(opcodes); i++)
+		cost += xb_query_opcode_get_cost(_xb_stack_peek(opcodes, i));
+	return cost;
+}
+
+static gboolean
+xb_query_predicate_has_binding(XbStack *opcodes)
+{
+	for (guint i = 0; i < _xb_stack_get_size(opcodes); i++) {
+		if (_xb_opcode_is_binding(_xb_stack_peek(opcodes, i)))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* the result depends on the position in the sibling list */
+static gboolean
+xb_query_predicate_is_positional(XbStack *opcodes)
+{
+	const gchar *positional[] = {"first", "last", "position", NULL};
+	for (guint i = 0; i < _xb_stack_get_size(opcodes); i++) {
+		XbOpcode *op = _xb_stack_peek(opcodes, i);
+		if (_xb_opcode_get_kind(op) == XB_OPCODE_KIND_FUNCTION &&
+		    g_strv_contains(positional, _xb_opcode_get_str(op)))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* run the cheapest predicates first, as the first one to fail stops the node
+ * matching; predicates never move across one that depends on the position,
+ * and ones with bound values keep their relative order so that the binding
+ * indexes are unchanged */
+static void
+xb_query_optimize_section(XbQuerySection *section)
+{
+	guint start = 0;
+
+	if (section->predicates == NULL || section->predicates->len < 2)
+		return;
+	for (guint i = 0; i <= section->predicates->len; i++) {
+		g_autoptr(GPtrArray) bound = NULL;
+		if (i < section->predicates->len &&
+		    !xb_query_predicate_is_positional(g_ptr_array_index(section->predicates, i)))
+			continue;
+
+		/* stable insertion sort, as there are only ever a few predicates */
+		bound = g_ptr_array_new();
+		for (guint j = start; j < i; j++) {
+			XbStack *opcodes = g_ptr_array_index(section->predicates, j);
+			if (xb_query_predicate_has_binding(opcodes))
+				g_ptr_array_add(bound, opcodes);
+		}
+		for (guint j = start + 1; j < i; j++) {
+			for (guint k = j; k > start; k--) {
+				gpointer tmp = section->predicates->pdata[k];
+				gpointer prev = section->predicates->pdata[k - 1];
+				if (xb_query_predicate_get_cost(prev) <=
+				    xb_query_predicate_get_cost(tmp))
+					break;
+				section->predicates->pdata[k] = prev;
+				section->predicates->pdata[k - 1] = tmp;
+			}
+		}
+		for (guint j = start, k = 0; j < i; j++) {
+			XbStack *opcodes = g_ptr_array_index(section->predicates, j);
+			if (xb_query_predicate_has_binding(opcodes))
+				section->predicates->pdata[j] = g_ptr_array_index(bound, k++);
+		}
+		start = i + 1;
+	}
+}
+
+/* lower each predicate to a compiled program where possible, falling back to
+ * the interpreter for the ones that use custom or variadic methods */
+static void
+xb_query_compile_section(XbSilo *silo, XbQuerySection *section)
+{
+	if (section->predicates == NULL)
+		return;
+	section->programs =
+	    g_ptr_array_new_with_free_func((GDestroyNotify)xb_machine_program_free);
+	for (guint i = 0; i < section->predicates->len; i++) {
+		XbStack *opcodes = g_ptr_array_index(section->predicates, i);
+		g_ptr_array_add(section->programs,
+				xb_machine_compile(xb_silo_get_machine(silo), opcodes));
+	}
+}
+
+/* the bound values used by each predicate are consecutive, so work out where
+ * each one starts once rather than counting them for every node */
+static void
+xb_query_index_section_bindings(XbQuerySection *section)
+{
+	if (section->predicates == NULL)
+		return;
+	section->bindings_offsets =
+	    g_array_sized_new(FALSE, FALSE, sizeof(guint), section->predicates->len);
+	for (guint i = 0; i < section->predicates->len; i++) {
+		XbStack *opcodes = g_ptr_array_index(section->predicates, i);
+		g_array_append_val(section->bindings_offsets, section->n_bindings);
+		for (guint j = 0; j < _xb_stack_get_size(opcodes); j++) {
+			if (_xb_opcode_is_binding(_xb_stack_peek(opcodes, j)))
+				section->n_bindings++;
+		}
+	}
+}
+
 /* Returns an error if the XPath is invalid. */
 static XbQuerySection *
 xb_query_parse_section(XbQuery *self,
@@ -386,6 +640,7 @@ xb_query_parse_section(XbQuery *self,
 		       const gchar *xpath,
 		       GError **error)
 {
+	XbQueryPrivate *priv = GET_PRIVATE(self);
 	g_autoptr(XbQuerySection) section = g_slice_new0(XbQuerySection);
 	guint start = 0;
 
@@ -429,6 +684,11 @@ xb_query_parse_section(XbQuery *self,
 
 	if (section->element == NULL)
 		section->element = g_strdup(xpath);
+	if (priv->flags & XB_QUERY_FLAG_OPTIMIZE) {
+		xb_query_optimize_section(section);
+		xb_query_compile_section(context->silo, section);
+	}
+	xb_query_index_section_bindings(section);
 	if (g_strcmp0(section->element, "child::*") == 0 || g_strcmp0(section->element, "*") == 0) {
 		section->kind = XB_SILO_QUERY_KIND_WILDCARD;
 		return g_steal_pointer(&section);
@@ -442,12 +702,29 @@ xb_query_parse_section(XbQuery *self,
 	return g_steal_pointer(&section);
 }
 
+static gboolean
+xb_query_section_set_descendant(XbQuerySection *section, gboolean descendant, GError **error)
+{
+	if (!descendant)
+		return TRUE;
+	if (section->kind == XB_SILO_QUERY_KIND_PARENT) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_NOT_SUPPORTED,
+				    "parent cannot be used with the descendant axis");
+		return FALSE;
+	}
+	section->descendant = TRUE;
+	return TRUE;
+}
+
 /* Returns an error if the XPath is invalid. */
 static gboolean
 xb_query_parse(XbQuery *self, XbQueryParseContext *context, const gchar *xpath, GError **error)
 {
 	XbQueryPrivate *priv = GET_PRIVATE(self);
 	XbQuerySection *section;
+	gboolean descendant = FALSE;
 	g_autoptr(GString) acc = g_string_new(NULL);
 
 	//	g_debug ("parsing XPath %s", xpath);
@@ -461,6 +738,16 @@ xb_query_parse(XbQuery *self, XbQueryParseContext *context, const gchar *xpath,
 			}
 		}
 
+		/* descendant, e.g. `//checksum` or `components//checksum` */
+		if (xpath[i] == '/' && acc->len == 0 && !descendant) {
+			if (i == 0 && xpath[i + 1] == '/')
+				continue;
+			if (i > 0 && xpath[i - 1] == '/') {
+				descendant = TRUE;
+				continue;
+			}
+		}
+
 		/* split */
 		if (xpath[i] == '/') {
 			if (acc->len == 0) {
@@ -473,8 +760,13 @@ xb_query_parse(XbQuery *self, XbQueryParseContext *context, const gchar *xpath,
 			section = xb_query_parse_section(self, context, acc->str, error);
 			if (section == NULL)
 				return FALSE;
+			if (!xb_query_section_set_descendant(section, descendant, error)) {
+				xb_query_section_free(section);
+				return FALSE;
+			}
 			g_ptr_array_add(priv->sections, section);
 			g_string_truncate(acc, 0);
+			descendant = FALSE;
 			continue;
 		}
 		g_string_append_c(acc, xpath[i]);
@@ -484,10 +776,37 @@ xb_query_parse(XbQuery *self, XbQueryParseContext *context, const gchar *xpath,
 	section = xb_query_parse_section(self, context, acc->str, error);
 	if (section == NULL)
 		return FALSE;
+	if (!xb_query_section_set_descendant(section, descendant, error)) {
+		xb_query_section_free(section);
+		return FALSE;
+	}
 	g_ptr_array_add(priv->sections, section);
 	return TRUE;
 }
 
+/* each section gets the element names that have to exist in the subtree of a
+ * matching node for the rest of the query to succeed, up to any parent */
+static void
+xb_query_compute_blooms(XbQuery *self)
+{
+	XbQueryPrivate *priv = GET_PRIVATE(self);
+	guint64 bloom = 0;
+
+	for (guint i = priv->sections->len; i > 0; i--) {
+		XbQuerySection *section = g_ptr_array_index(priv->sections, i - 1);
+		section->bloom = bloom;
+		if (section->kind == XB_SILO_QUERY_KIND_PARENT) {
+			bloom = 0;
+			continue;
+		}
+		if (section->kind == XB_SILO_QUERY_KIND_WILDCARD)
+			continue;
+		if (section->element_idx == XB_SILO_UNSET)
+			continue;
+		bloom |= xb_silo_node_bloom_for_idx(section->element_idx);
+	}
+}
+
 /**
  * xb_query_new_full:
  * @silo: a #XbSilo
@@ -537,6 +856,9 @@ xb_query_new_full(XbSilo *silo, const gchar *xpath, XbQueryFlags flags, GError *
 		return NULL;
 	}
 
+	/* allow skipping subtrees that cannot match */
+	xb_query_compute_blooms(self);
+
 	/* success */
 	return g_steal_pointer(&self);
 }
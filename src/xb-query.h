@@ -32,6 +32,8 @@ struct _XbQueryClass {
  * @XB_QUERY_FLAG_USE_INDEXES:		Use the indexed parameters
  * @XB_QUERY_FLAG_REVERSE:		Reverse the results order
  * @XB_QUERY_FLAG_FORCE_NODE_CACHE:	Always cache the #XbNode objects
+ * @XB_QUERY_FLAG_PARALLEL:		Query large numbers of siblings using threads, which
+ *					needs %XB_BUILDER_COMPILE_FLAG_CHILD_INDEX
  *
  * The flags used for queries.
  **/
@@ -41,6 +43,7 @@ typedef enum {
 	XB_QUERY_FLAG_USE_INDEXES = 1 << 1,	 /* Since: 0.1.6 */
 	XB_QUERY_FLAG_REVERSE = 1 << 2,		 /* Since: 0.1.15 */
 	XB_QUERY_FLAG_FORCE_NODE_CACHE = 1 << 3, /* Since: 0.2.0 */
+	XB_QUERY_FLAG_PARALLEL = 1 << 4,	 /* Since: 0.3.12 */
 	/*< private >*/
 	XB_QUERY_FLAG_LAST
 } XbQueryFlags;
@@ -74,5 +77,8 @@ xb_query_bind_str(XbQuery *self, guint idx, const gchar *str, GError **error);
 G_DEPRECATED_FOR(xb_value_bindings_bind_val)
 gboolean
 xb_query_bind_val(XbQuery *self, guint idx, guint32 val, GError **error);
+G_DEPRECATED_FOR(xb_value_bindings_bind_val64)
+gboolean
+xb_query_bind_val64(XbQuery *self, guint idx, guint64 val, GError **error);
 
 G_END_DECLS
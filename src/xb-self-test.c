@@ -11,10 +11,11 @@
 
 #include "xb-builder-node.h"
 #include "xb-builder.h"
-#include "xb-machine.h"
+#include "xb-machine-private.h"
 #include "xb-node-query.h"
 #include "xb-opcode-private.h"
 #include "xb-opcode.h"
+#include "xb-query-private.h"
 #include "xb-silo-export.h"
 #include "xb-silo-private.h"
 #include "xb-silo-query-private.h"
@@ -220,8 +221,8 @@ xb_predicate_func(void)
 		const gchar *pred;
 		const gchar *str;
 	} tests[] = {{"'a'='b'", "'a','b',eq()"},
-		     {"@a='b'", "'a',attr(),'b',eq()"},
-		     {"@a=='b'", "'a',attr(),'b',eq()"},
+		     {"@a='b'", "'a','b',attr-eq()"},
+		     {"@a=='b'", "'a','b',attr-eq()"},
 		     {"'a'<'b'", "'a','b',lt()"},
 		     {"999>=123", "999,123,ge()"},
 		     {"not(0)", "0^1,not()"},
@@ -285,7 +286,7 @@ xb_predicate_optimize_func(void)
 	struct {
 		const gchar *pred;
 		const gchar *str;
-	} tests[] = {{"@a='b'", "'a',attr(),'b',eq()"},
+	} tests[] = {{"@a='b'", "'a','b',attr-eq()"},
 		     {"'a'<'b'", "True"},  /* success! */
 		     {"999>=123", "True"}, /* success! */
 		     {"not(0)", "True"},   /* success! */
@@ -293,8 +294,25 @@ xb_predicate_optimize_func(void)
 		     {"upper-case('Τάχιστη')", "'ΤΆΧΙΣΤΗ'"},
 		     {"upper-case(lower-case('Fire'))", "'FIRE'"}, /* 2nd pass */
 		     {"text()==('a','b','c')", "text(),'c'^1,'b'^1,'a'^1,in()"},
+		     {"(@a='b')&&(@c='d')",
+		      "'a'^1,attr()^1,'b'^1,eq()^1,jf(5),'c'^1,attr()^1,'d'^1,eq()^1,and()"},
+		     {"(@a='b')||(@c='d')",
+		      "'a'^1,attr()^1,'b'^1,eq()^1,jt(5),'c'^1,attr()^1,'d'^1,eq()^1,or()"},
 		     /* sentinel */
 		     {NULL, NULL}};
+	struct {
+		const gchar *pred;
+		guint32 vals[3];
+		gboolean result;
+	} runs[] = {/* the second operand would fail if it was run */
+		    {"(?=1)&&(lower-case(2)='x')", {0}, FALSE},
+		    {"(?=1)||(lower-case(2)='x')", {1}, TRUE},
+		    /* the skipped binding is not used for the third operand */
+		    {"((?=1)&&(?=2))||(?=3)", {0, 2, 3}, TRUE},
+		    {"((?=1)&&(?=2))||(?=3)", {1, 2, 0}, TRUE},
+		    {"((?=1)&&(?=2))||(?=3)", {1, 0, 0}, FALSE},
+		    /* sentinel */
+		    {NULL, {0}, FALSE}};
 	const gchar *invalid[] = {"'a'='b'", "123>=999", "not(1)", NULL};
 	xb_machine_set_debug_flags(xb_silo_get_machine(silo),
 				   XB_MACHINE_DEBUG_FLAG_SHOW_STACK |
@@ -327,6 +345,35 @@ xb_predicate_optimize_func(void)
 		g_assert_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
 		g_assert_null(opcodes);
 	}
+
+	/* short-circuited and() and or() */
+	for (guint i = 0; runs[i].pred != NULL; i++) {
+		gboolean result = FALSE;
+		gboolean ret;
+		g_auto(XbValueBindings) bindings = XB_VALUE_BINDINGS_INIT();
+		g_autoptr(GError) error = NULL;
+		g_autoptr(XbStack) opcodes = NULL;
+
+		g_debug("running %s", runs[i].pred);
+		opcodes = xb_machine_parse_full(xb_silo_get_machine(silo),
+						runs[i].pred,
+						-1,
+						XB_MACHINE_PARSE_FLAG_OPTIMIZE,
+						&error);
+		g_assert_no_error(error);
+		g_assert_nonnull(opcodes);
+		for (guint j = 0; j < G_N_ELEMENTS(runs[i].vals); j++)
+			xb_value_bindings_bind_val(&bindings, j, runs[i].vals[j]);
+		ret = xb_machine_run_with_bindings(xb_silo_get_machine(silo),
+						   opcodes,
+						   &bindings,
+						   &result,
+						   NULL,
+						   &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		g_assert_cmpint(result, ==, runs[i].result);
+	}
 }
 
 static void
@@ -1339,375 +1386,1533 @@ xb_builder_fixup_strip_inner_cb(XbBuilderFixup *self,
 }
 
 static void
-xb_xpath_func(void)
+xb_builder_split_layout_func(void)
 {
-	XbNode *n;
-	XbNode *n2;
 	gboolean ret;
 	g_autofree gchar *str = NULL;
-	g_autofree gchar *xml_sub1 = NULL;
-	g_autofree gchar *xml_sub2 = NULL;
-	g_autofree gchar *xml_sub3 = NULL;
+	g_autofree gchar *xml_new = NULL;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GPtrArray) results = NULL;
-	g_autoptr(XbNode) n3 = NULL;
 	g_autoptr(XbBuilder) builder = xb_builder_new();
 	g_autoptr(XbBuilderFixup) fixup = NULL;
-	g_autoptr(XbBuilderFixup) fixup2 = NULL;
-	g_autoptr(XbBuilderSource) source = xb_builder_source_new();
+	g_autoptr(XbNode) n = NULL;
 	g_autoptr(XbSilo) silo = NULL;
 	const gchar *xml = "<components origin=\"lvfs\">\n"
-			   "  <header>\n"
-			   "    <csum type=\"sha1\">dead</csum>\n"
-			   "  </header>\n"
-			   "  <component type=\"desktop\">\n"
-			   "    <id> gimp.desktop </id>\n"
-			   "    <id>org.gnome.Gimp.desktop</id>\n"
-			   "    <name>Mêẞ</name>\n"
-			   "    <custom>\n"
-			   "      <value key=\"KEY\">TRUE</value>\n"
-			   "    </custom>\n"
+			   "  <component type=\"desktop\" attr=\"value\">\n"
+			   "    <id>gimp.desktop</id>\n"
+			   "    <name>GIMP Image Editor</name>\n"
+			   "    <p>Edit <em>all</em> the images</p>\n"
 			   "  </component>\n"
 			   "  <component type=\"firmware\">\n"
 			   "    <id>org.hughski.ColorHug2.firmware</id>\n"
+			   "    <name>ColorHug Firmware</name>\n"
 			   "  </component>\n"
 			   "</components>\n";
 
-	/* tokenize specific fields */
-	fixup = xb_builder_fixup_new("TextTokenize", xb_builder_fixup_tokenize_cb, NULL, NULL);
-	xb_builder_source_add_fixup(source, fixup);
-
-	/* strip inner nodes without children */
-	fixup2 =
-	    xb_builder_fixup_new("TextStripInner", xb_builder_fixup_strip_inner_cb, NULL, NULL);
-	xb_builder_source_add_fixup(source, fixup2);
-
 	/* import from XML */
-	ret = xb_builder_source_load_xml(source, xml, XB_BUILDER_SOURCE_FLAG_NONE, &error);
+	ret = xb_test_import_xml(builder, xml, &error);
 	g_assert_no_error(error);
 	g_assert_true(ret);
-	xb_builder_import_source(builder, source);
-	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+	fixup = xb_builder_fixup_new("TextTokenize", xb_builder_fixup_tokenize_cb, NULL, NULL);
+	xb_builder_add_fixup(builder, fixup);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_SPLIT_LAYOUT, NULL, &error);
 	g_assert_no_error(error);
 	g_assert_nonnull(silo);
-
-	/* set up debugging */
-	xb_machine_set_debug_flags(xb_silo_get_machine(silo), XB_MACHINE_DEBUG_FLAG_SHOW_STACK);
-
-	/* dump to screen */
 	str = xb_silo_to_string(silo, &error);
 	g_assert_no_error(error);
 	g_assert_nonnull(str);
 	g_debug("\n%s", str);
 
-	/* query with predicate 'in' */
-	xb_silo_set_profile_flags(silo, XB_SILO_PROFILE_FLAG_OPTIMIZER);
-	n = xb_silo_query_first(
-	    silo,
-	    "components/component/id[text()=('gimp.desktop','another.desktop','dave.desktop')]",
-	    &error);
+	g_assert_cmpint(xb_silo_get_size(silo), ==, 9);
+
+	/* query on attributes, text and tokens */
+	n = xb_silo_query_first(silo, "components/component[@type='firmware']/id", &error);
 	g_assert_no_error(error);
 	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_assert_cmpstr(xb_node_get_text(n), ==, "org.hughski.ColorHug2.firmware");
 	g_clear_object(&n);
-
-	/* query with predicate 'in' -- single-entry tuple */
-	xb_silo_set_profile_flags(silo, XB_SILO_PROFILE_FLAG_OPTIMIZER);
-	n = xb_silo_query_first(silo, "components/component/id[text()=('gimp.desktop')]", &error);
+	n = xb_silo_query_first(silo, "components/component/id[text()='gimp.desktop']/..", &error);
 	g_assert_no_error(error);
 	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_assert_cmpstr(xb_node_get_attr(n, "attr"), ==, "value");
 	g_clear_object(&n);
-
-	/* query with predicate logical and */
-	n = xb_silo_query_first(
-	    silo,
-	    "components/component/custom/value[(@key='KEY') and (text()='TRUE')]/../../id",
-	    &error);
+	n = xb_silo_query_first(silo, "components/component/p/em", &error);
 	g_assert_no_error(error);
 	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
-	g_clear_object(&n);
-
-	/* query with predicate logical and; failure */
-	n = xb_silo_query_first(
-	    silo,
-	    "components/component/custom/value[(@key='KEY')&&(text()='FALSE')]/../../id",
-	    &error);
-	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
-	g_assert_null(n);
-	g_clear_error(&error);
+	g_assert_cmpstr(xb_node_get_tail(n), ==, " the images");
 	g_clear_object(&n);
 
-	/* query with predicate logical and, alternate form */
-	n = xb_silo_query_first(
-	    silo,
-	    "components/component/custom/value[and((@key='KEY'),(text()='TRUE'))]/../../id",
-	    &error);
+	/* the cold data is all still available */
+	n = xb_silo_query_first(silo, "components/component/p", &error);
 	g_assert_no_error(error);
 	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
-	g_clear_object(&n);
-
-	/* query that doesn't find anything */
-	n = xb_silo_query_first(silo, "dave", &error);
-	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
-	g_assert_null(n);
-	g_clear_error(&error);
+	xml_new = xb_node_export(n, XB_NODE_EXPORT_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	g_assert_cmpstr(xml_new, ==, "<p>Edit <em>all</em> the images</p>");
 	g_clear_object(&n);
+	results = xb_silo_query(silo, "components/component/name[search(text(),'color')]", 0, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(results);
+	g_assert_cmpint(results->len, ==, 1);
+}
 
-	n = xb_silo_query_first(silo, "dave/dave", &error);
-	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
-	g_assert_null(n);
-	g_clear_error(&error);
-	g_clear_object(&n);
+static void
+xb_builder_split_layout_truncated_func(void)
+{
+	XbSiloHeader hdr;
+	gboolean ret;
+	gsize bufsz = 0;
+	guint8 *buf;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbNode) n = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+	g_autoptr(XbSilo) silo2 = xb_silo_new();
+	const gchar *xml = "<components>\n"
+			   "  <component type=\"desktop\" origin=\"lvfs\">\n"
+			   "    <id>gimp.desktop</id>\n"
+			   "  </component>\n"
+			   "</components>\n";
 
-	n = xb_silo_query_first(silo, "components/dave", &error);
-	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
-	g_assert_null(n);
-	g_clear_error(&error);
-	g_clear_object(&n);
+	/* import from XML */
+	ret = xb_test_import_xml(builder, xml, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_SPLIT_LAYOUT, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
 
-	n = xb_silo_query_first(silo, "components/component[@type='dave']/id", &error);
-	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
-	g_assert_null(n);
-	g_clear_error(&error);
-	g_clear_object(&n);
+	/* drop the last attribute from the section directory */
+	buf = g_bytes_unref_to_data(xb_silo_get_bytes(silo), &bufsz);
+	memcpy(&hdr, buf, sizeof(hdr));
+	for (guint i = 0; i < hdr.nsections; i++) {
+		XbSiloSection sect;
+		gsize off = sizeof(XbSiloHeader) + i * sizeof(XbSiloSection);
+		memcpy(&sect, buf + off, sizeof(sect));
+		if (sect.kind != XB_SILO_SECTION_KIND_ATTRS)
+			continue;
+		sect.size -= sizeof(XbSiloNodeAttr);
+		memcpy(buf + off, &sect, sizeof(sect));
+	}
+	blob = g_bytes_new_take(buf, bufsz);
+	ret = xb_silo_load_from_bytes(silo2, blob, XB_SILO_LOAD_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
 
-	n = xb_silo_query_first(silo, "components/component[@percentage>=90]", &error);
-	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
-	g_assert_null(n);
-	g_clear_error(&error);
-	g_clear_object(&n);
+	/* the attribute past the end of the section is not read */
+	n = xb_silo_query_first(silo2, "components/component", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_attr(n, "type"), ==, "desktop");
+	g_test_expect_message("XbSilo", G_LOG_LEVEL_CRITICAL, "*outside the attrs section*");
+	g_assert_null(xb_node_get_attr(n, "origin"));
+	g_test_assert_expected_messages();
+}
 
-	n = xb_silo_query_first(silo, "components/component/id[text()='dave']", &error);
-	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
-	g_assert_null(n);
-	g_clear_error(&error);
-	g_clear_object(&n);
+static void
+xb_builder_wide_offsets_func(void)
+{
+	gboolean ret;
+	g_autofree gchar *str = NULL;
+	g_autofree gchar *xml_new = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbNode) n = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+	g_autoptr(XbSilo) silo2 = xb_silo_new();
+	const gchar *xml = "<components origin=\"lvfs\">\n"
+			   "  <component type=\"desktop\">\n"
+			   "    <id>gimp.desktop</id>\n"
+			   "    <name>GIMP</name>\n"
+			   "  </component>\n"
+			   "  <component type=\"firmware\">\n"
+			   "    <id>org.hughski.ColorHug2.firmware</id>\n"
+			   "  </component>\n"
+			   "</components>\n";
 
-	/* query with attr opcodes */
-	n = xb_silo_query_first(silo, "components/component[@type='firmware']/id", &error);
+	/* import from XML */
+	ret = xb_test_import_xml(builder, xml, &error);
 	g_assert_no_error(error);
-	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "org.hughski.ColorHug2.firmware");
-	g_clear_object(&n);
+	g_assert_true(ret);
+	silo = xb_builder_compile(builder,
+				  XB_BUILDER_COMPILE_FLAG_WIDE_OFFSETS |
+				      XB_BUILDER_COMPILE_FLAG_SPLIT_LAYOUT,
+				  NULL,
+				  &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+	str = xb_silo_to_string(silo, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(g_strstr_len(str, -1, "version:      00010009"));
 
-	/* query with attr opcodes */
-	n = xb_silo_query_first(silo, "components/component[@type!='firmware']/id", &error);
+	/* reload the blob */
+	bytes = xb_silo_get_bytes(silo);
+	ret = xb_silo_load_from_bytes(silo2, bytes, XB_SILO_LOAD_FLAG_NONE, &error);
 	g_assert_no_error(error);
-	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
-	g_clear_object(&n);
+	g_assert_true(ret);
+	xml_new = xb_silo_export(silo2,
+				 XB_NODE_EXPORT_FLAG_FORMAT_MULTILINE |
+				     XB_NODE_EXPORT_FLAG_FORMAT_INDENT,
+				 &error);
+	g_assert_no_error(error);
+	g_assert_cmpstr(xml, ==, xml_new);
 
-	/* query with attr opcodes with quotes */
-	n = xb_silo_query_first(silo, "components/component[@type='firmware']/id", &error);
+	/* navigate up and across */
+	n = xb_silo_query_first(silo2,
+				"components/component/id[text()='gimp.desktop']/../name",
+				&error);
 	g_assert_no_error(error);
 	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "org.hughski.ColorHug2.firmware");
+	g_assert_cmpstr(xb_node_get_text(n), ==, "GIMP");
 	g_clear_object(&n);
-
-	/* query with position */
-	n = xb_silo_query_first(silo, "components/component[2]/id", &error);
+	n = xb_silo_query_first(silo2, "components/component[last()]", &error);
 	g_assert_no_error(error);
 	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "org.hughski.ColorHug2.firmware");
-	g_clear_object(&n);
+	g_assert_cmpstr(xb_node_get_attr(n, "type"), ==, "firmware");
+}
 
-	/* last() with position */
-	n = xb_silo_query_first(silo, "components/component[last()]/id", &error);
+static void
+xb_builder_casefold_func(void)
+{
+	gboolean ret;
+	g_autofree gchar *str = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) results = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbNode) n = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+	const gchar *xml = "<components origin=\"lvfs\">\n"
+			   "  <component type=\"desktop\">\n"
+			   "    <id>gimp.desktop</id>\n"
+			   "    <name>GIMP</name>\n"
+			   "  </component>\n"
+			   "  <component type=\"firmware\">\n"
+			   "    <id>org.hughski.ColorHug2.firmware</id>\n"
+			   "    <name>ColorHug</name>\n"
+			   "  </component>\n"
+			   "</components>\n";
+
+	/* import from XML */
+	ret = xb_test_import_xml(builder, xml, &error);
 	g_assert_no_error(error);
-	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "org.hughski.ColorHug2.firmware");
-	g_clear_object(&n);
+	g_assert_true(ret);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_CASEFOLD, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+	str = xb_silo_to_string(silo, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(g_strstr_len(str, -1, "section:      8"));
+	g_assert_nonnull(g_strstr_len(str, -1, "section:      9"));
 
-	/* query with attr opcodes that exists */
-	n = xb_silo_query_first(silo, "components/component[@type]/id", &error);
+	/* the folded strings are already in the strtab */
+	n = xb_silo_query_first(silo,
+				"components/component/name[lower-case(text())='gimp']/../id",
+				&error);
 	g_assert_no_error(error);
 	g_assert_nonnull(n);
 	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
 	g_clear_object(&n);
-
-	/* query with attrs that do not exist */
-	n = xb_silo_query_first(silo, "components/component[not(@dave)]/id", &error);
+	n = xb_silo_query_first(silo,
+				"components/component[upper-case(attr('type'))='FIRMWARE']/name",
+				&error);
 	g_assert_no_error(error);
 	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_assert_cmpstr(xb_node_get_text(n), ==, "ColorHug");
 	g_clear_object(&n);
 
-	/* query with wildcard with predicate */
-	n = xb_silo_query_first(silo, "components/*[@type]/id", &error);
+	/* strings that do not change, and literals that are not in the strtab */
+	results = xb_silo_query(silo,
+				"components/component/id[lower-case(text())=text()]",
+				0,
+				&error);
+	g_assert_no_error(error);
+	g_assert_nonnull(results);
+	g_assert_cmpint(results->len, ==, 1);
+	n = xb_silo_query_first(silo,
+				"components/component/name[upper-case(text())='COLORHUG']",
+				&error);
 	g_assert_no_error(error);
 	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
 	g_clear_object(&n);
-
+	n = xb_silo_query_first(silo,
+				"components/component/name[lower-case(text())='colorhug2']",
+				&error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+	g_assert_null(n);
+}
+
+static void
+xb_builder_numeric_func(void)
+{
+	XbBuilderCompileFlags flags[] = {XB_BUILDER_COMPILE_FLAG_NONE,
+					 XB_BUILDER_COMPILE_FLAG_NUMERIC};
+	const gchar *xml = "<components>\n"
+			   "  <component priority=\"5\">\n"
+			   "    <id>gimp.desktop</id>\n"
+			   "    <size>1024</size>\n"
+			   "  </component>\n"
+			   "  <component priority=\"10\">\n"
+			   "    <id>inkscape.desktop</id>\n"
+			   "    <size>512</size>\n"
+			   "  </component>\n"
+			   "  <component priority=\"high\">\n"
+			   "    <id>dave.desktop</id>\n"
+			   "  </component>\n"
+			   "</components>\n";
+
+	for (guint i = 0; i < G_N_ELEMENTS(flags); i++) {
+		gboolean ret;
+		g_autofree gchar *str = NULL;
+		g_autoptr(GError) error = NULL;
+		g_autoptr(GPtrArray) results = NULL;
+		g_autoptr(XbBuilder) builder = xb_builder_new();
+		g_autoptr(XbNode) n = NULL;
+		g_autoptr(XbQuery) query = NULL;
+		g_autoptr(XbSilo) silo = NULL;
+
+		/* import from XML */
+		ret = xb_test_import_xml(builder, xml, &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		silo = xb_builder_compile(builder, flags[i], NULL, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(silo);
+
+		/* compared as numbers, not as strings or string table offsets */
+		query = xb_query_new(silo, "components/component[@priority>5]/id", &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(query);
+		str = xb_query_to_string(query);
+		g_assert_nonnull(g_strstr_len(str, -1, "attr-number()"));
+		results = xb_silo_query_with_context(silo, query, NULL, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(results);
+		g_assert_cmpint(results->len, ==, 1);
+		n = g_object_ref(g_ptr_array_index(results, 0));
+		g_assert_cmpstr(xb_node_get_text(n), ==, "inkscape.desktop");
+		g_clear_object(&n);
+		n = xb_silo_query_first(silo, "components/component[@priority=5]/id", &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(n);
+		g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+		g_clear_object(&n);
+		n = xb_silo_query_first(silo,
+					"components/component/size[text()<1000]/../id",
+					&error);
+		g_assert_no_error(error);
+		g_assert_nonnull(n);
+		g_assert_cmpstr(xb_node_get_text(n), ==, "inkscape.desktop");
+	}
+}
+
+static void
+xb_builder_version_keys_func(void)
+{
+	XbBuilderCompileFlags flags[] = {XB_BUILDER_COMPILE_FLAG_NONE,
+					 XB_BUILDER_COMPILE_FLAG_VERSION_KEYS};
+	const gchar *xml = "<releases>\n"
+			   "  <release version=\"1.2.3\"/>\n"
+			   "  <release version=\"1.10.0\"/>\n"
+			   "  <release version=\"2:0.1\"/>\n"
+			   "  <release version=\"1.2~rc1\"/>\n"
+			   "</releases>\n";
+
+	/* compared segment by segment, not as strings */
+	g_assert_cmpint(xb_string_vercmp("1.2.3", "1.2.3"), ==, 0);
+	g_assert_cmpint(xb_string_vercmp("1.10.0", "1.9"), >, 0);
+	g_assert_cmpint(xb_string_vercmp("1.2~rc1", "1.2"), <, 0);
+	g_assert_cmpint(xb_string_vercmp("2:0.1", "1.10.0"), >, 0);
+
+	for (guint i = 0; i < G_N_ELEMENTS(flags); i++) {
+		gboolean ret;
+		g_autoptr(GError) error = NULL;
+		g_autoptr(GPtrArray) results = NULL;
+		g_autoptr(XbBuilder) builder = xb_builder_new();
+		g_autoptr(XbNode) n = NULL;
+		g_autoptr(XbSilo) silo = NULL;
+
+		/* import from XML */
+		ret = xb_test_import_xml(builder, xml, &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		silo = xb_builder_compile(builder, flags[i], NULL, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(silo);
+
+		results = xb_silo_query(silo,
+					"releases/release[vercmp(@version,'>=','1.9')]",
+					0,
+					&error);
+		g_assert_no_error(error);
+		g_assert_nonnull(results);
+		g_assert_cmpint(results->len, ==, 2);
+		n = xb_silo_query_first(silo,
+					"releases/release[vercmp(@version,'<','1.2')]",
+					&error);
+		g_assert_no_error(error);
+		g_assert_nonnull(n);
+		g_assert_cmpstr(xb_node_get_attr(n, "version"), ==, "1.2~rc1");
+		g_clear_object(&n);
+
+		/* unknown comparison */
+		n = xb_silo_query_first(silo,
+					"releases/release[vercmp(@version,'~','1.2')]",
+					&error);
+		g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED);
+		g_assert_null(n);
+	}
+}
+
+static void
+xb_builder_stem_func(void)
+{
+	XbBuilderCompileFlags flags[] = {XB_BUILDER_COMPILE_FLAG_NONE,
+					 XB_BUILDER_COMPILE_FLAG_STEM};
+	const gchar *xml = "<components>\n"
+			   "  <component>\n"
+			   "    <id>runner.desktop</id>\n"
+			   "    <name>Running</name>\n"
+			   "    <name xml:lang=\"de\">Katzen</name>\n"
+			   "  </component>\n"
+			   "</components>\n";
+
+	for (guint i = 0; i < G_N_ELEMENTS(flags); i++) {
+		gboolean ret;
+		g_autoptr(GError) error = NULL;
+		g_autoptr(XbBuilder) builder = xb_builder_new();
+		g_autoptr(XbNode) n = NULL;
+		g_autoptr(XbSilo) silo = NULL;
+
+		/* import from XML */
+		ret = xb_test_import_xml(builder, xml, &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		silo = xb_builder_compile(builder, flags[i], NULL, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(silo);
+
+		/* the language of each node is used */
+#ifdef HAVE_LIBSTEMMER
+		n = xb_silo_query_first(silo,
+					"components/component/name[stem(text())='run']",
+					&error);
+		g_assert_no_error(error);
+		g_assert_nonnull(n);
+		g_assert_cmpstr(xb_node_get_text(n), ==, "Running");
+		g_clear_object(&n);
+		n = xb_silo_query_first(silo,
+					"components/component/name[stem(text())='katz']",
+					&error);
+		g_assert_no_error(error);
+		g_assert_nonnull(n);
+		g_assert_cmpstr(xb_node_get_text(n), ==, "Katzen");
+		g_clear_object(&n);
+
+		/* literals are stemmed using the language of the node too */
+		n = xb_silo_query_first(silo,
+					"components/component/name[stem(text())=stem('Katzen')]",
+					&error);
+		g_assert_no_error(error);
+		g_assert_nonnull(n);
+		g_assert_cmpstr(xb_node_get_text(n), ==, "Katzen");
+		g_clear_object(&n);
+#else
+		n = xb_silo_query_first(silo,
+					"components/component/name[stem(text())='running']",
+					&error);
+		g_assert_no_error(error);
+		g_assert_nonnull(n);
+		g_assert_cmpstr(xb_node_get_text(n), ==, "Running");
+		g_clear_object(&n);
+#endif
+	}
+}
+
+static void
+xb_builder_stem_literal_func(void)
+{
+	gboolean ret;
+	g_autofree gchar *str = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) results = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbNode) n = NULL;
+	g_autoptr(XbQuery) query = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+	const gchar *xml = "<components>\n"
+			   "  <component>\n"
+			   "    <id>runner.desktop</id>\n"
+			   "    <name>Running</name>\n"
+			   "  </component>\n"
+			   "</components>\n";
+
+	/* import from XML */
+	ret = xb_test_import_xml(builder, xml, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_STEM, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+
+	/* no node has a language, so the literal is only stemmed once */
+	query = xb_query_new(silo,
+			     "components/component/name[stem(text())=stem('Running')]",
+			     &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(query);
+	str = xb_query_to_string(query);
+	g_assert_null(g_strstr_len(str, -1, "'Running'"));
+	results = xb_silo_query_with_context(silo, query, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(results);
+	g_assert_cmpint(results->len, ==, 1);
+	n = g_object_ref(g_ptr_array_index(results, 0));
+	g_assert_cmpstr(xb_node_get_text(n), ==, "Running");
+}
+
+static gboolean
+xb_builder_trigram_index_cb(XbBuilderFixup *self,
+			    XbBuilderNode *bn,
+			    gpointer user_data,
+			    GError **error)
+{
+	if (g_strcmp0(xb_builder_node_get_element(bn), "name") == 0)
+		xb_builder_node_add_flag(bn, XB_BUILDER_NODE_FLAG_TRIGRAM_INDEX);
+	return TRUE;
+}
+
+static XbSilo *
+xb_builder_trigram_index_compile(gboolean use_index, XbBuilderCompileFlags flags, GError **error)
+{
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbBuilderSource) source = xb_builder_source_new();
+	const gchar *xml = "<components>\n"
+			   "  <component>\n"
+			   "    <id>texteditor.desktop</id>\n"
+			   "    <name summary=\"Edit plain text\">Text Editor</name>\n"
+			   "  </component>\n"
+			   "  <component>\n"
+			   "    <id>imageeditor.desktop</id>\n"
+			   "    <name summary=\"Edit photos\">Image Editor</name>\n"
+			   "  </component>\n"
+			   "  <component>\n"
+			   "    <id>calculator.desktop</id>\n"
+			   "    <name summary=\"Add numbers\">Calculator</name>\n"
+			   "  </component>\n"
+			   "</components>\n";
+
+	if (use_index) {
+		g_autoptr(XbBuilderFixup) fixup =
+		    xb_builder_fixup_new("TrigramIndex", xb_builder_trigram_index_cb, NULL, NULL);
+		xb_builder_source_add_fixup(source, fixup);
+	}
+	if (!xb_builder_source_load_xml(source, xml, XB_BUILDER_SOURCE_FLAG_NONE, error))
+		return NULL;
+	xb_builder_import_source(builder, source);
+	return xb_builder_compile(builder, flags, NULL, error);
+}
+
+static void
+xb_builder_trigram_index_func(void)
+{
+	struct {
+		const gchar *search;
+		guint results;
+	} tests[] = {{"Text", 1},
+		     {"ditor", 2},
+		     {"ator", 1},
+		     {"or", 3}, /* shorter than a trigram */
+		     {"Text Calc", 0},
+		     {"edit", 0},
+		     {"xyz", 0}};
+	struct {
+		const gchar *search;
+		guint results;
+	} tests_attr[] = {{"Edit", 2}, {"plain", 1}, {"numbers", 1}, {"Add photos", 0}};
+	g_autoptr(GError) error = NULL;
+
+	/* the same results with and without the index */
+	for (guint j = 0; j < 2; j++) {
+		g_autoptr(XbSilo) silo = NULL;
+		silo = xb_builder_trigram_index_compile(j == 1,
+							XB_BUILDER_COMPILE_FLAG_NONE,
+							&error);
+		g_assert_no_error(error);
+		g_assert_nonnull(silo);
+		for (guint i = 0; i < G_N_ELEMENTS(tests); i++) {
+			g_autofree gchar *xpath = NULL;
+			g_autoptr(GError) error_local = NULL;
+			g_autoptr(GPtrArray) results = NULL;
+
+			xpath = g_strdup_printf("components/component/name[contains(text(),'%s')]",
+						tests[i].search);
+			results = xb_silo_query(silo, xpath, 0, &error_local);
+			if (tests[i].results == 0) {
+				g_assert_error(error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+				g_assert_null(results);
+				continue;
+			}
+			g_assert_no_error(error_local);
+			g_assert_nonnull(results);
+			g_assert_cmpint(results->len, ==, tests[i].results);
+		}
+
+		/* attribute values are indexed too */
+		for (guint i = 0; i < G_N_ELEMENTS(tests_attr); i++) {
+			g_autofree gchar *xpath = NULL;
+			g_autoptr(GError) error_local = NULL;
+			g_autoptr(GPtrArray) results = NULL;
+
+			xpath =
+			    g_strdup_printf("components/component/name[contains(@summary,'%s')]",
+					    tests_attr[i].search);
+			results = xb_silo_query(silo, xpath, 0, &error_local);
+			if (tests_attr[i].results == 0) {
+				g_assert_error(error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+				g_assert_null(results);
+				continue;
+			}
+			g_assert_no_error(error_local);
+			g_assert_nonnull(results);
+			g_assert_cmpint(results->len, ==, tests_attr[i].results);
+		}
+	}
+}
+
+static void
+xb_builder_trigram_index_speed_func(void)
+{
+	guint n_components = 10000;
+	guint n_queries = 100;
+	gdouble elapsed[2] = {0};
+	const gchar *xpath = "components/component/name[contains(text(),'004242')]";
+	g_autoptr(GString) xml = g_string_new(NULL);
+	g_autoptr(GTimer) timer = g_timer_new();
+	g_autoptr(XbBuilderFixup) fixup =
+	    xb_builder_fixup_new("TrigramIndex", xb_builder_trigram_index_cb, NULL, NULL);
+
+	/* only one name has the needle, and the rest have to be searched in full */
+	g_string_append(xml, "<components>");
+	for (guint i = 0; i < n_components; i++) {
+		g_string_append_printf(xml,
+				       "<component><name>%06u %s</name></component>",
+				       i,
+				       "An editor for plain text, source code and markup with "
+				       "syntax highlighting, spell checking and a file browser");
+	}
+	g_string_append(xml, "</components>");
+
+	for (guint j = 0; j < 2; j++) {
+		g_autoptr(GError) error = NULL;
+		g_autoptr(XbBuilder) builder = xb_builder_new();
+		g_autoptr(XbBuilderSource) source = xb_builder_source_new();
+		g_autoptr(XbSilo) silo = NULL;
+
+		if (j == 1)
+			xb_builder_source_add_fixup(source, fixup);
+		xb_builder_source_load_xml(source, xml->str, XB_BUILDER_SOURCE_FLAG_NONE, &error);
+		g_assert_no_error(error);
+		xb_builder_import_source(builder, source);
+		silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(silo);
+
+		g_timer_reset(timer);
+		for (guint i = 0; i < n_queries; i++) {
+			g_autoptr(GPtrArray) results = NULL;
+			results = xb_silo_query(silo, xpath, 0, &error);
+			g_assert_no_error(error);
+			g_assert_nonnull(results);
+			g_assert_cmpint(results->len, ==, 1);
+		}
+		elapsed[j] = g_timer_elapsed(timer, NULL) * 1000;
+	}
+	g_print("contains[x%u]: %.3fms, with index: %.3fms\n", n_queries, elapsed[0], elapsed[1]);
+	g_assert_cmpfloat(elapsed[1], <, elapsed[0]);
+}
+
+static void
+xb_xpath_func(void)
+{
+	XbNode *n;
+	XbNode *n2;
+	gboolean ret;
+	g_autofree gchar *str = NULL;
+	g_autofree gchar *xml_sub1 = NULL;
+	g_autofree gchar *xml_sub2 = NULL;
+	g_autofree gchar *xml_sub3 = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) results = NULL;
+	g_autoptr(XbNode) n3 = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbBuilderFixup) fixup = NULL;
+	g_autoptr(XbBuilderFixup) fixup2 = NULL;
+	g_autoptr(XbBuilderSource) source = xb_builder_source_new();
+	g_autoptr(XbSilo) silo = NULL;
+	const gchar *xml = "<components origin=\"lvfs\">\n"
+			   "  <header>\n"
+			   "    <csum type=\"sha1\">dead</csum>\n"
+			   "  </header>\n"
+			   "  <component type=\"desktop\">\n"
+			   "    <id> gimp.desktop </id>\n"
+			   "    <id>org.gnome.Gimp.desktop</id>\n"
+			   "    <name>Mêẞ</name>\n"
+			   "    <custom>\n"
+			   "      <value key=\"KEY\">TRUE</value>\n"
+			   "    </custom>\n"
+			   "  </component>\n"
+			   "  <component type=\"firmware\">\n"
+			   "    <id>org.hughski.ColorHug2.firmware</id>\n"
+			   "  </component>\n"
+			   "</components>\n";
+
+	/* tokenize specific fields */
+	fixup = xb_builder_fixup_new("TextTokenize", xb_builder_fixup_tokenize_cb, NULL, NULL);
+	xb_builder_source_add_fixup(source, fixup);
+
+	/* strip inner nodes without children */
+	fixup2 =
+	    xb_builder_fixup_new("TextStripInner", xb_builder_fixup_strip_inner_cb, NULL, NULL);
+	xb_builder_source_add_fixup(source, fixup2);
+
+	/* import from XML */
+	ret = xb_builder_source_load_xml(source, xml, XB_BUILDER_SOURCE_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	xb_builder_import_source(builder, source);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+
+	/* set up debugging */
+	xb_machine_set_debug_flags(xb_silo_get_machine(silo), XB_MACHINE_DEBUG_FLAG_SHOW_STACK);
+
+	/* dump to screen */
+	str = xb_silo_to_string(silo, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(str);
+	g_debug("\n%s", str);
+
+	/* query with predicate 'in' */
+	xb_silo_set_profile_flags(silo, XB_SILO_PROFILE_FLAG_OPTIMIZER);
+	n = xb_silo_query_first(
+	    silo,
+	    "components/component/id[text()=('gimp.desktop','another.desktop','dave.desktop')]",
+	    &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_clear_object(&n);
+
+	/* query with predicate 'in' -- single-entry tuple */
+	xb_silo_set_profile_flags(silo, XB_SILO_PROFILE_FLAG_OPTIMIZER);
+	n = xb_silo_query_first(silo, "components/component/id[text()=('gimp.desktop')]", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_clear_object(&n);
+
+	/* query with predicate logical and */
+	n = xb_silo_query_first(
+	    silo,
+	    "components/component/custom/value[(@key='KEY') and (text()='TRUE')]/../../id",
+	    &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_clear_object(&n);
+
+	/* query with predicate logical and; failure */
+	n = xb_silo_query_first(
+	    silo,
+	    "components/component/custom/value[(@key='KEY')&&(text()='FALSE')]/../../id",
+	    &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+	g_assert_null(n);
+	g_clear_error(&error);
+	g_clear_object(&n);
+
+	/* query with predicate logical and, alternate form */
+	n = xb_silo_query_first(
+	    silo,
+	    "components/component/custom/value[and((@key='KEY'),(text()='TRUE'))]/../../id",
+	    &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_clear_object(&n);
+
+	/* query that doesn't find anything */
+	n = xb_silo_query_first(silo, "dave", &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+	g_assert_null(n);
+	g_clear_error(&error);
+	g_clear_object(&n);
+
+	n = xb_silo_query_first(silo, "dave/dave", &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+	g_assert_null(n);
+	g_clear_error(&error);
+	g_clear_object(&n);
+
+	n = xb_silo_query_first(silo, "components/dave", &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+	g_assert_null(n);
+	g_clear_error(&error);
+	g_clear_object(&n);
+
+	n = xb_silo_query_first(silo, "components/component[@type='dave']/id", &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+	g_assert_null(n);
+	g_clear_error(&error);
+	g_clear_object(&n);
+
+	n = xb_silo_query_first(silo, "components/component[@percentage>=90]", &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+	g_assert_null(n);
+	g_clear_error(&error);
+	g_clear_object(&n);
+
+	n = xb_silo_query_first(silo, "components/component/id[text()='dave']", &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+	g_assert_null(n);
+	g_clear_error(&error);
+	g_clear_object(&n);
+
+	/* query with attr opcodes */
+	n = xb_silo_query_first(silo, "components/component[@type='firmware']/id", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "org.hughski.ColorHug2.firmware");
+	g_clear_object(&n);
+
+	/* query with attr opcodes */
+	n = xb_silo_query_first(silo, "components/component[@type!='firmware']/id", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_clear_object(&n);
+
+	/* query with attr opcodes with quotes */
+	n = xb_silo_query_first(silo, "components/component[@type='firmware']/id", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "org.hughski.ColorHug2.firmware");
+	g_clear_object(&n);
+
+	/* query with position */
+	n = xb_silo_query_first(silo, "components/component[2]/id", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "org.hughski.ColorHug2.firmware");
+	g_clear_object(&n);
+
+	/* last() with position */
+	n = xb_silo_query_first(silo, "components/component[last()]/id", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "org.hughski.ColorHug2.firmware");
+	g_clear_object(&n);
+
+	/* query with attr opcodes that exists */
+	n = xb_silo_query_first(silo, "components/component[@type]/id", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_clear_object(&n);
+
+	/* query with attrs that do not exist */
+	n = xb_silo_query_first(silo, "components/component[not(@dave)]/id", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_clear_object(&n);
+
+	/* query with wildcard with predicate */
+	n = xb_silo_query_first(silo, "components/*[@type]/id", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_clear_object(&n);
+
 	/* query with text opcodes */
 	n = xb_silo_query_first(silo, "components/header/csum[text()='dead']", &error);
 	g_assert_no_error(error);
 	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_attr(n, "type"), ==, "sha1");
+	g_assert_cmpstr(xb_node_get_attr(n, "type"), ==, "sha1");
+	g_clear_object(&n);
+
+	/* query with search */
+	n = xb_silo_query_first(silo, "components/component/id[text()~='gimp']", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_clear_object(&n);
+
+	/* query no normalize */
+	n = xb_silo_query_first(silo, "components/component/name", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "Mêẞ");
+	g_clear_object(&n);
+
+	/* query name not UTF-8 */
+	n = xb_silo_query_first(silo, "components/component/name[text()~='mEss']/../id", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_clear_object(&n);
+
+	/* query with stem */
+#ifdef HAVE_LIBSTEMMER
+	xb_machine_set_debug_flags(xb_silo_get_machine(silo),
+				   XB_MACHINE_DEBUG_FLAG_SHOW_STACK |
+				       XB_MACHINE_DEBUG_FLAG_SHOW_PARSING);
+	n = xb_silo_query_first(silo, "components/component/id[text()~=stem('gimping')]", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_clear_object(&n);
+	xb_machine_set_debug_flags(xb_silo_get_machine(silo), XB_MACHINE_DEBUG_FLAG_SHOW_STACK);
+#endif
+
+	/* query with text:integer */
+	n = xb_silo_query_first(silo, "components/component/id['123'=123]", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_clear_object(&n);
+
+	/* query with integer:text */
+	n = xb_silo_query_first(silo, "components/component/id[123='123']", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_clear_object(&n);
+
+	/* query with prefix */
+	n = xb_silo_query_first(silo,
+				"components/component/id[starts-with(text(),'gimp')]",
+				&error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_clear_object(&n);
+
+	/* query with suffix */
+	n = xb_silo_query_first(silo,
+				"components/component/id[ends-with(text(),'.desktop')]",
+				&error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_clear_object(&n);
+
+	/* query with contains */
+	n = xb_silo_query_first(silo, "components/component/id[contains(text(),'imp')]", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_clear_object(&n);
+
+	/* query with type-conversion */
+	n = xb_silo_query_first(silo, "components/component[position()=number('2')]/id", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "org.hughski.ColorHug2.firmware");
+	g_clear_object(&n);
+
+	/* query with another type-conversion */
+	n = xb_silo_query_first(silo, "components/component['2'=string(2)]/id", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
 	g_clear_object(&n);
 
-	/* query with search */
-	n = xb_silo_query_first(silo, "components/component/id[text()~='gimp']", &error);
+	/* query with backtrack */
+	g_debug("\n%s", xml);
+	n = xb_silo_query_first(
+	    silo,
+	    "components/component[@type='firmware']/id[text()='org.hughski.ColorHug2.firmware']",
+	    &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "org.hughski.ColorHug2.firmware");
+	g_clear_object(&n);
+
+	/* query with nesting */
+	g_debug("\n%s", xml);
+	n = xb_silo_query_first(
+	    silo,
+	    "components/component/id[text()=lower-case(upper-case('Gimp.DESKTOP'))]",
+	    &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_clear_object(&n);
+
+	/* query for multiple results */
+	results = xb_silo_query(silo, "components/component/id", 5, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(results);
+	g_assert_cmpint(results->len, ==, 3);
+	n2 = g_ptr_array_index(results, 2);
+	g_assert_cmpstr(xb_node_get_text(n2), ==, "org.hughski.ColorHug2.firmware");
+
+	/* subtree export */
+	xml_sub1 = xb_node_export(n2, XB_NODE_EXPORT_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(xml_sub1);
+	g_assert_cmpstr(xml_sub1, ==, "<id>org.hughski.ColorHug2.firmware</id>");
+
+	/* parent of subtree */
+	n3 = xb_node_get_parent(n2);
+	g_assert(n3 != NULL);
+	xml_sub2 = xb_node_export(n3, XB_NODE_EXPORT_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(xml_sub2);
+	g_assert_cmpstr(
+	    xml_sub2,
+	    ==,
+	    "<component type=\"firmware\"><id>org.hughski.ColorHug2.firmware</id></component>");
+
+	/* only children of parent */
+	xml_sub3 = xb_node_export(n3, XB_NODE_EXPORT_FLAG_ONLY_CHILDREN, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(xml_sub3);
+	g_assert_cmpstr(xml_sub3, ==, "<id>org.hughski.ColorHug2.firmware</id>");
+}
+
+static void
+xb_builder_native_lang_func(void)
+{
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *str = NULL;
+	g_autofree gchar *tmp = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbNode) n = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+	const gchar *xml = "<components>\n"
+			   "  <component>\n"
+			   "    <p xml:lang=\"de_DE\">Wilcommen</p>\n"
+			   "    <p>Hello</p>\n"
+			   "    <p xml:lang=\"fr\">Salut</p>\n"
+			   "    <p>Goodbye</p>\n"
+			   "    <p xml:lang=\"de_DE\">Auf Wiedersehen</p>\n"
+			   "    <p xml:lang=\"fr\">Au revoir</p>\n"
+			   "  </component>\n"
+			   "</components>\n";
+
+	/* import from XML */
+	ret = xb_test_import_xml(builder, xml, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	xb_builder_add_locale(builder, "fr_FR.UTF-8");
+	xb_builder_add_locale(builder, "fr_FR");
+	xb_builder_add_locale(builder, "fr_FR");
+	xb_builder_add_locale(builder, "fr");
+	xb_builder_add_locale(builder, "C");
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_SINGLE_LANG, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+
+	/* test we removed other languages */
+	str = xb_silo_to_string(silo, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(str);
+	g_debug("\n%s", str);
+	g_assert_null(g_strstr_len(str, -1, "Wilcommen"));
+	g_assert_null(g_strstr_len(str, -1, "Hello"));
+	g_assert_nonnull(g_strstr_len(str, -1, "Salut"));
+	g_assert_null(g_strstr_len(str, -1, "Goodbye"));
+	g_assert_null(g_strstr_len(str, -1, "Auf Wiedersehen"));
+	g_assert_nonnull(g_strstr_len(str, -1, "Au revoir"));
+
+	/* test we traversed the tree correctly */
+	n = xb_silo_query_first(silo, "components/component/*", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	tmp = xb_node_export(n, XB_NODE_EXPORT_FLAG_INCLUDE_SIBLINGS, &error);
+	g_assert_cmpstr(tmp, ==, "<p xml:lang=\"fr\">Salut</p><p xml:lang=\"fr\">Au revoir</p>");
+}
+
+static void
+xb_builder_comments_func(void)
+{
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *str = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbSilo) silo = NULL;
+	const gchar *xml = "<?xml version=\"1.0\" ?>\n"
+			   "<components>\n"
+			   "  <!-- one -->\n"
+			   "  <!-- two -->\n"
+			   "</components>\n";
+
+	/* import XML */
+	ret = xb_test_import_xml(builder, xml, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+
+	/* export */
+	str = xb_silo_export(silo, XB_NODE_EXPORT_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	g_assert_cmpstr(str, ==, "<components></components>");
+}
+
+static void
+xb_builder_native_lang2_func(void)
+{
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *str = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbSilo) silo = NULL;
+	const gchar *xml = "<components>\n"
+			   "  <component>\n"
+			   "    <description xml:lang=\"de_DE\"><p>Wilcommen</p></description>\n"
+			   "    <description><p>Hello</p></description>\n"
+			   "    <description xml:lang=\"fr\"><p>Salut</p></description>\n"
+			   "  </component>\n"
+			   "</components>\n";
+
+	/* import from XML */
+	ret = xb_test_import_xml(builder, xml, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	xb_builder_add_locale(builder, "fr_FR");
+	xb_builder_add_locale(builder, "fr");
+	xb_builder_add_locale(builder, "C");
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_SINGLE_LANG, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+
+	/* test we removed other languages */
+	str = xb_silo_to_string(silo, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(str);
+	g_assert_null(g_strstr_len(str, -1, "Wilcommen"));
+	g_assert_null(g_strstr_len(str, -1, "Hello"));
+	g_assert_nonnull(g_strstr_len(str, -1, "Salut"));
+	g_debug("\n%s", str);
+}
+
+static void
+xb_builder_native_lang_no_locales_func(void)
+{
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbSilo) silo = NULL;
+
+	/* import from XML */
+	ret = xb_test_import_xml(builder, "<id>gimp.desktop</id>", &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_SINGLE_LANG, NULL, &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_assert_null(silo);
+}
+
+static void
+xb_xpath_parent_func(void)
+{
+	XbNode *n;
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbSilo) silo = NULL;
+	const gchar *xml = "<components origin=\"lvfs\">\n"
+			   "  <header>\n"
+			   "    <csum type=\"sha1\">dead</csum>\n"
+			   "  </header>\n"
+			   "  <component type=\"desktop\">\n"
+			   "    <id>gimp.desktop</id>\n"
+			   "    <id>org.gnome.Gimp.desktop</id>\n"
+			   "  </component>\n"
+			   "  <component type=\"firmware\">\n"
+			   "    <id>org.hughski.ColorHug2.firmware</id>\n"
+			   "    <pkgname>colorhug-client</pkgname>\n"
+			   "    <description xml:lang=\"de_DE\"><p>Wilcommen!</p></description>\n"
+			   "    <description><p>hello!</p></description>\n"
+			   "    <description xml:lang=\"fr_FR\"><p>Bonjour!</p></description>\n"
+			   "    <project_license>GPL-2.0</project_license>\n"
+			   "  </component>\n"
+			   "</components>\n";
+
+	/* import from XML */
+	ret = xb_test_import_xml(builder, xml, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	xb_builder_add_locale(builder, "C");
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NATIVE_LANGS, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+
+	/* get node, no parent */
+	n = xb_silo_query_first(silo, "components/component[@type='firmware']/id", &error);
 	g_assert_no_error(error);
 	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_assert_cmpstr(xb_node_get_text(n), ==, "org.hughski.ColorHug2.firmware");
+	g_assert_cmpstr(xb_node_get_element(n), ==, "id");
 	g_clear_object(&n);
 
-	/* query no normalize */
-	n = xb_silo_query_first(silo, "components/component/name", &error);
+	/* get node, one parent */
+	n = xb_silo_query_first(silo, "components/component[@type='firmware']/id/..", &error);
 	g_assert_no_error(error);
 	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "Mêẞ");
+	g_assert_cmpstr(xb_node_get_element(n), ==, "component");
 	g_clear_object(&n);
 
-	/* query name not UTF-8 */
-	n = xb_silo_query_first(silo, "components/component/name[text()~='mEss']/../id", &error);
+	/* get node, multiple parents */
+	n = xb_silo_query_first(silo, "components/component[@type='firmware']/id/../..", &error);
 	g_assert_no_error(error);
 	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_assert_cmpstr(xb_node_get_element(n), ==, "components");
 	g_clear_object(&n);
 
-	/* query with stem */
-#ifdef HAVE_LIBSTEMMER
-	xb_machine_set_debug_flags(xb_silo_get_machine(silo),
-				   XB_MACHINE_DEBUG_FLAG_SHOW_STACK |
-				       XB_MACHINE_DEBUG_FLAG_SHOW_PARSING);
-	n = xb_silo_query_first(silo, "components/component/id[text()~=stem('gimping')]", &error);
+	/* descend, ascend, descend */
+	n = xb_silo_query_first(silo,
+				"components/component[@type='firmware']/pkgname/../project_license",
+				&error);
 	g_assert_no_error(error);
 	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_assert_cmpstr(xb_node_get_text(n), ==, "GPL-2.0");
 	g_clear_object(&n);
-	xb_machine_set_debug_flags(xb_silo_get_machine(silo), XB_MACHINE_DEBUG_FLAG_SHOW_STACK);
-#endif
 
-	/* query with text:integer */
-	n = xb_silo_query_first(silo, "components/component/id['123'=123]", &error);
+	/* descend, ascend, descend */
+	n = xb_silo_query_first(silo,
+				"components/component/pkgname[text()~='colorhug']/../id",
+				&error);
 	g_assert_no_error(error);
 	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_assert_cmpstr(xb_node_get_text(n), ==, "org.hughski.ColorHug2.firmware");
 	g_clear_object(&n);
 
-	/* query with integer:text */
-	n = xb_silo_query_first(silo, "components/component/id[123='123']", &error);
+	/* get node, too many parents */
+	n = xb_silo_query_first(silo, "components/component[@type='firmware']/id/../../..", &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT);
+	g_assert_null(n);
+	g_clear_error(&error);
+
+	/* can't go lower than root */
+	n = xb_silo_query_first(silo, "..", &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT);
+	g_assert_null(n);
+	g_clear_error(&error);
+
+	/* fuzzy substring match */
+	n = xb_silo_query_first(silo, "components/component/pkgname[text()~='colorhug']", &error);
 	g_assert_no_error(error);
 	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_assert_cmpstr(xb_node_get_text(n), ==, "colorhug-client");
 	g_clear_object(&n);
 
-	/* query with prefix */
+	/* strlen match */
 	n = xb_silo_query_first(silo,
-				"components/component/id[starts-with(text(),'gimp')]",
+				"components/component/pkgname[string-length(text())==15]",
 				&error);
 	g_assert_no_error(error);
 	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_assert_cmpstr(xb_node_get_text(n), ==, "colorhug-client");
 	g_clear_object(&n);
 
-	/* query with suffix */
-	n = xb_silo_query_first(silo,
-				"components/component/id[ends-with(text(),'.desktop')]",
-				&error);
+	/* fuzzy substring match */
+	n = xb_silo_query_first(silo, "components/component[@type~='firm']/pkgname", &error);
 	g_assert_no_error(error);
 	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_assert_cmpstr(xb_node_get_text(n), ==, "colorhug-client");
 	g_clear_object(&n);
+}
 
-	/* query with contains */
-	n = xb_silo_query_first(silo, "components/component/id[contains(text(),'imp')]", &error);
+static void
+xb_xpath_prepared_func(void)
+{
+	XbNode *n;
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbSilo) silo = NULL;
+	g_autoptr(XbQuery) query = NULL;
+	g_auto(XbQueryContext) context = XB_QUERY_CONTEXT_INIT();
+	g_autoptr(XbNode) component = NULL;
+	g_autoptr(GPtrArray) components = NULL;
+	const gchar *xml = "<components origin=\"lvfs\">\n"
+			   "  <component type=\"desktop\">\n"
+			   "    <id>gimp.desktop</id>\n"
+			   "    <id>org.gnome.Gimp.desktop</id>\n"
+			   "  </component>\n"
+			   "  <component type=\"firmware\">\n"
+			   "    <id>org.hughski.ColorHug2.firmware</id>\n"
+			   "    <pkgname>colorhug-client</pkgname>\n"
+			   "  </component>\n"
+			   "</components>\n";
+
+	/* import from XML */
+	ret = xb_test_import_xml(builder, xml, &error);
 	g_assert_no_error(error);
-	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
-	g_clear_object(&n);
+	g_assert_true(ret);
+	xb_builder_add_locale(builder, "C");
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NATIVE_LANGS, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
 
-	/* query with type-conversion */
-	n = xb_silo_query_first(silo, "components/component[position()=number('2')]/id", &error);
+	/* get first component */
+	component = xb_silo_query_first(silo, "components/component", &error);
 	g_assert_no_error(error);
-	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "org.hughski.ColorHug2.firmware");
-	g_clear_object(&n);
+	g_assert_nonnull(component);
 
-	/* query with another type-conversion */
-	n = xb_silo_query_first(silo, "components/component['2'=string(2)]/id", &error);
+	/* prepared statement on node */
+	query = xb_query_new(silo, "id[text()=?]/..", &error);
 	g_assert_no_error(error);
-	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
-	g_clear_object(&n);
+	g_assert_nonnull(query);
+	xb_value_bindings_bind_str(xb_query_context_get_bindings(&context),
+				   0,
+				   "gimp.desktop",
+				   NULL);
+	components = xb_node_query_with_context(component, query, &context, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(components);
+	g_assert_cmpint(components->len, ==, 1);
+	n = g_ptr_array_index(components, 0);
+	g_assert_cmpstr(xb_node_get_attr(n, "type"), ==, "desktop");
+}
 
-	/* query with backtrack */
-	g_debug("\n%s", xml);
-	n = xb_silo_query_first(
-	    silo,
-	    "components/component[@type='firmware']/id[text()='org.hughski.ColorHug2.firmware']",
-	    &error);
+static void
+xb_xpath_query_reverse_func(void)
+{
+	XbNode *n;
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbSilo) silo = NULL;
+	g_autoptr(XbQuery) query = NULL;
+	g_autoptr(GPtrArray) names = NULL;
+	const gchar *xml = "<names>\n"
+			   "  <name>foo</name>\n"
+			   "  <name>bar</name>\n"
+			   "  <name>baz</name>\n"
+			   "</names>\n";
+
+	/* import from XML */
+	ret = xb_test_import_xml(builder, xml, &error);
 	g_assert_no_error(error);
-	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "org.hughski.ColorHug2.firmware");
-	g_clear_object(&n);
+	g_assert_true(ret);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
 
-	/* query with nesting */
-	g_debug("\n%s", xml);
-	n = xb_silo_query_first(
-	    silo,
-	    "components/component/id[text()=lower-case(upper-case('Gimp.DESKTOP'))]",
-	    &error);
+	/* get first when reversed */
+	query = xb_query_new_full(silo, "names/name", XB_QUERY_FLAG_REVERSE, &error);
 	g_assert_no_error(error);
-	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
-	g_clear_object(&n);
+	g_assert_nonnull(query);
+	names = xb_silo_query_with_context(silo, query, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(names);
+	g_assert_cmpint(names->len, ==, 3);
+	n = g_ptr_array_index(names, 0);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "baz");
+}
 
-	/* query for multiple results */
-	results = xb_silo_query(silo, "components/component/id", 5, &error);
+static void
+xb_xpath_query_reverse_limit_func(void)
+{
+	XbBuilderCompileFlags flags[] = {XB_BUILDER_COMPILE_FLAG_NONE,
+					 XB_BUILDER_COMPILE_FLAG_CHILD_INDEX};
+	const gchar *xml = "<releases>\n"
+			   "  <release version=\"1.0\"/>\n"
+			   "  <release version=\"1.1\"/>\n"
+			   "  <release version=\"1.2\"/>\n"
+			   "  <release version=\"1.3\"/>\n"
+			   "</releases>\n";
+
+	for (guint i = 0; i < G_N_ELEMENTS(flags); i++) {
+		XbNode *n;
+		gboolean ret;
+		g_autoptr(GError) error = NULL;
+		g_autoptr(GPtrArray) results = NULL;
+		g_autoptr(XbBuilder) builder = xb_builder_new();
+		g_autoptr(XbNode) n2 = NULL;
+		g_autoptr(XbQuery) query = NULL;
+		g_autoptr(XbQuery) query_pos = NULL;
+		g_autoptr(XbSilo) silo = NULL;
+		g_auto(XbQueryContext) context = XB_QUERY_CONTEXT_INIT();
+
+		/* import from XML */
+		ret = xb_test_import_xml(builder, xml, &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		silo = xb_builder_compile(builder, flags[i], NULL, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(silo);
+
+		/* the last two, newest first */
+		query = xb_query_new(silo, "releases/release", &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(query);
+		xb_query_context_set_flags(&context, XB_QUERY_FLAG_REVERSE);
+		xb_query_context_set_limit(&context, 2);
+		results = xb_silo_query_with_context(silo, query, &context, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(results);
+		g_assert_cmpint(results->len, ==, 2);
+		n = g_ptr_array_index(results, 0);
+		g_assert_cmpstr(xb_node_get_attr(n, "version"), ==, "1.3");
+		n = g_ptr_array_index(results, 1);
+		g_assert_cmpstr(xb_node_get_attr(n, "version"), ==, "1.2");
+
+		/* position() still counts from the start */
+		query_pos = xb_query_new(silo, "releases/release[position()=2]", &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(query_pos);
+		n2 = xb_silo_query_first_with_context(silo, query_pos, &context, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(n2);
+		g_assert_cmpstr(xb_node_get_attr(n2, "version"), ==, "1.1");
+	}
+}
+
+static void
+xb_xpath_query_offset_func(void)
+{
+	XbNode *n;
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) results = NULL;
+	g_autoptr(GPtrArray) results_reverse = NULL;
+	g_autoptr(GPtrArray) results_none = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbQuery) query = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+	g_auto(XbQueryContext) context = XB_QUERY_CONTEXT_INIT();
+	g_autoptr(GString) xml = g_string_new("<components>\n");
+
+	for (guint i = 0; i < 10; i++)
+		g_string_append_printf(xml, "  <component><id>%u</id></component>\n", i);
+	g_string_append(xml, "</components>\n");
+	ret = xb_test_import_xml(builder, xml->str, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+	query = xb_query_new(silo, "components/component/id", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(query);
+
+	/* second page of three */
+	xb_query_context_set_offset(&context, 3);
+	xb_query_context_set_limit(&context, 3);
+	results = xb_silo_query_with_context(silo, query, &context, &error);
 	g_assert_no_error(error);
 	g_assert_nonnull(results);
 	g_assert_cmpint(results->len, ==, 3);
-	n2 = g_ptr_array_index(results, 2);
-	g_assert_cmpstr(xb_node_get_text(n2), ==, "org.hughski.ColorHug2.firmware");
+	n = g_ptr_array_index(results, 0);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "3");
+	n = g_ptr_array_index(results, 2);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "5");
+
+	/* counted from the end when reversed */
+	xb_query_context_set_flags(&context, XB_QUERY_FLAG_REVERSE);
+	results_reverse = xb_silo_query_with_context(silo, query, &context, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(results_reverse);
+	g_assert_cmpint(results_reverse->len, ==, 3);
+	n = g_ptr_array_index(results_reverse, 0);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "6");
+
+	/* past the end */
+	xb_query_context_set_offset(&context, 10);
+	results_none = xb_silo_query_with_context(silo, query, &context, &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+	g_assert_null(results_none);
+}
 
-	/* subtree export */
-	xml_sub1 = xb_node_export(n2, XB_NODE_EXPORT_FLAG_NONE, &error);
-	g_assert_no_error(error);
-	g_assert_nonnull(xml_sub1);
-	g_assert_cmpstr(xml_sub1, ==, "<id>org.hughski.ColorHug2.firmware</id>");
+static void
+xb_xpath_query_offset_descendant_func(void)
+{
+	XbNode *n;
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) results = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbQuery) query = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+	g_auto(XbQueryContext) context = XB_QUERY_CONTEXT_INIT();
+	const gchar *xml = "<root>\n"
+			   "  <group>\n"
+			   "    <group>\n"
+			   "      <item>1</item>\n"
+			   "      <item>2</item>\n"
+			   "    </group>\n"
+			   "    <item>3</item>\n"
+			   "  </group>\n"
+			   "</root>\n";
 
-	/* parent of subtree */
-	n3 = xb_node_get_parent(n2);
-	g_assert(n3 != NULL);
-	xml_sub2 = xb_node_export(n3, XB_NODE_EXPORT_FLAG_NONE, &error);
+	/* import from XML */
+	ret = xb_test_import_xml(builder, xml, &error);
 	g_assert_no_error(error);
-	g_assert_nonnull(xml_sub2);
-	g_assert_cmpstr(
-	    xml_sub2,
-	    ==,
-	    "<component type=\"firmware\"><id>org.hughski.ColorHug2.firmware</id></component>");
+	g_assert_true(ret);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
 
-	/* only children of parent */
-	xml_sub3 = xb_node_export(n3, XB_NODE_EXPORT_FLAG_ONLY_CHILDREN, &error);
+	/* the inner items are found from both groups, but only skipped once */
+	query = xb_query_new(silo, "root//group//item", &error);
 	g_assert_no_error(error);
-	g_assert_nonnull(xml_sub3);
-	g_assert_cmpstr(xml_sub3, ==, "<id>org.hughski.ColorHug2.firmware</id>");
+	g_assert_nonnull(query);
+	xb_query_context_set_offset(&context, 1);
+	results = xb_silo_query_with_context(silo, query, &context, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(results);
+	g_assert_cmpint(results->len, ==, 2);
+	n = g_ptr_array_index(results, 0);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "2");
+	n = g_ptr_array_index(results, 1);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "3");
 }
 
 static void
-xb_builder_native_lang_func(void)
+xb_xpath_query_bloom_func(void)
 {
+	XbNode *n;
 	gboolean ret;
-	g_autoptr(GError) error = NULL;
 	g_autofree gchar *str = NULL;
-	g_autofree gchar *tmp = NULL;
+	g_autoptr(GError) error = NULL;
 	g_autoptr(XbBuilder) builder = xb_builder_new();
-	g_autoptr(XbNode) n = NULL;
+	g_autoptr(XbNode) n2 = NULL;
+	g_autoptr(XbNode) parent = NULL;
 	g_autoptr(XbSilo) silo = NULL;
+	g_autoptr(XbSilo) silo_plain = NULL;
+	g_autoptr(GPtrArray) results = NULL;
+	g_autofree gchar *str_plain = NULL;
 	const gchar *xml = "<components>\n"
 			   "  <component>\n"
-			   "    <p xml:lang=\"de_DE\">Wilcommen</p>\n"
-			   "    <p>Hello</p>\n"
-			   "    <p xml:lang=\"fr\">Salut</p>\n"
-			   "    <p>Goodbye</p>\n"
-			   "    <p xml:lang=\"de_DE\">Auf Wiedersehen</p>\n"
-			   "    <p xml:lang=\"fr\">Au revoir</p>\n"
+			   "    <id>a</id>\n"
+			   "    <releases>\n"
+			   "      <release>\n"
+			   "        <checksum type=\"sha256\">aaa</checksum>\n"
+			   "      </release>\n"
+			   "    </releases>\n"
+			   "  </component>\n"
+			   "  <component>\n"
+			   "    <id>b</id>\n"
+			   "  </component>\n"
+			   "  <component>\n"
+			   "    <id>c</id>\n"
+			   "    <releases>\n"
+			   "      <release>\n"
+			   "        <checksum type=\"sha1\">ccc</checksum>\n"
+			   "        <checksum type=\"sha256\">ddd</checksum>\n"
+			   "      </release>\n"
+			   "    </releases>\n"
 			   "  </component>\n"
 			   "</components>\n";
 
@@ -1715,50 +2920,85 @@ xb_builder_native_lang_func(void)
 	ret = xb_test_import_xml(builder, xml, &error);
 	g_assert_no_error(error);
 	g_assert_true(ret);
-	xb_builder_add_locale(builder, "fr_FR.UTF-8");
-	xb_builder_add_locale(builder, "fr_FR");
-	xb_builder_add_locale(builder, "fr_FR");
-	xb_builder_add_locale(builder, "fr");
-	xb_builder_add_locale(builder, "C");
-	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_SINGLE_LANG, NULL, &error);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_BLOOM, NULL, &error);
 	g_assert_no_error(error);
 	g_assert_nonnull(silo);
 
-	/* test we removed other languages */
+	/* nodes with children have a filter */
 	str = xb_silo_to_string(silo, &error);
 	g_assert_no_error(error);
-	g_assert_nonnull(str);
-	g_debug("\n%s", str);
-	g_assert_null(g_strstr_len(str, -1, "Wilcommen"));
-	g_assert_null(g_strstr_len(str, -1, "Hello"));
-	g_assert_nonnull(g_strstr_len(str, -1, "Salut"));
-	g_assert_null(g_strstr_len(str, -1, "Goodbye"));
-	g_assert_null(g_strstr_len(str, -1, "Auf Wiedersehen"));
-	g_assert_nonnull(g_strstr_len(str, -1, "Au revoir"));
+	g_assert_nonnull(g_strstr_len(str, -1, "bloom:"));
 
-	/* test we traversed the tree correctly */
-	n = xb_silo_query_first(silo, "components/component/*", &error);
+	/* subtrees without a checksum are skipped */
+	results = xb_silo_query(silo,
+				"components/component/releases/release/checksum[@type='sha256']",
+				0,
+				&error);
 	g_assert_no_error(error);
-	g_assert_nonnull(n);
-	tmp = xb_node_export(n, XB_NODE_EXPORT_FLAG_INCLUDE_SIBLINGS, &error);
-	g_assert_cmpstr(tmp, ==, "<p xml:lang=\"fr\">Salut</p><p xml:lang=\"fr\">Au revoir</p>");
+	g_assert_nonnull(results);
+	g_assert_cmpint(results->len, ==, 2);
+	n = g_ptr_array_index(results, 0);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "aaa");
+	n = g_ptr_array_index(results, 1);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "ddd");
+	g_clear_pointer(&results, g_ptr_array_unref);
+
+	/* going back up the tree is not restricted to the subtree */
+	results = xb_silo_query(silo, "components/component/id/../releases/release/checksum", 0, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(results);
+	g_assert_cmpint(results->len, ==, 3);
+
+	/* skipped subtrees still count towards the position */
+	n2 = xb_silo_query_first(silo, "components/component[3]/releases", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n2);
+	parent = xb_node_get_parent(n2);
+	g_assert_nonnull(parent);
+	g_assert_cmpstr(xb_node_query_text(parent, "id", NULL), ==, "c");
+	g_clear_pointer(&results, g_ptr_array_unref);
+
+	/* the filter is optional */
+	silo_plain = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo_plain);
+	str_plain = xb_silo_to_string(silo_plain, &error);
+	g_assert_no_error(error);
+	g_assert_null(g_strstr_len(str_plain, -1, "bloom:"));
+	results = xb_silo_query(silo_plain,
+				"components/component/releases/release/checksum[@type='sha256']",
+				0,
+				&error);
+	g_assert_no_error(error);
+	g_assert_nonnull(results);
+	g_assert_cmpint(results->len, ==, 2);
 }
 
 static void
-xb_builder_comments_func(void)
+xb_xpath_query_reorder_func(void)
 {
+	XbNode *n;
 	gboolean ret;
-	g_autoptr(GError) error = NULL;
 	g_autofree gchar *str = NULL;
+	g_autoptr(GError) error = NULL;
 	g_autoptr(XbBuilder) builder = xb_builder_new();
 	g_autoptr(XbSilo) silo = NULL;
-	const gchar *xml = "<?xml version=\"1.0\" ?>\n"
-			   "<components>\n"
-			   "  <!-- one -->\n"
-			   "  <!-- two -->\n"
+	g_autoptr(XbQuery) query = NULL;
+	g_autoptr(GPtrArray) results = NULL;
+	g_auto(XbQueryContext) context = XB_QUERY_CONTEXT_INIT();
+	const gchar *xml = "<components>\n"
+			   "  <component>\n"
+			   "    <id type=\"desktop\">gimp.desktop</id>\n"
+			   "  </component>\n"
+			   "  <component>\n"
+			   "    <id type=\"font\">gimp-font.desktop</id>\n"
+			   "  </component>\n"
+			   "  <component>\n"
+			   "    <id type=\"desktop\">inkscape.desktop</id>\n"
+			   "  </component>\n"
 			   "</components>\n";
 
-	/* import XML */
+	/* import from XML */
 	ret = xb_test_import_xml(builder, xml, &error);
 	g_assert_no_error(error);
 	g_assert_true(ret);
@@ -1766,89 +3006,225 @@ xb_builder_comments_func(void)
 	g_assert_no_error(error);
 	g_assert_nonnull(silo);
 
-	/* export */
-	str = xb_silo_export(silo, XB_NODE_EXPORT_FLAG_NONE, &error);
+	/* the attribute test is run before the substring search */
+	query = xb_query_new(silo,
+			     "components/component/id[contains(text(),'gimp')][@type='desktop']",
+			     &error);
 	g_assert_no_error(error);
-	g_assert_cmpstr(str, ==, "<components></components>");
+	g_assert_nonnull(query);
+	str = xb_query_to_string(query);
+	g_debug("%s", str);
+	g_assert_true(
+	    g_str_has_prefix(str, "components/component/id['type','desktop',attr-eq()]["));
+	results = xb_silo_query_with_context(silo, query, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(results);
+	g_assert_cmpint(results->len, ==, 1);
+	n = g_ptr_array_index(results, 0);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_clear_pointer(&results, g_ptr_array_unref);
+	g_clear_pointer(&str, g_free);
+	g_clear_object(&query);
+
+	/* predicates do not move across a positional one */
+	query = xb_query_new(silo,
+			     "components/component/id[contains(text(),'gimp')][last()]",
+			     &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(query);
+	str = xb_query_to_string(query);
+	g_debug("%s", str);
+	g_assert_true(g_str_has_suffix(str, "[last()]"));
+	results = xb_silo_query_with_context(silo, query, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(results);
+	g_assert_cmpint(results->len, ==, 2);
+	g_clear_pointer(&results, g_ptr_array_unref);
+	g_clear_pointer(&str, g_free);
+	g_clear_object(&query);
+
+	/* bound values still match up after reordering */
+	query = xb_query_new(silo,
+			     "components/component/id[contains(text(),?)][@type='desktop']",
+			     &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(query);
+	xb_value_bindings_bind_str(xb_query_context_get_bindings(&context), 0, "inkscape", NULL);
+	results = xb_silo_query_with_context(silo, query, &context, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(results);
+	g_assert_cmpint(results->len, ==, 1);
+	n = g_ptr_array_index(results, 0);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "inkscape.desktop");
 }
 
 static void
-xb_builder_native_lang2_func(void)
+xb_xpath_query_intern_func(void)
 {
-	gboolean ret;
-	g_autoptr(GError) error = NULL;
-	g_autofree gchar *str = NULL;
-	g_autoptr(XbBuilder) builder = xb_builder_new();
-	g_autoptr(XbSilo) silo = NULL;
+	XbBuilderCompileFlags flags[] = {XB_BUILDER_COMPILE_FLAG_NONE,
+					 XB_BUILDER_COMPILE_FLAG_STRTAB_INDEX};
 	const gchar *xml = "<components>\n"
 			   "  <component>\n"
-			   "    <description xml:lang=\"de_DE\"><p>Wilcommen</p></description>\n"
-			   "    <description><p>Hello</p></description>\n"
-			   "    <description xml:lang=\"fr\"><p>Salut</p></description>\n"
+			   "    <id type=\"desktop\">gimp.desktop</id>\n"
+			   "  </component>\n"
+			   "  <component>\n"
+			   "    <id type=\"font\">gimp-font.desktop</id>\n"
 			   "  </component>\n"
 			   "</components>\n";
 
-	/* import from XML */
-	ret = xb_test_import_xml(builder, xml, &error);
-	g_assert_no_error(error);
-	g_assert_true(ret);
-	xb_builder_add_locale(builder, "fr_FR");
-	xb_builder_add_locale(builder, "fr");
-	xb_builder_add_locale(builder, "C");
-	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_SINGLE_LANG, NULL, &error);
-	g_assert_no_error(error);
-	g_assert_nonnull(silo);
+	for (guint i = 0; i < G_N_ELEMENTS(flags); i++) {
+		gboolean indexed = (flags[i] & XB_BUILDER_COMPILE_FLAG_STRTAB_INDEX) > 0;
+		gboolean ret;
+		g_autofree gchar *str = NULL;
+		g_autoptr(GError) error = NULL;
+		g_autoptr(XbBuilder) builder = xb_builder_new();
+		g_autoptr(XbSilo) silo = NULL;
+		g_autoptr(XbQuery) query = NULL;
+		g_autoptr(GPtrArray) results = NULL;
 
-	/* test we removed other languages */
-	str = xb_silo_to_string(silo, &error);
-	g_assert_no_error(error);
-	g_assert_nonnull(str);
-	g_assert_null(g_strstr_len(str, -1, "Wilcommen"));
-	g_assert_null(g_strstr_len(str, -1, "Hello"));
-	g_assert_nonnull(g_strstr_len(str, -1, "Salut"));
-	g_debug("\n%s", str);
+		/* import from XML */
+		ret = xb_test_import_xml(builder, xml, &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		silo = xb_builder_compile(builder, flags[i], NULL, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(silo);
+
+		/* any string in the silo can be found, but only using the index */
+		if (indexed) {
+			g_assert_cmpint(xb_silo_strtab_find(silo, "gimp.desktop"),
+					!=,
+					XB_SILO_UNSET);
+			g_assert_cmpint(xb_silo_strtab_find(silo, "type"), !=, XB_SILO_UNSET);
+		} else {
+			g_assert_cmpint(xb_silo_strtab_find(silo, "gimp.desktop"),
+					==,
+					XB_SILO_UNSET);
+		}
+		g_assert_cmpint(xb_silo_strtab_find(silo, "gimp"), ==, XB_SILO_UNSET);
+
+		/* literals are compared by offset */
+		query =
+		    xb_query_new(silo, "components/component/id[text()='gimp.desktop']", &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(query);
+		str = xb_query_to_string(query);
+		g_assert_cmpstr(str,
+				==,
+				indexed ? "components/component/id[text(),$'gimp.desktop',eq()]"
+					: "components/component/id[text(),'gimp.desktop',eq()]");
+		results = xb_silo_query_with_context(silo, query, NULL, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(results);
+		g_assert_cmpint(results->len, ==, 1);
+		g_clear_pointer(&results, g_ptr_array_unref);
+		g_clear_pointer(&str, g_free);
+		g_clear_object(&query);
+
+		/* literals not in the silo can never match */
+		query = xb_query_new(silo, "components/component/id[@type='dummy']", &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(query);
+		str = xb_query_to_string(query);
+		g_assert_cmpstr(str,
+				==,
+				indexed ? "components/component/id[False]"
+					: "components/component/id['type','dummy',attr-eq()]");
+		results = xb_silo_query_with_context(silo, query, NULL, &error);
+		g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+		g_assert_null(results);
+	}
 }
 
 static void
-xb_builder_native_lang_no_locales_func(void)
+xb_xpath_query_bind_set_func(void)
 {
+	XbQueryFlags flags[] = {XB_QUERY_FLAG_NONE,
+				XB_QUERY_FLAG_OPTIMIZE | XB_QUERY_FLAG_USE_INDEXES};
 	gboolean ret;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(XbBuilder) builder = xb_builder_new();
 	g_autoptr(XbSilo) silo = NULL;
+	const gchar *xml = "<components>\n"
+			   "  <component priority=\"5\">\n"
+			   "    <id>gimp.desktop</id>\n"
+			   "  </component>\n"
+			   "  <component priority=\"7\">\n"
+			   "    <id>gimp-font.desktop</id>\n"
+			   "  </component>\n"
+			   "  <component priority=\"9\">\n"
+			   "    <id>inkscape.desktop</id>\n"
+			   "  </component>\n"
+			   "</components>\n";
 
 	/* import from XML */
-	ret = xb_test_import_xml(builder, "<id>gimp.desktop</id>", &error);
+	ret = xb_test_import_xml(builder, xml, &error);
 	g_assert_no_error(error);
 	g_assert_true(ret);
-	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_SINGLE_LANG, NULL, &error);
-	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
-	g_assert_null(silo);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+
+	for (guint i = 0; i < G_N_ELEMENTS(flags); i++) {
+		const gchar *ids[] = {"gimp.desktop", "inkscape.desktop", "dummy", NULL};
+		const guint32 priorities[] = {5, 9, 11};
+		XbNode *n;
+		g_auto(XbQueryContext) context = XB_QUERY_CONTEXT_INIT();
+		g_autoptr(XbQuery) query = NULL;
+		g_autoptr(GPtrArray) results = NULL;
+
+		/* string set */
+		query = xb_query_new(silo, "components/component/id[text()=?]", &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(query);
+		xb_query_context_set_flags(&context, flags[i]);
+		xb_value_bindings_bind_set(xb_query_context_get_bindings(&context), 0, ids);
+		results = xb_silo_query_with_context(silo, query, &context, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(results);
+		g_assert_cmpint(results->len, ==, 2);
+		n = g_ptr_array_index(results, 0);
+		g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+		n = g_ptr_array_index(results, 1);
+		g_assert_cmpstr(xb_node_get_text(n), ==, "inkscape.desktop");
+		g_clear_pointer(&results, g_ptr_array_unref);
+		g_clear_object(&query);
+
+		/* integer set */
+		query = xb_query_new(silo, "components/component[@priority=?]/id", &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(query);
+		xb_value_bindings_bind_set_val(xb_query_context_get_bindings(&context),
+					       0,
+					       priorities,
+					       G_N_ELEMENTS(priorities));
+		results = xb_silo_query_with_context(silo, query, &context, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(results);
+		g_assert_cmpint(results->len, ==, 2);
+		n = g_ptr_array_index(results, 1);
+		g_assert_cmpstr(xb_node_get_text(n), ==, "inkscape.desktop");
+	}
 }
 
 static void
-xb_xpath_parent_func(void)
+xb_xpath_query_bindings_offset_func(void)
 {
-	XbNode *n;
+	XbQueryFlags flags[] = {XB_QUERY_FLAG_NONE,
+				XB_QUERY_FLAG_OPTIMIZE | XB_QUERY_FLAG_USE_INDEXES};
 	gboolean ret;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(XbBuilder) builder = xb_builder_new();
 	g_autoptr(XbSilo) silo = NULL;
-	const gchar *xml = "<components origin=\"lvfs\">\n"
-			   "  <header>\n"
-			   "    <csum type=\"sha1\">dead</csum>\n"
-			   "  </header>\n"
-			   "  <component type=\"desktop\">\n"
+	g_autoptr(XbQuery) query = NULL;
+	const gchar *xml = "<components>\n"
+			   "  <component type=\"desktop\" priority=\"5\">\n"
 			   "    <id>gimp.desktop</id>\n"
-			   "    <id>org.gnome.Gimp.desktop</id>\n"
+			   "    <name>GIMP</name>\n"
 			   "  </component>\n"
-			   "  <component type=\"firmware\">\n"
-			   "    <id>org.hughski.ColorHug2.firmware</id>\n"
-			   "    <pkgname>colorhug-client</pkgname>\n"
-			   "    <description xml:lang=\"de_DE\"><p>Wilcommen!</p></description>\n"
-			   "    <description><p>hello!</p></description>\n"
-			   "    <description xml:lang=\"fr_FR\"><p>Bonjour!</p></description>\n"
-			   "    <project_license>GPL-2.0</project_license>\n"
+			   "  <component type=\"desktop\" priority=\"7\">\n"
+			   "    <id>inkscape.desktop</id>\n"
+			   "    <name>Inkscape</name>\n"
 			   "  </component>\n"
 			   "</components>\n";
 
@@ -1856,107 +3232,208 @@ xb_xpath_parent_func(void)
 	ret = xb_test_import_xml(builder, xml, &error);
 	g_assert_no_error(error);
 	g_assert_true(ret);
-	xb_builder_add_locale(builder, "C");
-	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NATIVE_LANGS, NULL, &error);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
 	g_assert_no_error(error);
 	g_assert_nonnull(silo);
 
-	/* get node, no parent */
-	n = xb_silo_query_first(silo, "components/component[@type='firmware']/id", &error);
-	g_assert_no_error(error);
-	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "org.hughski.ColorHug2.firmware");
-	g_assert_cmpstr(xb_node_get_element(n), ==, "id");
-	g_clear_object(&n);
-
-	/* get node, one parent */
-	n = xb_silo_query_first(silo, "components/component[@type='firmware']/id/..", &error);
+	/* each predicate reads its own values from the shared bindings */
+	query = xb_query_new(silo,
+			     "components/component[@type=?][@priority=?]/name[text()=?]/../id",
+			     &error);
 	g_assert_no_error(error);
-	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_element(n), ==, "component");
-	g_clear_object(&n);
+	g_assert_nonnull(query);
+	for (guint i = 0; i < G_N_ELEMENTS(flags); i++) {
+		XbValueBindings *bindings;
+		XbNode *n;
+		g_auto(XbQueryContext) context = XB_QUERY_CONTEXT_INIT();
+		g_autoptr(GPtrArray) results = NULL;
+
+		xb_query_context_set_flags(&context, flags[i]);
+		bindings = xb_query_context_get_bindings(&context);
+		xb_value_bindings_bind_str(bindings, 0, "desktop", NULL);
+		xb_value_bindings_bind_val(bindings, 1, 7);
+		xb_value_bindings_bind_str(bindings, 2, "Inkscape", NULL);
+		results = xb_silo_query_with_context(silo, query, &context, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(results);
+		g_assert_cmpint(results->len, ==, 1);
+		n = g_ptr_array_index(results, 0);
+		g_assert_cmpstr(xb_node_get_text(n), ==, "inkscape.desktop");
+	}
+}
 
-	/* get node, multiple parents */
-	n = xb_silo_query_first(silo, "components/component[@type='firmware']/id/../..", &error);
-	g_assert_no_error(error);
-	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_element(n), ==, "components");
-	g_clear_object(&n);
+static void
+xb_xpath_query_val64_func(void)
+{
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) results = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbNode) n = NULL;
+	g_autoptr(XbQuery) query = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+	g_auto(XbQueryContext) context = XB_QUERY_CONTEXT_INIT();
+	struct {
+		const gchar *xpath;
+		const gchar *version;
+	} tests[] = {{"releases/release[? and @version='1.2.4']", "1.2.4"},
+		     {"releases/release[@version='1.2.4' or ?]", "1.2.3"},
+		     {"releases/release[string(?)='4294967296']", "1.2.3"},
+		     {NULL, NULL}};
+	const gchar *xml = "<releases>\n"
+			   "  <release timestamp=\"4102444800\" version=\"1.2.3\">\n"
+			   "    <size>4294967296</size>\n"
+			   "  </release>\n"
+			   "  <release timestamp=\"4417977600\" version=\"1.2.4\">\n"
+			   "    <size>8589934592</size>\n"
+			   "  </release>\n"
+			   "</releases>\n";
 
-	/* descend, ascend, descend */
-	n = xb_silo_query_first(silo,
-				"components/component[@type='firmware']/pkgname/../project_license",
-				&error);
+	/* import from XML */
+	ret = xb_test_import_xml(builder, xml, &error);
 	g_assert_no_error(error);
-	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "GPL-2.0");
-	g_clear_object(&n);
-
-	/* descend, ascend, descend */
-	n = xb_silo_query_first(silo,
-				"components/component/pkgname[text()~='colorhug']/../id",
-				&error);
+	g_assert_true(ret);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NUMERIC, NULL, &error);
 	g_assert_no_error(error);
-	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "org.hughski.ColorHug2.firmware");
-	g_clear_object(&n);
-
-	/* get node, too many parents */
-	n = xb_silo_query_first(silo, "components/component[@type='firmware']/id/../../..", &error);
-	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT);
-	g_assert_null(n);
-	g_clear_error(&error);
-
-	/* can't go lower than root */
-	n = xb_silo_query_first(silo, "..", &error);
-	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT);
-	g_assert_null(n);
-	g_clear_error(&error);
-
-	/* fuzzy substring match */
-	n = xb_silo_query_first(silo, "components/component/pkgname[text()~='colorhug']", &error);
+	g_assert_nonnull(silo);
+
+	/* literals over 32 bits */
+	n = xb_silo_query_first(silo, "releases/release[@timestamp>4294967296]", &error);
 	g_assert_no_error(error);
 	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "colorhug-client");
+	g_assert_cmpstr(xb_node_get_attr(n, "version"), ==, "1.2.4");
 	g_clear_object(&n);
+	results = xb_silo_query(silo, "releases/release/size[text()>=4294967296]", 0, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(results);
+	g_assert_cmpint(results->len, ==, 2);
 
-	/* strlen match */
-	n = xb_silo_query_first(silo,
-				"components/component/pkgname[string-length(text())==15]",
-				&error);
+	/* bound values over 32 bits */
+	query = xb_query_new(silo, "releases/release[number(@timestamp)<?]", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(query);
+	xb_value_bindings_bind_val64(xb_query_context_get_bindings(&context), 0, 4294967296);
+	n = xb_silo_query_first_with_context(silo, query, &context, &error);
 	g_assert_no_error(error);
 	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "colorhug-client");
+	g_assert_cmpstr(xb_node_get_attr(n, "version"), ==, "1.2.3");
 	g_clear_object(&n);
 
-	/* fuzzy substring match */
-	n = xb_silo_query_first(silo, "components/component[@type~='firm']/pkgname", &error);
+	/* only the high bits are set, which is still true */
+	for (guint i = 0; tests[i].xpath != NULL; i++) {
+		g_autoptr(XbQuery) query_tmp = NULL;
+		g_auto(XbQueryContext) context_tmp = XB_QUERY_CONTEXT_INIT();
+
+		query_tmp = xb_query_new(silo, tests[i].xpath, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(query_tmp);
+		xb_value_bindings_bind_val64(xb_query_context_get_bindings(&context_tmp),
+					     0,
+					     4294967296);
+		n = xb_silo_query_first_with_context(silo, query_tmp, &context_tmp, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(n);
+		g_assert_cmpstr(xb_node_get_attr(n, "version"), ==, tests[i].version);
+		g_clear_object(&n);
+	}
+}
+
+static void
+xb_xpath_query_parallel_func(void)
+{
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) results_serial = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbQuery) query = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+	g_autoptr(GString) xml = g_string_new("<components>\n");
+
+	/* enough siblings to be split into ranges */
+	for (guint i = 0; i < 10000; i++) {
+		g_string_append_printf(xml,
+				       "  <component priority=\"%u\">"
+				       "<id>%u.desktop</id></component>\n",
+				       i % 7,
+				       i);
+	}
+	g_string_append(xml, "</components>\n");
+	ret = xb_test_import_xml(builder, xml->str, &error);
 	g_assert_no_error(error);
-	g_assert_nonnull(n);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "colorhug-client");
-	g_clear_object(&n);
+	g_assert_true(ret);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_CHILD_INDEX, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+
+	query = xb_query_new(silo, "components/component[@priority='3']/id", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(query);
+	results_serial = xb_silo_query_with_context(silo, query, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(results_serial);
+	g_assert_cmpint(results_serial->len, ==, 1429);
+
+	/* same results, in document order */
+	for (guint limit = 0; limit <= 5; limit += 5) {
+		g_autoptr(GPtrArray) results = NULL;
+		g_auto(XbQueryContext) context = XB_QUERY_CONTEXT_INIT();
+
+		xb_query_context_set_flags(&context, XB_QUERY_FLAG_PARALLEL);
+		xb_query_context_set_limit(&context, limit);
+		results = xb_silo_query_with_context(silo, query, &context, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(results);
+		g_assert_cmpint(results->len, ==, limit > 0 ? limit : results_serial->len);
+		for (guint i = 0; i < results->len; i++) {
+			XbNode *n1 = g_ptr_array_index(results, i);
+			XbNode *n2 = g_ptr_array_index(results_serial, i);
+			g_assert_cmpstr(xb_node_get_text(n1), ==, xb_node_get_text(n2));
+		}
+	}
+
+	/* position() counts from the start of the chain, not of the range */
+	{
+		g_autoptr(XbNode) n = NULL;
+		g_autoptr(XbQuery) query_pos = NULL;
+		g_auto(XbQueryContext) context = XB_QUERY_CONTEXT_INIT();
+
+		query_pos = xb_query_new(silo, "components/component[position()=9000]/id", &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(query_pos);
+		xb_query_context_set_flags(&context, XB_QUERY_FLAG_PARALLEL);
+		n = xb_silo_query_first_with_context(silo, query_pos, &context, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(n);
+		g_assert_cmpstr(xb_node_get_text(n), ==, "8999.desktop");
+	}
 }
 
 static void
-xb_xpath_prepared_func(void)
+xb_xpath_query_batch_func(void)
 {
-	XbNode *n;
 	gboolean ret;
+	const gchar *xpaths[] = {"components/component[@type='desktop']/id",
+				 "components/component/pkgname",
+				 "components/component/id[text()='gimp.desktop']/../pkgname",
+				 "components/component[@type='firmware']/id",
+				 "components/component/id",
+				 NULL};
+	guint results_len[] = {2, 2, 1, 0, 1};
 	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) contexts =
+	    g_ptr_array_new_with_free_func((GDestroyNotify)xb_query_context_free);
+	g_autoptr(GPtrArray) queries = g_ptr_array_new_with_free_func(g_object_unref);
+	g_autoptr(GPtrArray) results = NULL;
 	g_autoptr(XbBuilder) builder = xb_builder_new();
 	g_autoptr(XbSilo) silo = NULL;
-	g_autoptr(XbQuery) query = NULL;
-	g_auto(XbQueryContext) context = XB_QUERY_CONTEXT_INIT();
-	g_autoptr(XbNode) component = NULL;
-	g_autoptr(GPtrArray) components = NULL;
-	const gchar *xml = "<components origin=\"lvfs\">\n"
+	const gchar *xml = "<components>\n"
 			   "  <component type=\"desktop\">\n"
 			   "    <id>gimp.desktop</id>\n"
-			   "    <id>org.gnome.Gimp.desktop</id>\n"
+			   "    <pkgname>gimp</pkgname>\n"
 			   "  </component>\n"
-			   "  <component type=\"firmware\">\n"
-			   "    <id>org.hughski.ColorHug2.firmware</id>\n"
-			   "    <pkgname>colorhug-client</pkgname>\n"
+			   "  <component type=\"desktop\">\n"
+			   "    <id>inkscape.desktop</id>\n"
+			   "    <pkgname>inkscape</pkgname>\n"
 			   "  </component>\n"
 			   "</components>\n";
 
@@ -1964,47 +3441,163 @@ xb_xpath_prepared_func(void)
 	ret = xb_test_import_xml(builder, xml, &error);
 	g_assert_no_error(error);
 	g_assert_true(ret);
-	xb_builder_add_locale(builder, "C");
-	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NATIVE_LANGS, NULL, &error);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
 	g_assert_no_error(error);
 	g_assert_nonnull(silo);
 
-	/* get first component */
-	component = xb_silo_query_first(silo, "components/component", &error);
+	/* the last query is limited to one result */
+	for (guint i = 0; xpaths[i] != NULL; i++) {
+		XbQueryContext *context = g_new0(XbQueryContext, 1);
+		XbQuery *query = xb_query_new(silo, xpaths[i], &error);
+		xb_query_context_init(context);
+		g_assert_no_error(error);
+		g_assert_nonnull(query);
+		g_ptr_array_add(queries, query);
+		if (xpaths[i + 1] == NULL)
+			xb_query_context_set_limit(context, 1);
+		g_ptr_array_add(contexts, context);
+	}
+	results = xb_silo_query_batch(silo, queries, contexts, &error);
 	g_assert_no_error(error);
-	g_assert_nonnull(component);
+	g_assert_nonnull(results);
+	g_assert_cmpint(results->len, ==, queries->len);
+
+	/* same as running each query in turn */
+	for (guint i = 0; i < results->len; i++) {
+		GPtrArray *results_tmp = g_ptr_array_index(results, i);
+		g_autoptr(GPtrArray) results_one = NULL;
+		g_autoptr(GError) error_local = NULL;
+
+		g_assert_cmpint(results_tmp->len, ==, results_len[i]);
+		results_one = xb_silo_query_with_context(silo,
+							 g_ptr_array_index(queries, i),
+							 g_ptr_array_index(contexts, i),
+							 &error_local);
+		if (results_len[i] == 0) {
+			g_assert_error(error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+			continue;
+		}
+		g_assert_no_error(error_local);
+		for (guint j = 0; j < results_tmp->len; j++) {
+			XbNode *n1 = g_ptr_array_index(results_tmp, j);
+			XbNode *n2 = g_ptr_array_index(results_one, j);
+			g_assert_cmpstr(xb_node_get_text(n1), ==, xb_node_get_text(n2));
+		}
+	}
+}
 
-	/* prepared statement on node */
-	query = xb_query_new(silo, "id[text()=?]/..", &error);
+static gboolean
+xb_test_machine_func_always_cb(XbMachine *self,
+			       XbStack *stack,
+			       gboolean *result_unused,
+			       gpointer user_data,
+			       gpointer exec_data,
+			       GError **error)
+{
+	return xb_stack_push_bool(stack, TRUE, error);
+}
+
+static void
+xb_xpath_query_compiled_func(void)
+{
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbSilo) silo = NULL;
+	const gchar *xpaths[] = {"components/component/id[@type='desktop']",
+				 "components/component/id[@type='dummy']",
+				 "components/component/id[@dummy='desktop']",
+				 "components/component/id[text()='gimp.desktop']",
+				 "components/component/id[text()='dummy']",
+				 "components/component/id[@type='font'][text()='gimp.desktop']",
+				 "components/component/id[(@type='font')||(text()='gimp.desktop')]",
+				 "components/component/id[always()]",
+				 NULL};
+	const gchar *xml = "<components>\n"
+			   "  <component>\n"
+			   "    <id type=\"desktop\">gimp.desktop</id>\n"
+			   "  </component>\n"
+			   "  <component>\n"
+			   "    <id type=\"font\">gimp-font.desktop</id>\n"
+			   "  </component>\n"
+			   "  <component>\n"
+			   "    <id type=\"desktop\">inkscape.desktop</id>\n"
+			   "  </component>\n"
+			   "</components>\n";
+
+	/* import from XML */
+	ret = xb_test_import_xml(builder, xml, &error);
 	g_assert_no_error(error);
-	g_assert_nonnull(query);
-	xb_value_bindings_bind_str(xb_query_context_get_bindings(&context),
-				   0,
-				   "gimp.desktop",
-				   NULL);
-	components = xb_node_query_with_context(component, query, &context, &error);
+	g_assert_true(ret);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
 	g_assert_no_error(error);
-	g_assert_nonnull(components);
-	g_assert_cmpint(components->len, ==, 1);
-	n = g_ptr_array_index(components, 0);
-	g_assert_cmpstr(xb_node_get_attr(n, "type"), ==, "desktop");
+	g_assert_nonnull(silo);
+	xb_machine_add_method(xb_silo_get_machine(silo),
+			      "always",
+			      0,
+			      xb_test_machine_func_always_cb,
+			      NULL,
+			      NULL);
+
+	/* the compiled programs give the same results as the interpreter */
+	for (guint i = 0; xpaths[i] != NULL; i++) {
+		g_autoptr(XbQuery) query1 = NULL;
+		g_autoptr(XbQuery) query2 = NULL;
+		g_autoptr(GPtrArray) results1 = NULL;
+		g_autoptr(GPtrArray) results2 = NULL;
+
+		query1 = xb_query_new_full(silo, xpaths[i], XB_QUERY_FLAG_NONE, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(query1);
+		query2 = xb_query_new_full(silo, xpaths[i], XB_QUERY_FLAG_OPTIMIZE, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(query2);
+		results1 = xb_silo_query_with_context(silo, query1, NULL, NULL);
+		results2 = xb_silo_query_with_context(silo, query2, NULL, NULL);
+		g_assert_cmpint(results1 != NULL ? results1->len : 0,
+				==,
+				results2 != NULL ? results2->len : 0);
+	}
+
+	/* custom methods are left to the interpreter */
+	for (guint i = 0; i < 2; i++) {
+		const gchar *preds[] = {"@type='desktop'", "always()"};
+		g_autoptr(XbStack) opcodes = NULL;
+		g_autoptr(XbMachineProgram) program = NULL;
+
+		opcodes = xb_machine_parse_full(xb_silo_get_machine(silo),
+						preds[i],
+						-1,
+						XB_MACHINE_PARSE_FLAG_OPTIMIZE,
+						&error);
+		g_assert_no_error(error);
+		g_assert_nonnull(opcodes);
+		program = xb_machine_compile(xb_silo_get_machine(silo), opcodes);
+		if (i == 0)
+			g_assert_nonnull(program);
+		else
+			g_assert_null(program);
+	}
 }
 
 static void
-xb_xpath_query_reverse_func(void)
+xb_xpath_query_predicates_func(void)
 {
-	XbNode *n;
 	gboolean ret;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(XbBuilder) builder = xb_builder_new();
 	g_autoptr(XbSilo) silo = NULL;
+	g_autoptr(GPtrArray) results = NULL;
 	g_autoptr(XbQuery) query = NULL;
-	g_autoptr(GPtrArray) names = NULL;
-	const gchar *xml = "<names>\n"
-			   "  <name>foo</name>\n"
-			   "  <name>bar</name>\n"
-			   "  <name>baz</name>\n"
-			   "</names>\n";
+	g_autofree gchar *str = NULL;
+	const gchar *xml = "<components>\n"
+			   "  <component>\n"
+			   "    <id type=\"desktop\">gimp.desktop</id>\n"
+			   "  </component>\n"
+			   "  <component>\n"
+			   "    <id type=\"font\">gimp-font.desktop</id>\n"
+			   "  </component>\n"
+			   "</components>\n";
 
 	/* import from XML */
 	ret = xb_test_import_xml(builder, xml, &error);
@@ -2014,16 +3607,31 @@ xb_xpath_query_reverse_func(void)
 	g_assert_no_error(error);
 	g_assert_nonnull(silo);
 
-	/* get first when reversed */
-	query = xb_query_new_full(silo, "names/name", XB_QUERY_FLAG_REVERSE, &error);
+	/* every predicate has to match, not just the last */
+	results = xb_silo_query(silo,
+				"components/component/id[@type='font'][text()='gimp.desktop']",
+				0,
+				&error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+	g_assert_null(results);
+	g_clear_error(&error);
+	results = xb_silo_query(silo,
+				"components/component/id[@type='desktop'][text()='gimp.desktop']",
+				0,
+				&error);
 	g_assert_no_error(error);
-	g_assert_nonnull(query);
-	names = xb_silo_query_with_context(silo, query, NULL, &error);
+	g_assert_nonnull(results);
+	g_assert_cmpint(results->len, ==, 1);
+
+	/* each predicate is shown separately */
+	query = xb_query_new_full(silo,
+				  "components/component/id[text()='gimp.desktop'][last()]",
+				  XB_QUERY_FLAG_NONE,
+				  &error);
 	g_assert_no_error(error);
-	g_assert_nonnull(names);
-	g_assert_cmpint(names->len, ==, 3);
-	n = g_ptr_array_index(names, 0);
-	g_assert_cmpstr(xb_node_get_text(n), ==, "baz");
+	g_assert_nonnull(query);
+	str = xb_query_to_string(query);
+	g_assert_cmpstr(str, ==, "components/component/id[text(),'gimp.desktop',eq()][last()]");
 }
 
 static void
@@ -2092,6 +3700,274 @@ xb_xpath_glob_func(void)
 	g_assert_cmpstr(xml2, ==, "<id>gimp.desktop</id>");
 }
 
+static void
+xb_xpath_descendant_func(void)
+{
+	XbBuilderCompileFlags flags[] = {XB_BUILDER_COMPILE_FLAG_NONE,
+					 XB_BUILDER_COMPILE_FLAG_ELEMENT_INDEX,
+					 XB_BUILDER_COMPILE_FLAG_ELEMENT_INDEX |
+					     XB_BUILDER_COMPILE_FLAG_SUBTREE_END};
+	const gchar *xml = "<components>\n"
+			   "  <component type=\"desktop\">\n"
+			   "    <id>gimp.desktop</id>\n"
+			   "    <releases>\n"
+			   "      <release>\n"
+			   "        <checksum type=\"sha1\">aaa</checksum>\n"
+			   "        <checksum type=\"sha256\">bbb</checksum>\n"
+			   "      </release>\n"
+			   "    </releases>\n"
+			   "  </component>\n"
+			   "  <component type=\"firmware\">\n"
+			   "    <id>bios</id>\n"
+			   "    <checksum type=\"sha256\">ccc</checksum>\n"
+			   "  </component>\n"
+			   "</components>\n";
+
+	for (guint i = 0; i < G_N_ELEMENTS(flags); i++) {
+		gboolean ret;
+		g_autofree gchar *str = NULL;
+		g_autoptr(GError) error = NULL;
+		g_autoptr(GPtrArray) results = NULL;
+		g_autoptr(GPtrArray) results_sub = NULL;
+		g_autoptr(XbBuilder) builder = xb_builder_new();
+		g_autoptr(XbNode) n = NULL;
+		g_autoptr(XbQuery) query = NULL;
+		g_autoptr(XbSilo) silo = NULL;
+
+		/* import from XML */
+		ret = xb_test_import_xml(builder, xml, &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		silo = xb_builder_compile(builder, flags[i], NULL, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(silo);
+
+		/* anywhere, in document order */
+		results = xb_silo_query(silo, "//checksum", 0, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(results);
+		g_assert_cmpint(results->len, ==, 3);
+		n = g_object_ref(g_ptr_array_index(results, 2));
+		g_assert_cmpstr(xb_node_get_text(n), ==, "ccc");
+		g_clear_object(&n);
+
+		/* only below a matching node */
+		query = xb_query_new(silo, "components//checksum", &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(query);
+		str = xb_query_to_string(query);
+		g_assert_cmpstr(str, ==, "components//checksum");
+		results_sub = xb_silo_query(silo,
+					    "components/component[@type='desktop']//checksum",
+					    0,
+					    &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(results_sub);
+		g_assert_cmpint(results_sub->len, ==, 2);
+
+		/* with predicates */
+		n = xb_silo_query_first(silo, "//checksum[@type='sha256']", &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(n);
+		g_assert_cmpstr(xb_node_get_text(n), ==, "bbb");
+		g_clear_object(&n);
+
+		/* not supported */
+		g_clear_object(&query);
+		query = xb_query_new(silo, "components//..", &error);
+		g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED);
+		g_assert_null(query);
+	}
+}
+
+static void
+xb_node_is_descendant_func(void)
+{
+	XbBuilderCompileFlags flags[] = {XB_BUILDER_COMPILE_FLAG_NONE,
+					 XB_BUILDER_COMPILE_FLAG_SUBTREE_END,
+					 XB_BUILDER_COMPILE_FLAG_SUBTREE_END |
+					     XB_BUILDER_COMPILE_FLAG_WIDE_OFFSETS};
+	const gchar *xml = "<components>\n"
+			   "  <component>\n"
+			   "    <id>gimp.desktop</id>\n"
+			   "    <releases>\n"
+			   "      <release version=\"1.2.3\"/>\n"
+			   "    </releases>\n"
+			   "  </component>\n"
+			   "  <component>\n"
+			   "    <id>bios</id>\n"
+			   "  </component>\n"
+			   "</components>\n"
+			   "<other/>\n";
+
+	for (guint i = 0; i < G_N_ELEMENTS(flags); i++) {
+		gboolean ret;
+		g_autoptr(GError) error = NULL;
+		g_autoptr(XbBuilder) builder = xb_builder_new();
+		g_autoptr(XbNode) components = NULL;
+		g_autoptr(XbNode) gimp = NULL;
+		g_autoptr(XbNode) bios = NULL;
+		g_autoptr(XbNode) release = NULL;
+		g_autoptr(XbNode) other = NULL;
+		g_autoptr(XbSilo) silo = NULL;
+
+		/* import from XML */
+		ret = xb_test_import_xml(builder, xml, &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		silo = xb_builder_compile(builder, flags[i], NULL, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(silo);
+
+		components = xb_silo_query_first(silo, "components", &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(components);
+		gimp = xb_silo_query_first(silo,
+					   "components/component[id='gimp.desktop']",
+					   &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(gimp);
+		bios = xb_silo_query_first(silo, "components/component[id='bios']", &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(bios);
+		release = xb_silo_query_first(silo,
+					      "components/component/releases/release",
+					      &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(release);
+		other = xb_silo_query_first(silo, "other", &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(other);
+
+		/* at any depth */
+		g_assert_true(xb_node_is_descendant(gimp, components));
+		g_assert_true(xb_node_is_descendant(release, components));
+		g_assert_true(xb_node_is_descendant(release, gimp));
+		g_assert_true(xb_node_is_descendant(bios, components));
+
+		/* not itself, siblings, ancestors or other roots */
+		g_assert_false(xb_node_is_descendant(components, components));
+		g_assert_false(xb_node_is_descendant(release, bios));
+		g_assert_false(xb_node_is_descendant(bios, gimp));
+		g_assert_false(xb_node_is_descendant(components, release));
+		g_assert_false(xb_node_is_descendant(other, components));
+		g_assert_false(xb_node_is_descendant(release, other));
+	}
+}
+
+static void
+xb_silo_search_ranked_func(void)
+{
+	const gchar *xml = "<components>\n"
+			   "  <component>\n"
+			   "    <id>inkscape.desktop</id>\n"
+			   "    <name>Inkscape</name>\n"
+			   "    <summary>Vector graphics editor, like gimp</summary>\n"
+			   "  </component>\n"
+			   "  <component>\n"
+			   "    <id>gimp.desktop</id>\n"
+			   "    <name>GIMP</name>\n"
+			   "    <summary>Create images and edit photographs</summary>\n"
+			   "    <keywords>\n"
+			   "      <keyword>Editor</keyword>\n"
+			   "    </keywords>\n"
+			   "  </component>\n"
+			   "  <component>\n"
+			   "    <id>gimpy.desktop</id>\n"
+			   "    <name>Gimpy Game</name>\n"
+			   "  </component>\n"
+			   "  <component>\n"
+			   "    <id>calculator.desktop</id>\n"
+			   "    <name>Calculator</name>\n"
+			   "  </component>\n"
+			   "</components>\n";
+
+	/* the second time the names are tokenized by the builder */
+	for (guint i = 0; i < 2; i++) {
+		gboolean ret;
+		g_autoptr(GArray) scores = NULL;
+		g_autoptr(GError) error = NULL;
+		g_autoptr(GHashTable) weights = g_hash_table_new(g_str_hash, g_str_equal);
+		g_autoptr(GPtrArray) results = NULL;
+		g_autoptr(XbBuilder) builder = xb_builder_new();
+		g_autoptr(XbSilo) silo = NULL;
+
+		/* import from XML */
+		ret = xb_test_import_xml(builder, xml, &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		if (i == 1) {
+			g_autoptr(XbBuilderFixup) fixup = NULL;
+			fixup = xb_builder_fixup_new("TextTokenize",
+						     xb_builder_fixup_tokenize_cb,
+						     NULL,
+						     NULL);
+			xb_builder_add_fixup(builder, fixup);
+		}
+		silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(silo);
+		g_hash_table_insert(weights, (gpointer) "name", GUINT_TO_POINTER(100));
+		g_hash_table_insert(weights, (gpointer) "keyword", GUINT_TO_POINTER(50));
+		g_hash_table_insert(weights, (gpointer) "summary", GUINT_TO_POINTER(30));
+
+		/* exact beats prefix, and only the best two are returned */
+		results = xb_silo_search_ranked(silo,
+						"components/component",
+						"GIMP",
+						weights,
+						2,
+						&scores,
+						&error);
+		g_assert_no_error(error);
+		g_assert_nonnull(results);
+		g_assert_cmpint(results->len, ==, 2);
+		g_assert_cmpint(scores->len, ==, 2);
+		g_assert_cmpstr(xb_node_query_text(g_ptr_array_index(results, 0), "id", NULL),
+				==,
+				"gimp.desktop");
+		g_assert_cmpint(g_array_index(scores, guint, 0), ==, 200);
+		g_assert_cmpstr(xb_node_query_text(g_ptr_array_index(results, 1), "id", NULL),
+				==,
+				"gimpy.desktop");
+		g_assert_cmpint(g_array_index(scores, guint, 1), ==, 100);
+		g_clear_pointer(&results, g_ptr_array_unref);
+		g_clear_pointer(&scores, g_array_unref);
+
+		/* each search term adds to the score */
+		results = xb_silo_search_ranked(silo,
+						"components/component",
+						"gimp editor",
+						weights,
+						0,
+						&scores,
+						&error);
+		g_assert_no_error(error);
+		g_assert_nonnull(results);
+		g_assert_cmpint(results->len, ==, 3);
+		g_assert_cmpstr(xb_node_query_text(g_ptr_array_index(results, 0), "id", NULL),
+				==,
+				"gimp.desktop");
+		g_assert_cmpint(g_array_index(scores, guint, 0), ==, 300);
+		g_assert_cmpstr(xb_node_query_text(g_ptr_array_index(results, 1), "id", NULL),
+				==,
+				"inkscape.desktop");
+		g_assert_cmpint(g_array_index(scores, guint, 1), ==, 120);
+		g_clear_pointer(&results, g_ptr_array_unref);
+
+		/* no matches */
+		results = xb_silo_search_ranked(silo,
+						"components/component",
+						"spreadsheet",
+						weights,
+						0,
+						NULL,
+						&error);
+		g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+		g_assert_null(results);
+	}
+}
+
 static void
 xb_builder_multiple_roots_func(void)
 {
@@ -2605,7 +4481,9 @@ xb_speed_func(void)
 	g_autoptr(GPtrArray) results = NULL;
 	g_autoptr(GString) xml = g_string_new(NULL);
 	g_autoptr(GTimer) timer = g_timer_new();
+	g_autoptr(XbBuilder) builder = xb_builder_new();
 	g_autoptr(XbSilo) silo = NULL;
+	g_autoptr(XbSilo) silo_split = NULL;
 
 #ifdef __s390x__
 	/* this is run with qemu and takes too much time */
@@ -2756,6 +4634,28 @@ xb_speed_func(void)
 		g_clear_object(&n);
 	}
 	g_print("query[x%u]: %.3fms\n", n_components, g_timer_elapsed(timer, NULL) * 1000);
+
+	/* factorial search, using the split layout */
+	ret = xb_test_import_xml(builder, xml->str, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	silo_split = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_SPLIT_LAYOUT, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo_split);
+	g_timer_reset(timer);
+	for (guint i = 0; i < n_components; i += 20) {
+		g_autofree gchar *xpath2 = NULL;
+		xpath2 = g_strdup_printf(
+		    "components/component[@type='firmware']/id[text()='%06u.firmware']",
+		    i);
+		n = xb_silo_query_first(silo_split, xpath2, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(n);
+		g_clear_object(&n);
+	}
+	g_print("query[x%u]{split}: %.3fms\n",
+		n_components,
+		g_timer_elapsed(timer, NULL) * 1000);
 }
 
 int
@@ -2781,6 +4681,16 @@ main(int argc, char **argv)
 	g_test_add_func("/libxmlb/node{data}", xb_node_data_func);
 	g_test_add_func("/libxmlb/node{export}", xb_node_export_func);
 	g_test_add_func("/libxmlb/builder", xb_builder_func);
+	g_test_add_func("/libxmlb/builder{split-layout}", xb_builder_split_layout_func);
+	g_test_add_func("/libxmlb/builder{split-layout-truncated}",
+			xb_builder_split_layout_truncated_func);
+	g_test_add_func("/libxmlb/builder{wide-offsets}", xb_builder_wide_offsets_func);
+	g_test_add_func("/libxmlb/builder{casefold}", xb_builder_casefold_func);
+	g_test_add_func("/libxmlb/builder{numeric}", xb_builder_numeric_func);
+	g_test_add_func("/libxmlb/builder{version-keys}", xb_builder_version_keys_func);
+	g_test_add_func("/libxmlb/builder{stem}", xb_builder_stem_func);
+	g_test_add_func("/libxmlb/builder{stem-literal}", xb_builder_stem_literal_func);
+	g_test_add_func("/libxmlb/builder{trigram-index}", xb_builder_trigram_index_func);
 	g_test_add_func("/libxmlb/builder{comments}", xb_builder_comments_func);
 	g_test_add_func("/libxmlb/builder{native-lang}", xb_builder_native_lang_func);
 	g_test_add_func("/libxmlb/builder{native-lang-nested}", xb_builder_native_lang2_func);
@@ -2809,6 +4719,21 @@ main(int argc, char **argv)
 	g_test_add_func("/libxmlb/xpath", xb_xpath_func);
 	g_test_add_func("/libxmlb/xpath-query", xb_xpath_query_func);
 	g_test_add_func("/libxmlb/xpath-query{reverse}", xb_xpath_query_reverse_func);
+	g_test_add_func("/libxmlb/xpath-query{reverse-limit}", xb_xpath_query_reverse_limit_func);
+	g_test_add_func("/libxmlb/xpath-query{offset}", xb_xpath_query_offset_func);
+	g_test_add_func("/libxmlb/xpath-query{offset-descendant}",
+			xb_xpath_query_offset_descendant_func);
+	g_test_add_func("/libxmlb/xpath-query{bloom}", xb_xpath_query_bloom_func);
+	g_test_add_func("/libxmlb/xpath-query{reorder}", xb_xpath_query_reorder_func);
+	g_test_add_func("/libxmlb/xpath-query{predicates}", xb_xpath_query_predicates_func);
+	g_test_add_func("/libxmlb/xpath-query{compiled}", xb_xpath_query_compiled_func);
+	g_test_add_func("/libxmlb/xpath-query{intern}", xb_xpath_query_intern_func);
+	g_test_add_func("/libxmlb/xpath-query{bind-set}", xb_xpath_query_bind_set_func);
+	g_test_add_func("/libxmlb/xpath-query{bindings-offset}",
+			xb_xpath_query_bindings_offset_func);
+	g_test_add_func("/libxmlb/xpath-query{val64}", xb_xpath_query_val64_func);
+	g_test_add_func("/libxmlb/xpath-query{parallel}", xb_xpath_query_parallel_func);
+	g_test_add_func("/libxmlb/xpath-query{batch}", xb_xpath_query_batch_func);
 	g_test_add_func("/libxmlb/xpath-query{force-node-cache}",
 			xb_xpath_query_force_node_cache_func);
 	g_test_add_func("/libxmlb/xpath{helpers}", xb_xpath_helpers_func);
@@ -2816,6 +4741,9 @@ main(int argc, char **argv)
 	g_test_add_func("/libxmlb/xpath{incomplete}", xb_xpath_incomplete_func);
 	g_test_add_func("/libxmlb/xpath-parent", xb_xpath_parent_func);
 	g_test_add_func("/libxmlb/xpath-glob", xb_xpath_glob_func);
+	g_test_add_func("/libxmlb/xpath-descendant", xb_xpath_descendant_func);
+	g_test_add_func("/libxmlb/node-is-descendant", xb_node_is_descendant_func);
+	g_test_add_func("/libxmlb/silo-search-ranked", xb_silo_search_ranked_func);
 	g_test_add_func("/libxmlb/xpath-node", xb_xpath_node_func);
 	g_test_add_func("/libxmlb/xpath-parent-subnode", xb_xpath_parent_subnode_func);
 	g_test_add_func("/libxmlb/multiple-roots", xb_builder_multiple_roots_func);
@@ -2823,6 +4751,8 @@ main(int argc, char **argv)
 	if (g_test_perf()) {
 		g_test_add_func("/libxmlb/threading", xb_threading_func);
 		g_test_add_func("/libxmlb/speed", xb_speed_func);
+		g_test_add_func("/libxmlb/builder{trigram-index-speed}",
+				xb_builder_trigram_index_speed_func);
 	}
 	return g_test_run();
 }
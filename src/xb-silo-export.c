@@ -19,8 +19,9 @@
 typedef struct {
 	GString *xml;
 	XbNodeExportFlags flags;
-	guint32 off;
+	guint64 off;
 	guint level;
+	gboolean wide;
 } XbSiloExportHelper;
 
 static gboolean
@@ -39,22 +40,31 @@ xb_silo_export_node(XbSilo *self, XbSiloExportHelper *helper, XbSiloNode *sn, GE
 
 	/* add any attributes */
 	for (guint8 i = 0; i < xb_silo_node_get_attr_count(sn); i++) {
-		XbSiloNodeAttr *a = xb_silo_node_get_attr(sn, i);
-		g_autofree gchar *key =
-		    xb_string_xml_escape(xb_silo_from_strtab(self, a->attr_name));
-		g_autofree gchar *val =
-		    xb_string_xml_escape(xb_silo_from_strtab(self, a->attr_value));
+		XbSiloNodeAttr *a = xb_silo_get_node_attr(self, sn, i);
+		g_autofree gchar *key = NULL;
+		g_autofree gchar *val = NULL;
+		if (a == NULL) {
+			g_set_error(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "no attr %u at %" G_GUINT64_FORMAT,
+				    (guint)i,
+				    helper->off);
+			return FALSE;
+		}
+		key = xb_string_xml_escape(xb_silo_from_strtab(self, a->attr_name));
+		val = xb_string_xml_escape(xb_silo_from_strtab(self, a->attr_value));
 		g_string_append_printf(helper->xml, " %s=\"%s\"", key, val);
 	}
 
 	/* collapse open/close tags together if no text or children */
 	if (helper->flags & XB_NODE_EXPORT_FLAG_COLLAPSE_EMPTY &&
-	    xb_silo_node_get_text_idx(sn) == XB_SILO_UNSET &&
+	    xb_silo_get_node_text_idx(self, sn) == XB_SILO_UNSET &&
 	    xb_silo_get_child_node(self, sn) == NULL) {
 		g_string_append(helper->xml, " />");
 	} else {
 		/* finish the opening tag and add any text if it exists */
-		if (xb_silo_node_get_text_idx(sn) != XB_SILO_UNSET) {
+		if (xb_silo_get_node_text_idx(self, sn) != XB_SILO_UNSET) {
 			g_autofree gchar *text =
 			    xb_string_xml_escape(xb_silo_get_node_text(self, sn));
 			g_string_append(helper->xml, ">");
@@ -64,7 +74,7 @@ xb_silo_export_node(XbSilo *self, XbSiloExportHelper *helper, XbSiloNode *sn, GE
 			if (helper->flags & XB_NODE_EXPORT_FLAG_FORMAT_MULTILINE)
 				g_string_append(helper->xml, "\n");
 		}
-		helper->off += xb_silo_node_get_size(sn);
+		helper->off += xb_silo_node_get_size(sn, helper->wide);
 
 		/* recurse deeper */
 		while (xb_silo_node_has_flag(_xb_silo_get_node(self, helper->off),
@@ -82,15 +92,15 @@ xb_silo_export_node(XbSilo *self, XbSiloExportHelper *helper, XbSiloNode *sn, GE
 			g_set_error(error,
 				    G_IO_ERROR,
 				    G_IO_ERROR_INVALID_DATA,
-				    "no seninel at %" G_GUINT32_FORMAT,
+				    "no seninel at %" G_GUINT64_FORMAT,
 				    helper->off);
 			return FALSE;
 		}
-		helper->off += xb_silo_node_get_size(sn2);
+		helper->off += xb_silo_node_get_size(sn2, helper->wide);
 
 		/* add closing tag */
 		if ((helper->flags & XB_NODE_EXPORT_FLAG_FORMAT_INDENT) > 0 &&
-		    xb_silo_node_get_text_idx(sn) == XB_SILO_UNSET) {
+		    xb_silo_get_node_text_idx(self, sn) == XB_SILO_UNSET) {
 			for (guint i = 0; i < helper->level; i++)
 				g_string_append(helper->xml, "  ");
 		}
@@ -100,7 +110,7 @@ xb_silo_export_node(XbSilo *self, XbSiloExportHelper *helper, XbSiloNode *sn, GE
 	}
 
 	/* add any optional tail */
-	if (xb_silo_node_get_tail_idx(sn) != XB_SILO_UNSET) {
+	if (xb_silo_get_node_tail_idx(self, sn) != XB_SILO_UNSET) {
 		g_autofree gchar *tail = xb_string_xml_escape(xb_silo_get_node_tail(self, sn));
 		g_string_append(helper->xml, tail);
 	}
@@ -119,7 +129,8 @@ xb_silo_export_with_root(XbSilo *self, XbSiloNode *sroot, XbNodeExportFlags flag
 	XbSiloExportHelper helper = {
 	    .flags = flags,
 	    .level = 0,
-	    .off = sizeof(XbSiloHeader),
+	    .off = 0,
+	    .wide = xb_silo_is_wide(self),
 	};
 
 	g_return_val_if_fail(XB_IS_SILO(self), NULL);
@@ -14,54 +14,60 @@ typedef enum {
 	XB_SILO_NODE_FLAG_NONE = 0,
 	XB_SILO_NODE_FLAG_IS_ELEMENT = 1 << 0,
 	XB_SILO_NODE_FLAG_IS_TOKENIZED = 1 << 1,
+	XB_SILO_NODE_FLAG_HAS_BLOOM = 1 << 2,
+	XB_SILO_NODE_FLAG_IS_SPLIT = 1 << 3,
 } XbSiloNodeFlag;
 
 typedef struct __attribute__((packed)) {
 	guint8 flags : 2;
 	guint8 attr_count : 6;
-	guint8 token_count;   /* ONLY when is_node */
-	guint32 element_name; /* ONLY when is_node: from strtab */
-	guint32 parent;	      /* ONLY when is_node: from 0 */
-	guint32 next;	      /* ONLY when is_node: from 0 */
-	guint32 text;	      /* ONLY when is_node: from strtab */
-	guint32 tail;	      /* ONLY when is_node: from strtab */
+	guint8 token_count : 6; /* ONLY when is_node */
+	guint8 flags_hi : 2;	/* ONLY when is_node: has_bloom and is_split */
+	guint32 element_name;	/* ONLY when is_node: from strtab */
+	guint32 parent;		/* ONLY when is_node: from 0, low bits when wide */
+	guint32 next;		/* ONLY when is_node: from 0, low bits when wide */
+	guint32 text;	      /* ONLY when is_node: from strtab, or node index when is_split */
+	guint32 tail;	      /* ONLY when is_node and not is_split: from strtab */
 			      /*
-			      guint32		attrs[attr_count];
-			      guint32		tokens[token_count];
+			      guint32		attrs[attr_count];	NOT when is_split
+			      guint32		tokens[token_count];	NOT when is_split
+			      guint64		bloom;	ONLY when has_bloom
+			      guint32		parent_hi;	ONLY when wide
+			      guint32		next_hi;	ONLY when wide
 			      */
 } XbSiloNode;
 
+/* the navigation record used when is_split, where everything else is stored in
+ * the cold sections indexed by the node index */
+#define XB_SILO_NODE_SPLIT_SIZE (G_STRUCT_OFFSET(XbSiloNode, tail))
+
 typedef struct __attribute__((packed)) {
 	guint32 attr_name;  /* from strtab */
 	guint32 attr_value; /* from strtab */
 } XbSiloNodeAttr;
 
-/* private */
-static inline gboolean
-xb_silo_node_has_flag(const XbSiloNode *self, XbSiloNodeFlag flag)
+/* private: sentinels are only one byte long, so never read ->flags_hi */
+static inline guint8
+xb_silo_node_get_flags(const XbSiloNode *self)
 {
-	return (self->flags & flag) > 0;
+	if ((self->flags & XB_SILO_NODE_FLAG_IS_ELEMENT) == 0)
+		return self->flags;
+	return self->flags | (self->flags_hi << 2);
 }
 
-static inline guint32
-xb_silo_node_get_size(const XbSiloNode *self)
+/* private */
+static inline gboolean
+xb_silo_node_has_flag(const XbSiloNode *self, XbSiloNodeFlag flag)
 {
-	if (xb_silo_node_has_flag(self, XB_SILO_NODE_FLAG_IS_ELEMENT)) {
-		guint8 sz = sizeof(XbSiloNode);
-		sz += self->attr_count * sizeof(XbSiloNodeAttr);
-		sz += self->token_count * sizeof(guint32);
-		return sz;
-	}
-
-	/* sentinel */
-	return sizeof(guint8);
+	return (xb_silo_node_get_flags(self) & flag) > 0;
 }
 
 /* private */
-static inline guint8
-xb_silo_node_get_flags(const XbSiloNode *self)
+static inline void
+xb_silo_node_add_flag(XbSiloNode *self, XbSiloNodeFlag flag)
 {
-	return self->flags;
+	self->flags |= flag & 0x3;
+	self->flags_hi |= flag >> 2;
 }
 
 /* private */
@@ -78,6 +84,13 @@ xb_silo_node_get_tail_idx(const XbSiloNode *self)
 	return self->tail;
 }
 
+/* private */
+static inline guint32
+xb_silo_node_get_split_idx(const XbSiloNode *self)
+{
+	return self->text;
+}
+
 /* private */
 static inline guint8
 xb_silo_node_get_attr_count(const XbSiloNode *self)
@@ -121,3 +134,121 @@ xb_silo_node_get_token_idx(const XbSiloNode *self, guint idx)
 	memcpy(&stridx, (guint8 *)self + off, sizeof(stridx));
 	return stridx;
 }
+
+/* private */
+static inline guint64
+xb_silo_node_bloom_for_idx(guint32 element_name)
+{
+	/* multiplicative hash, using the top 6 bits to select one of 64 */
+	return (guint64)1 << ((guint32)(element_name * 0x9e3779b1u) >> 26);
+}
+
+/* private */
+static inline guint32
+xb_silo_node_get_bloom_offset(const XbSiloNode *self)
+{
+	guint32 off;
+	if (xb_silo_node_has_flag(self, XB_SILO_NODE_FLAG_IS_SPLIT))
+		return XB_SILO_NODE_SPLIT_SIZE;
+	off = sizeof(XbSiloNode);
+	off += self->attr_count * sizeof(XbSiloNodeAttr);
+	off += self->token_count * sizeof(guint32);
+	return off;
+}
+
+/* private */
+static inline guint64
+xb_silo_node_get_bloom(const XbSiloNode *self)
+{
+	guint64 bloom = 0;
+
+	/* not built with a bloom filter, so anything might be a descendant */
+	if (!xb_silo_node_has_flag(self, XB_SILO_NODE_FLAG_HAS_BLOOM))
+		return G_MAXUINT64;
+	memcpy(&bloom, (guint8 *)self + xb_silo_node_get_bloom_offset(self), sizeof(bloom));
+	return bloom;
+}
+
+/* private */
+static inline void
+xb_silo_node_set_bloom(XbSiloNode *self, guint64 bloom)
+{
+	if (!xb_silo_node_has_flag(self, XB_SILO_NODE_FLAG_HAS_BLOOM))
+		return;
+	memcpy((guint8 *)self + xb_silo_node_get_bloom_offset(self), &bloom, sizeof(bloom));
+}
+
+/* private */
+static inline guint32
+xb_silo_node_get_size(const XbSiloNode *self, gboolean wide)
+{
+	guint32 sz;
+
+	/* sentinel */
+	if (!xb_silo_node_has_flag(self, XB_SILO_NODE_FLAG_IS_ELEMENT))
+		return sizeof(guint8);
+
+	sz = xb_silo_node_get_bloom_offset(self);
+	if (xb_silo_node_has_flag(self, XB_SILO_NODE_FLAG_HAS_BLOOM))
+		sz += sizeof(guint64);
+	if (wide)
+		sz += 2 * sizeof(guint32);
+	return sz;
+}
+
+/* private */
+static inline guint32
+xb_silo_node_get_wide_offset(const XbSiloNode *self)
+{
+	guint32 off = xb_silo_node_get_bloom_offset(self);
+	if (xb_silo_node_has_flag(self, XB_SILO_NODE_FLAG_HAS_BLOOM))
+		off += sizeof(guint64);
+	return off;
+}
+
+/* private */
+static inline guint64
+xb_silo_node_get_parent(const XbSiloNode *self, gboolean wide)
+{
+	guint32 hi;
+	if (!wide)
+		return self->parent;
+	memcpy(&hi, (guint8 *)self + xb_silo_node_get_wide_offset(self), sizeof(hi));
+	return ((guint64)hi << 32) | self->parent;
+}
+
+/* private */
+static inline guint64
+xb_silo_node_get_next(const XbSiloNode *self, gboolean wide)
+{
+	guint32 hi;
+	if (!wide)
+		return self->next;
+	memcpy(&hi,
+	       (guint8 *)self + xb_silo_node_get_wide_offset(self) + sizeof(guint32),
+	       sizeof(hi));
+	return ((guint64)hi << 32) | self->next;
+}
+
+/* private */
+static inline void
+xb_silo_node_set_parent(XbSiloNode *self, guint64 parent, gboolean wide)
+{
+	guint32 hi = parent >> 32;
+	self->parent = (guint32)parent;
+	if (wide)
+		memcpy((guint8 *)self + xb_silo_node_get_wide_offset(self), &hi, sizeof(hi));
+}
+
+/* private */
+static inline void
+xb_silo_node_set_next(XbSiloNode *self, guint64 next, gboolean wide)
+{
+	guint32 hi = next >> 32;
+	self->next = (guint32)next;
+	if (wide) {
+		memcpy((guint8 *)self + xb_silo_node_get_wide_offset(self) + sizeof(guint32),
+		       &hi,
+		       sizeof(hi));
+	}
+}
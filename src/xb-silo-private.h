@@ -21,17 +21,115 @@ typedef struct __attribute__((packed)) {
 	guint32 version;
 	XbGuid guid;
 	guint16 strtab_ntags;
-	guint8 padding[2];
+	guint8 nsections;
+	guint8 padding[1];
 	guint32 strtab;
+	/*
+	XbSiloSection	sections[nsections];
+	*/
 } XbSiloHeader;
 
+typedef enum {
+	XB_SILO_SECTION_KIND_UNKNOWN,
+	XB_SILO_SECTION_KIND_NODE_TEXT,	      /* guint32[node_index], from strtab */
+	XB_SILO_SECTION_KIND_NODE_TAIL,	      /* guint32[node_index], from strtab */
+	XB_SILO_SECTION_KIND_NODE_ATTRS,      /* guint32[node_index], into attrs */
+	XB_SILO_SECTION_KIND_NODE_TOKENS,     /* guint32[node_index], into tokens */
+	XB_SILO_SECTION_KIND_ATTRS,	      /* XbSiloNodeAttr[] */
+	XB_SILO_SECTION_KIND_TOKENS,	      /* guint32[], from strtab */
+	XB_SILO_SECTION_KIND_STRTAB_LOWER,    /* XbSiloStrtabFold[], sorted by idx */
+	XB_SILO_SECTION_KIND_STRTAB_UPPER,    /* XbSiloStrtabFold[], sorted by idx */
+	XB_SILO_SECTION_KIND_STRTAB_SORTED,   /* guint32[], from strtab, sorted by string */
+	XB_SILO_SECTION_KIND_STRTAB_NUMERIC,  /* XbSiloStrtabNumeric[], sorted by idx */
+	XB_SILO_SECTION_KIND_STRTAB_VERSION,  /* XbSiloStrtabNumeric[], sorted by idx */
+	XB_SILO_SECTION_KIND_CHILDREN_IDX,    /* XbSiloChildren[], sorted by parent */
+	XB_SILO_SECTION_KIND_CHILDREN,	      /* guint64[], node offsets in document order */
+	XB_SILO_SECTION_KIND_ELEMENTS_IDX,    /* XbSiloElements[], sorted by element_name */
+	XB_SILO_SECTION_KIND_ELEMENTS,	      /* guint64[], node offsets in document order */
+	XB_SILO_SECTION_KIND_SUBTREE_END,     /* XbSiloSubtree[], sorted by offset */
+	XB_SILO_SECTION_KIND_STRTAB_STEM,     /* XbSiloStrtabStem[], sorted by idx then lang */
+	XB_SILO_SECTION_KIND_TRIGRAMS_IDX,    /* XbSiloTrigrams[], sorted by trigram */
+	XB_SILO_SECTION_KIND_TRIGRAMS,	      /* guint32[], from strtab, sorted per trigram */
+	XB_SILO_SECTION_KIND_TRIGRAMS_STRS,   /* guint32[], from strtab, sorted */
+	/*< private >*/
+	XB_SILO_SECTION_KIND_LAST
+} XbSiloSectionKind;
+
+/* only strings that change when case-folded are included */
+typedef struct __attribute__((packed)) {
+	guint32 idx;	    /* from strtab */
+	guint32 idx_folded; /* from strtab */
+} XbSiloStrtabFold;
+
+/* only strings that are unsigned base-10 integers, or versions that fit in a
+ * key from xb_string_version_key(), are included */
+typedef struct __attribute__((packed)) {
+	guint32 idx; /* from strtab */
+	guint64 val;
+} XbSiloStrtabNumeric;
+
+/* only the text of nodes is included, for each language it is used with */
+typedef struct __attribute__((packed)) {
+	guint32 idx;	  /* from strtab */
+	guint32 lang;	  /* from strtab, or XB_SILO_UNSET if there is no xml:lang */
+	guint32 idx_stem; /* from strtab */
+} XbSiloStrtabStem;
+
+/* only nodes with at least one child are included */
+typedef struct __attribute__((packed)) {
+	guint64 parent; /* from 0, or 0 for the root nodes */
+	guint32 idx;	/* into the children section */
+	guint32 count;
+} XbSiloChildren;
+
+/* the postings for each element name that is used */
+typedef struct __attribute__((packed)) {
+	guint32 element_name; /* from strtab */
+	guint32 idx;	      /* into the elements section */
+	guint32 count;
+} XbSiloElements;
+
+/* only nodes without a next sibling are included, as the subtree of any other
+ * node ends where the next sibling starts */
+typedef struct __attribute__((packed)) {
+	guint64 offset; /* from 0 */
+	guint64 end;	/* from 0, after the sentinel */
+} XbSiloSubtree;
+
+/* the strings that contain each trigram of bytes, for the text of the nodes
+ * with XB_BUILDER_NODE_FLAG_TRIGRAM_INDEX */
+typedef struct __attribute__((packed)) {
+	guint32 trigram; /* packed from the first byte */
+	guint32 idx;	 /* into the trigrams section */
+	guint32 count;
+} XbSiloTrigrams;
+
+/* all sections are between the nodetab and the strtab, aligned to 8 bytes */
+typedef struct __attribute__((packed)) {
+	guint32 kind;
+	guint64 offset; /* from 0 */
+	guint64 size;
+} XbSiloSection;
+
+/* 40 bytes, native byte order, ONLY when XB_SILO_VERSION_WIDE */
+typedef struct __attribute__((packed)) {
+	XbSiloHeader hdr; /* hdr.strtab is unused */
+	guint64 strtab;
+} XbSiloHeaderWide;
+
 #define XB_SILO_MAGIC_BYTES 0x624c4d58
-#define XB_SILO_VERSION	    0x00000008
+#define XB_SILO_VERSION	    0x00000009
+#define XB_SILO_VERSION_WIDE 0x00010009 /* all nodes are wide, bump with XB_SILO_VERSION */
+
+/* the number of contains() needles each query remembers the candidates for */
+#define XB_SILO_QUERY_DATA_TRIGRAMS_MAX 4
 
 typedef struct {
 	/*< private >*/
 	XbSiloNode *sn;
 	guint position;
+	const gchar *trigrams_search[XB_SILO_QUERY_DATA_TRIGRAMS_MAX];
+	GArray *trigrams_candidates[XB_SILO_QUERY_DATA_TRIGRAMS_MAX]; /* of guint32, nullable */
 } XbSiloQueryData;
 
 const gchar *
@@ -40,16 +138,20 @@ void
 xb_silo_strtab_index_insert(XbSilo *self, guint32 offset);
 guint32
 xb_silo_strtab_index_lookup(XbSilo *self, const gchar *str);
+guint32
+xb_silo_strtab_find(XbSilo *self, const gchar *str);
 XbSiloNode *
-xb_silo_get_node(XbSilo *self, guint32 off);
+xb_silo_get_node(XbSilo *self, guint64 off);
 XbMachine *
 xb_silo_get_machine(XbSilo *self);
-guint32
+guint64
 xb_silo_get_strtab(XbSilo *self);
 guint32
 xb_silo_get_strtab_idx(XbSilo *self, const gchar *element);
-guint32
+guint64
 xb_silo_get_offset_for_node(XbSilo *self, XbSiloNode *n);
+gconstpointer
+xb_silo_get_section(XbSilo *self, XbSiloSectionKind kind, guint64 *size);
 XbSiloNode *
 xb_silo_get_root_node(XbSilo *self);
 XbSiloNode *
@@ -58,12 +160,28 @@ XbSiloNode *
 xb_silo_get_next_node(XbSilo *self, XbSiloNode *n);
 XbSiloNode *
 xb_silo_get_child_node(XbSilo *self, XbSiloNode *n);
+const guint64 *
+xb_silo_get_children(XbSilo *self, XbSiloNode *n, guint32 *count);
+const guint64 *
+xb_silo_get_elements(XbSilo *self, guint32 element_name, guint32 *count);
+guint64
+xb_silo_get_subtree_end(XbSilo *self, XbSiloNode *n);
+gboolean
+xb_silo_is_descendant(XbSilo *self, XbSiloNode *n, XbSiloNode *ancestor);
 const gchar *
 xb_silo_get_node_element(XbSilo *self, XbSiloNode *n);
 const gchar *
 xb_silo_get_node_text(XbSilo *self, XbSiloNode *n);
 const gchar *
 xb_silo_get_node_tail(XbSilo *self, XbSiloNode *n);
+guint32
+xb_silo_get_node_text_idx(XbSilo *self, XbSiloNode *n);
+guint32
+xb_silo_get_node_tail_idx(XbSilo *self, XbSiloNode *n);
+XbSiloNodeAttr *
+xb_silo_get_node_attr(XbSilo *self, XbSiloNode *n, guint8 idx);
+guint32
+xb_silo_get_node_token_idx(XbSilo *self, XbSiloNode *n, guint idx);
 XbSiloNodeAttr *
 xb_silo_get_node_attr_by_str(XbSilo *self, XbSiloNode *n, const gchar *name);
 guint
@@ -76,15 +194,21 @@ void
 xb_silo_add_profile(XbSilo *self, GTimer *timer, const gchar *fmt, ...) G_GNUC_PRINTF(3, 4);
 gboolean
 xb_silo_is_empty(XbSilo *self);
+gboolean
+xb_silo_is_wide(XbSilo *self);
 void
 xb_silo_uninvalidate(XbSilo *self);
 XbSiloProfileFlags
 xb_silo_get_profile_flags(XbSilo *self);
+void
+xb_silo_query_data_clear(XbSiloQueryData *self);
+
+G_DEFINE_AUTO_CLEANUP_CLEAR_FUNC(XbSiloQueryData, xb_silo_query_data_clear)
 
 extern gint _XbSilo_data_offset;
 
 static inline XbSiloNode *
-_xb_silo_get_node(const XbSilo *self, guint32 off)
+_xb_silo_get_node(const XbSilo *self, guint64 off)
 {
 	const guint8 **data = (gconstpointer)((gintptr)self + _XbSilo_data_offset);
 	return (XbSiloNode *)((*data) + off);
@@ -11,6 +11,7 @@
 #include <gio/gio.h>
 #include <string.h>
 
+#include "xb-machine-private.h"
 #include "xb-node-private.h"
 #include "xb-opcode-private.h"
 #include "xb-opcode.h"
@@ -46,44 +47,41 @@ xb_silo_query_node_matches(XbSilo *self,
 	if (section->predicates != NULL) {
 		for (guint i = 0; i < section->predicates->len; i++) {
 			XbStack *opcodes = g_ptr_array_index(section->predicates, i);
-			g_auto(XbValueBindings) predicate_bindings = XB_VALUE_BINDINGS_INIT();
-			guint predicate_bindings_idx = 0;
-			XbValueBindings *predicate_bindings_ptr = NULL;
-
-			if (bindings != NULL)
-				predicate_bindings_ptr = &predicate_bindings;
-
-			/* set up the bindings for this predicate */
-			for (guint k = 0; bindings != NULL && k < _xb_stack_get_size(opcodes); k++) {
-				XbOpcode *op = _xb_stack_peek(opcodes, k);
-				if (_xb_opcode_is_binding(op)) {
-					/* ignore errors as they’ll be caught by xb_machine_run() */
-					xb_value_bindings_copy_binding(bindings,
-								       bindings_offset +
-									   predicate_bindings_idx,
-								       &predicate_bindings,
-								       predicate_bindings_idx);
-					predicate_bindings_idx++;
-				}
-			}
+			XbMachineProgram *program = NULL;
+			guint predicate_bindings_offset =
+			    bindings_offset + g_array_index(section->bindings_offsets, guint, i);
 
 			/* run the predicate; pass NULL for the bindings iff
 			 * (bindings == NULL), as that means we’ve been called
 			 * with pre-0.3.0-style pre-bound values */
-			if (!xb_machine_run_with_bindings(machine,
-							  opcodes,
-							  predicate_bindings_ptr,
-							  result,
-							  query_data,
-							  error))
+			if (section->programs != NULL)
+				program = g_ptr_array_index(section->programs, i);
+			if (program != NULL) {
+				if (!xb_machine_program_run(machine,
+							    program,
+							    bindings,
+							    predicate_bindings_offset,
+							    result,
+							    query_data,
+							    error))
+					return FALSE;
+			} else if (!xb_machine_run_with_bindings_offset(machine,
+									opcodes,
+									bindings,
+									predicate_bindings_offset,
+									result,
+									query_data,
+									error))
 				return FALSE;
 
-			bindings_offset += predicate_bindings_idx;
+			/* all predicates have to match */
+			if (!*result)
+				return TRUE;
 		}
 	}
 
 	if (bindings_offset_end_out != NULL)
-		*bindings_offset_end_out = bindings_offset;
+		*bindings_offset_end_out = bindings_offset + section->n_bindings;
 
 	/* success */
 	return TRUE;
@@ -95,6 +93,8 @@ xb_silo_query_node_matches(XbSilo *self,
  * @XB_SILO_QUERY_HELPER_USE_SN: Return #XbSiloNodes as results, rather than
  *    wrapping them in #XbNode. This assumes that they’ll be wrapped later.
  * @XB_SILO_QUERY_HELPER_FORCE_NODE_CACHE: Always cache the #XbNode objects
+ * @XB_SILO_QUERY_HELPER_PARALLEL: Split large sibling chains across threads
+ * @XB_SILO_QUERY_HELPER_REVERSE: Walk the siblings from the last to the first
  *
  * Flags for #XbSiloQueryHelper.
  *
@@ -104,16 +104,29 @@ typedef enum {
 	XB_SILO_QUERY_HELPER_NONE = 0,
 	XB_SILO_QUERY_HELPER_USE_SN = 1 << 0,
 	XB_SILO_QUERY_HELPER_FORCE_NODE_CACHE = 1 << 1,
+	XB_SILO_QUERY_HELPER_PARALLEL = 1 << 2,
+	XB_SILO_QUERY_HELPER_REVERSE = 1 << 3,
 } XbSiloQueryHelperFlags;
 
+/* called for each result instead of adding it to the results array */
+typedef void (*XbSiloQueryResultFunc)(XbSilo *self, XbSiloNode *sn, gpointer user_data);
+
+/* the minimum number of siblings each thread is given */
+#define XB_SILO_QUERY_PARALLEL_MIN 1024
+
 typedef struct {
 	GPtrArray *sections; /* of XbQuerySection */
 	GPtrArray *results;  /* of XbNode or XbSiloNode (see @flags) */
 	XbValueBindings *bindings;
-	GHashTable *results_hash; /* of sn:1 */
+	GHashTable *results_hash;	 /* of sn:1 */
+	GHashTable *results_hash_parent; /* (nullable): of sn:1, read only */
 	guint limit;
+	guint offset; /* results still to be skipped */
+	gboolean dedup_skipped;
 	XbSiloQueryHelperFlags flags;
 	XbSiloQueryData *query_data;
+	XbSiloQueryResultFunc result_func; /* (nullable) */
+	gpointer result_data;
 } XbSiloQueryHelper;
 
 static gboolean
@@ -121,6 +134,22 @@ xb_silo_query_section_add_result(XbSilo *self, XbSiloQueryHelper *helper, XbSilo
 {
 	if (g_hash_table_lookup(helper->results_hash, sn) != NULL)
 		return FALSE;
+	if (helper->results_hash_parent != NULL &&
+	    g_hash_table_lookup(helper->results_hash_parent, sn) != NULL)
+		return FALSE;
+
+	/* skipped results only need to be remembered if they can be found twice */
+	if (helper->offset > 0) {
+		if (helper->dedup_skipped)
+			g_hash_table_add(helper->results_hash, sn);
+		helper->offset--;
+		return FALSE;
+	}
+	if (helper->result_func != NULL) {
+		g_hash_table_add(helper->results_hash, sn);
+		helper->result_func(self, sn, helper->result_data);
+		return FALSE;
+	}
 	if (helper->flags & XB_SILO_QUERY_HELPER_USE_SN) {
 		g_ptr_array_add(helper->results, sn);
 	} else {
@@ -132,6 +161,448 @@ xb_silo_query_section_add_result(XbSilo *self, XbSiloQueryHelper *helper, XbSilo
 	return helper->results->len == helper->limit;
 }
 
+static gboolean
+xb_silo_query_section_root(XbSilo *self,
+			   XbSiloNode *sn,
+			   guint i,
+			   guint bindings_offset,
+			   XbSiloQueryHelper *helper,
+			   GError **error);
+
+/* sets @done if no more siblings need to be checked */
+static gboolean
+xb_silo_query_section_node(XbSilo *self,
+			   XbSiloNode *sn,
+			   guint i,
+			   guint bindings_offset,
+			   XbSiloQueryHelper *helper,
+			   gboolean *done,
+			   GError **error)
+{
+	XbSiloQueryData *query_data = helper->query_data;
+	XbQuerySection *section = g_ptr_array_index(helper->sections, i);
+	gboolean result = TRUE;
+	guint bindings_offset_end = 0;
+
+	query_data->sn = sn;
+	if (!xb_silo_query_node_matches(self,
+					xb_silo_get_machine(self),
+					sn,
+					section,
+					query_data,
+					helper->bindings,
+					bindings_offset,
+					&bindings_offset_end,
+					&result,
+					error))
+		return FALSE;
+	if (!result)
+		return TRUE;
+	if (i == helper->sections->len - 1) {
+		if (xb_silo_query_section_add_result(self, helper, sn))
+			*done = TRUE;
+	} else if ((xb_silo_node_get_bloom(sn) & section->bloom) == section->bloom) {
+		if (!xb_silo_query_section_root(self,
+						sn,
+						i + 1,
+						bindings_offset_end,
+						helper,
+						error))
+			return FALSE;
+		if (helper->results->len > 0 && helper->results->len == helper->limit)
+			*done = TRUE;
+	}
+	return TRUE;
+}
+
+typedef struct {
+	GMutex mutex;
+	GCond cond;
+	guint pending; /* (mutex mutex) */
+} XbSiloQueryWorkerSync;
+
+typedef struct {
+	XbSilo *silo;
+	GPtrArray *sns; /* of XbSiloNode, only the ones matching the element name */
+	guint start;
+	guint end;
+	guint range;
+	gint *range_done; /* (atomic): the lowest range that reached the limit */
+	guint i;
+	guint bindings_offset;
+	XbSiloQueryHelper helper;
+	XbSiloQueryData query_data;
+	XbSiloQueryWorkerSync *sync;
+	gboolean ret;
+	GError *error;
+} XbSiloQueryWorker;
+
+static void
+xb_silo_query_worker_run(XbSiloQueryWorker *worker)
+{
+	/* the position is the number of matching siblings before this one */
+	worker->query_data.position = worker->start;
+	for (guint j = worker->start; j < worker->end; j++) {
+		XbSiloNode *sn = g_ptr_array_index(worker->sns, j);
+		gboolean done = FALSE;
+
+		/* an earlier range already has enough results */
+		if (g_atomic_int_get(worker->range_done) < (gint)worker->range)
+			break;
+		if (!xb_silo_query_section_node(worker->silo,
+						sn,
+						worker->i,
+						worker->bindings_offset,
+						&worker->helper,
+						&done,
+						&worker->error))
+			return;
+		if (done) {
+			gint range_done = g_atomic_int_get(worker->range_done);
+			while (range_done > (gint)worker->range &&
+			       !g_atomic_int_compare_and_exchange(worker->range_done,
+								  range_done,
+								  worker->range))
+				range_done = g_atomic_int_get(worker->range_done);
+			break;
+		}
+	}
+	worker->ret = TRUE;
+}
+
+static void
+xb_silo_query_worker_pool_cb(gpointer data, gpointer user_data)
+{
+	XbSiloQueryWorker *worker = (XbSiloQueryWorker *)data;
+	XbSiloQueryWorkerSync *sync = worker->sync;
+
+	xb_silo_query_worker_run(worker);
+	g_mutex_lock(&sync->mutex);
+	if (--sync->pending == 0)
+		g_cond_signal(&sync->cond);
+	g_mutex_unlock(&sync->mutex);
+}
+
+/* shared by all silos, so concurrent queries cannot use more threads than
+ * there are processors; the workers never wait on the pool themselves */
+static GThreadPool *
+xb_silo_query_get_pool(void)
+{
+	static gsize pool = 0;
+	if (g_once_init_enter(&pool)) {
+		GThreadPool *tmp = g_thread_pool_new(xb_silo_query_worker_pool_cb,
+						     NULL,
+						     g_get_num_processors(),
+						     FALSE,
+						     NULL);
+		g_once_init_leave(&pool, (gsize)tmp);
+	}
+	return (GThreadPool *)pool;
+}
+
+/* sets @handled if the children of @parent, or the root nodes if %NULL, were
+ * queried using threads; this needs XB_BUILDER_COMPILE_FLAG_CHILD_INDEX so
+ * that short sibling chains are skipped without walking them */
+static gboolean
+xb_silo_query_section_parallel(XbSilo *self,
+			       XbSiloNode *parent,
+			       guint i,
+			       guint bindings_offset,
+			       XbSiloQueryHelper *helper,
+			       gboolean *handled,
+			       GError **error)
+{
+	XbQuerySection *section = g_ptr_array_index(helper->sections, i);
+	XbSiloQueryWorker *workers;
+	XbSiloQueryWorkerSync sync = {0};
+	GThreadPool *pool = xb_silo_query_get_pool();
+	const guint64 *children;
+	gboolean ret = TRUE;
+	gint range_done = G_MAXINT;
+	guint32 children_cnt = 0;
+	guint n_threads;
+	g_autoptr(GPtrArray) sns = NULL;
+
+	/* not worth splitting */
+	children = xb_silo_get_children(self, parent, &children_cnt);
+	if (children == NULL)
+		return TRUE;
+	if (MIN(g_get_num_processors(), children_cnt / XB_SILO_QUERY_PARALLEL_MIN) <= 1)
+		return TRUE;
+
+	/* only siblings that can match affect position() */
+	sns = g_ptr_array_sized_new(children_cnt);
+	for (guint32 j = 0; j < children_cnt; j++) {
+		XbSiloNode *sn = _xb_silo_get_node(self, children[j]);
+		if (section->kind == XB_SILO_QUERY_KIND_WILDCARD ||
+		    section->element_idx == sn->element_name)
+			g_ptr_array_add(sns, sn);
+	}
+	n_threads = MIN(g_get_num_processors(), sns->len / XB_SILO_QUERY_PARALLEL_MIN);
+	if (n_threads <= 1)
+		return TRUE;
+
+	/* each range has its own results, which are merged in document order */
+	workers = g_new0(XbSiloQueryWorker, n_threads);
+	for (guint j = 0; j < n_threads; j++) {
+		XbSiloQueryWorker *worker = &workers[j];
+		worker->silo = self;
+		worker->sns = sns;
+		worker->start = (guint)(((guint64)sns->len * j) / n_threads);
+		worker->end = (guint)(((guint64)sns->len * (j + 1)) / n_threads);
+		worker->range = j;
+		worker->range_done = &range_done;
+		worker->i = i;
+		worker->bindings_offset = bindings_offset;
+		worker->helper.sections = helper->sections;
+		worker->helper.results = g_ptr_array_new();
+		worker->helper.bindings = helper->bindings;
+		worker->helper.results_hash = g_hash_table_new(g_direct_hash, g_direct_equal);
+		worker->helper.results_hash_parent = helper->results_hash;
+		worker->helper.limit =
+		    helper->limit > 0 ? helper->limit + helper->offset - helper->results->len : 0;
+		worker->helper.flags =
+		    (helper->flags | XB_SILO_QUERY_HELPER_USE_SN) & ~XB_SILO_QUERY_HELPER_PARALLEL;
+		worker->helper.query_data = &worker->query_data;
+		worker->sync = &sync;
+	}
+
+	/* the first range is run by this thread, and any that cannot be queued */
+	g_mutex_init(&sync.mutex);
+	g_cond_init(&sync.cond);
+	for (guint j = 1; j < n_threads; j++) {
+		g_mutex_lock(&sync.mutex);
+		sync.pending++;
+		g_mutex_unlock(&sync.mutex);
+		if (pool == NULL || !g_thread_pool_push(pool, &workers[j], NULL))
+			xb_silo_query_worker_pool_cb(&workers[j], NULL);
+	}
+	xb_silo_query_worker_run(&workers[0]);
+	g_mutex_lock(&sync.mutex);
+	while (sync.pending > 0)
+		g_cond_wait(&sync.cond, &sync.mutex);
+	g_mutex_unlock(&sync.mutex);
+	g_cond_clear(&sync.cond);
+	g_mutex_clear(&sync.mutex);
+
+	/* merge, stopping at the first error */
+	*handled = TRUE;
+	for (guint j = 0; j < n_threads; j++) {
+		XbSiloQueryWorker *worker = &workers[j];
+		if (!worker->ret) {
+			g_propagate_error(error, g_steal_pointer(&worker->error));
+			ret = FALSE;
+			break;
+		}
+		for (guint k = 0; k < worker->helper.results->len; k++) {
+			XbSiloNode *sn_tmp = g_ptr_array_index(worker->helper.results, k);
+			if (xb_silo_query_section_add_result(self, helper, sn_tmp))
+				break;
+		}
+		if (helper->results->len > 0 && helper->results->len == helper->limit)
+			break;
+	}
+	for (guint j = 0; j < n_threads; j++) {
+		g_clear_error(&workers[j].error);
+		g_ptr_array_unref(workers[j].helper.results);
+		g_hash_table_unref(workers[j].helper.results_hash);
+		xb_silo_query_data_clear(&workers[j].query_data);
+	}
+	g_free(workers);
+	return ret;
+}
+
+/* the position only needs to be worked out when walking backwards if used */
+static gboolean
+xb_silo_query_section_uses_position(XbQuerySection *section)
+{
+	const gchar *positional[] = {"first", "position", NULL};
+	if (section->predicates == NULL)
+		return FALSE;
+	for (guint i = 0; i < section->predicates->len; i++) {
+		XbStack *opcodes = g_ptr_array_index(section->predicates, i);
+		for (guint j = 0; j < _xb_stack_get_size(opcodes); j++) {
+			XbOpcode *op = _xb_stack_peek(opcodes, j);
+			if (_xb_opcode_get_kind(op) == XB_OPCODE_KIND_FUNCTION &&
+			    g_strv_contains(positional, _xb_opcode_get_str(op)))
+				return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/* walks the children of @sn from the last, so the limit is reached as soon
+ * as possible; the chain is only followed if the silo has no child index */
+static gboolean
+xb_silo_query_section_reverse(XbSilo *self,
+			      XbSiloNode *sn,
+			      guint i,
+			      guint bindings_offset,
+			      XbSiloQueryHelper *helper,
+			      GError **error)
+{
+	XbQuerySection *section = g_ptr_array_index(helper->sections, i);
+	g_autoptr(GPtrArray) sns = NULL;
+	const guint64 *children;
+	guint32 children_cnt = 0;
+	guint position = 0;
+
+	children = xb_silo_get_children(self, sn, &children_cnt);
+	if (children == NULL) {
+		XbSiloNode *sc = NULL;
+		if (sn == NULL) {
+			sc = xb_silo_get_root_node(self);
+			if (sc == NULL) {
+				g_set_error_literal(error,
+						    G_IO_ERROR,
+						    G_IO_ERROR_NOT_FOUND,
+						    "silo root not found");
+				return FALSE;
+			}
+		} else {
+			sc = xb_silo_get_child_node(self, sn);
+		}
+		sns = g_ptr_array_new();
+		for (; sc != NULL; sc = xb_silo_get_next_node(self, sc))
+			g_ptr_array_add(sns, sc);
+		children_cnt = sns->len;
+	}
+
+	/* position() still counts from the first sibling */
+	if (xb_silo_query_section_uses_position(section)) {
+		for (guint32 j = 0; j < children_cnt; j++) {
+			XbSiloNode *sc = sns != NULL ? g_ptr_array_index(sns, j)
+						     : _xb_silo_get_node(self, children[j]);
+			if (section->kind == XB_SILO_QUERY_KIND_WILDCARD ||
+			    section->element_idx == sc->element_name)
+				position++;
+		}
+	}
+	for (guint32 j = children_cnt; j > 0; j--) {
+		XbSiloNode *sc = sns != NULL ? g_ptr_array_index(sns, j - 1)
+					     : _xb_silo_get_node(self, children[j - 1]);
+		gboolean done = FALSE;
+
+		if (position > 0 && (section->kind == XB_SILO_QUERY_KIND_WILDCARD ||
+				     section->element_idx == sc->element_name))
+			position--;
+		helper->query_data->position = position;
+		if (!xb_silo_query_section_node(self,
+						sc,
+						i,
+						bindings_offset,
+						helper,
+						&done,
+						error))
+			return FALSE;
+		if (done)
+			break;
+	}
+	return TRUE;
+}
+
+static void
+xb_silo_query_collect_descendants(XbSilo *self,
+				  XbSiloNode *sn,
+				  XbQuerySection *section,
+				  GPtrArray *sns)
+{
+	guint64 bloom = 0;
+
+	/* subtrees without the element name can be skipped */
+	if (section->kind != XB_SILO_QUERY_KIND_WILDCARD)
+		bloom = xb_silo_node_bloom_for_idx(section->element_idx);
+	for (; sn != NULL; sn = xb_silo_get_next_node(self, sn)) {
+		XbSiloNode *sc;
+		if (section->kind == XB_SILO_QUERY_KIND_WILDCARD ||
+		    section->element_idx == sn->element_name)
+			g_ptr_array_add(sns, sn);
+		if ((xb_silo_node_get_bloom(sn) & bloom) != bloom)
+			continue;
+		sc = xb_silo_get_child_node(self, sn);
+		if (sc != NULL)
+			xb_silo_query_collect_descendants(self, sc, section, sns);
+	}
+}
+
+/* finds the nodes at any depth below @sn, in document order; the element index
+ * is used if the silo has one, otherwise the subtree is walked */
+static gboolean
+xb_silo_query_section_descendants(XbSilo *self,
+				  XbSiloNode *sn,
+				  guint i,
+				  guint bindings_offset,
+				  XbSiloQueryHelper *helper,
+				  GError **error)
+{
+	XbQuerySection *section = g_ptr_array_index(helper->sections, i);
+	g_autoptr(GPtrArray) sns = NULL;
+	const guint64 *elements = NULL;
+	guint32 elements_cnt = 0;
+
+	/* not in the silo at all */
+	if (section->kind != XB_SILO_QUERY_KIND_WILDCARD &&
+	    section->element_idx == XB_SILO_UNSET)
+		return TRUE;
+
+	/* the subtree is a contiguous range of the postings */
+	if (section->kind != XB_SILO_QUERY_KIND_WILDCARD)
+		elements = xb_silo_get_elements(self, section->element_idx, &elements_cnt);
+	if (elements != NULL && sn != NULL) {
+		guint64 start = xb_silo_get_offset_for_node(self, sn);
+		guint64 end = xb_silo_get_subtree_end(self, sn);
+		gsize lo = 0;
+		gsize hi = elements_cnt;
+		while (lo < hi) {
+			gsize mid = lo + (hi - lo) / 2;
+			if (elements[mid] <= start)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		elements += lo;
+		elements_cnt -= lo;
+		lo = 0;
+		hi = elements_cnt;
+		while (lo < hi) {
+			gsize mid = lo + (hi - lo) / 2;
+			if (elements[mid] < end)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		elements_cnt = lo;
+	} else if (elements == NULL) {
+		XbSiloNode *sc = sn != NULL ? xb_silo_get_child_node(self, sn)
+					    : xb_silo_get_root_node(self);
+		sns = g_ptr_array_new();
+		xb_silo_query_collect_descendants(self, sc, section, sns);
+		elements_cnt = sns->len;
+	}
+
+	/* position() counts all the matching descendants */
+	for (guint32 j = 0; j < elements_cnt; j++) {
+		gboolean reverse = (helper->flags & XB_SILO_QUERY_HELPER_REVERSE) > 0;
+		guint32 k = reverse ? elements_cnt - j - 1 : j;
+		XbSiloNode *sc =
+		    sns != NULL ? g_ptr_array_index(sns, k) : _xb_silo_get_node(self, elements[k]);
+		gboolean done = FALSE;
+
+		helper->query_data->position = k;
+		if (!xb_silo_query_section_node(self,
+						sc,
+						i,
+						bindings_offset,
+						helper,
+						&done,
+						error))
+			return FALSE;
+		if (done)
+			break;
+	}
+	return TRUE;
+}
+
 /*
  * @parent: (allow-none)
  */
@@ -143,9 +614,10 @@ xb_silo_query_section_root(XbSilo *self,
 			   XbSiloQueryHelper *helper,
 			   GError **error)
 {
-	XbMachine *machine = xb_silo_get_machine(self);
 	XbSiloQueryData *query_data = helper->query_data;
 	XbQuerySection *section = g_ptr_array_index(helper->sections, i);
+	guint64 next;
+	gboolean wide = xb_silo_is_wide(self);
 
 	/* handle parent */
 	if (section->kind == XB_SILO_QUERY_KIND_PARENT) {
@@ -178,6 +650,39 @@ xb_silo_query_section_root(XbSilo *self,
 						  error);
 	}
 
+	/* a predicate is always FALSE */
+	if (section->never_matches)
+		return TRUE;
+
+	/* at any depth */
+	if (section->descendant) {
+		return xb_silo_query_section_descendants(self,
+							 sn,
+							 i,
+							 bindings_offset,
+							 helper,
+							 error);
+	}
+
+	/* walk the siblings from the end */
+	if (helper->flags & XB_SILO_QUERY_HELPER_REVERSE)
+		return xb_silo_query_section_reverse(self, sn, i, bindings_offset, helper, error);
+
+	/* split large sibling chains across threads */
+	if (helper->flags & XB_SILO_QUERY_HELPER_PARALLEL) {
+		gboolean handled = FALSE;
+		if (!xb_silo_query_section_parallel(self,
+						    sn,
+						    i,
+						    bindings_offset,
+						    helper,
+						    &handled,
+						    error))
+			return FALSE;
+		if (handled)
+			return TRUE;
+	}
+
 	/* no node means root */
 	if (sn == NULL) {
 		sn = xb_silo_get_root_node(self);
@@ -199,44 +704,187 @@ xb_silo_query_section_root(XbSilo *self,
 
 	/* continue matching children ".." */
 	do {
-		gboolean result = TRUE;
-		guint bindings_offset_end = 0;
-		query_data->sn = sn;
-		if (!xb_silo_query_node_matches(self,
-						machine,
+		gboolean done = FALSE;
+		if (!xb_silo_query_section_node(self,
 						sn,
-						section,
-						query_data,
-						helper->bindings,
+						i,
 						bindings_offset,
-						&bindings_offset_end,
-						&result,
+						helper,
+						&done,
 						error))
 			return FALSE;
-		if (result) {
+		if (done)
+			break;
+		next = xb_silo_node_get_next(sn, wide);
+		if (next == 0x0)
+			break;
+		sn = _xb_silo_get_node(self, next);
+	} while (TRUE);
+	return TRUE;
+}
+
+typedef struct {
+	XbSiloQueryHelper *helper;
+	guint bindings_offset;
+	guint position;
+} XbSiloQueryBatchItem;
+
+static gboolean
+xb_silo_query_helper_is_done(XbSiloQueryHelper *helper)
+{
+	return helper->results->len > 0 && helper->results->len == helper->limit;
+}
+
+/* walks the children of @sn once, checking section @i of every query in @items */
+static gboolean
+xb_silo_query_batch_section(XbSilo *self, XbSiloNode *sn, guint i, GArray *items, GError **error)
+{
+	gboolean wide = xb_silo_is_wide(self);
+	g_autoptr(GArray) shared = g_array_new(FALSE, FALSE, sizeof(XbSiloQueryBatchItem));
+
+	for (guint j = 0; j < items->len; j++) {
+		XbSiloQueryBatchItem *item = &g_array_index(items, XbSiloQueryBatchItem, j);
+		XbQuerySection *section = g_ptr_array_index(item->helper->sections, i);
+
+		if (xb_silo_query_helper_is_done(item->helper))
+			continue;
+		if (section->never_matches)
+			continue;
+
+		/* these do not walk the children in the usual way */
+		if (section->kind == XB_SILO_QUERY_KIND_PARENT || section->descendant ||
+		    item->helper->flags &
+			(XB_SILO_QUERY_HELPER_PARALLEL | XB_SILO_QUERY_HELPER_REVERSE)) {
+			if (!xb_silo_query_section_root(self,
+							sn,
+							i,
+							item->bindings_offset,
+							item->helper,
+							error))
+				return FALSE;
+			continue;
+		}
+		item->position = 0;
+		g_array_append_val(shared, *item);
+	}
+	if (shared->len == 0)
+		return TRUE;
+
+	/* no node means root */
+	if (sn == NULL) {
+		sn = xb_silo_get_root_node(self);
+		if (sn == NULL) {
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_NOT_FOUND,
+					    "silo root not found");
+			return FALSE;
+		}
+	} else {
+		sn = xb_silo_get_child_node(self, sn);
+		if (sn == NULL)
+			return TRUE;
+	}
+
+	do {
+		g_autoptr(GArray) children = NULL;
+		gboolean all_done = TRUE;
+		guint64 next;
+
+		for (guint j = 0; j < shared->len; j++) {
+			XbSiloQueryBatchItem *item;
+			XbSiloQueryHelper *helper;
+			XbQuerySection *section;
+			gboolean result = TRUE;
+			guint bindings_offset_end = 0;
+
+			item = &g_array_index(shared, XbSiloQueryBatchItem, j);
+			helper = item->helper;
+			section = g_ptr_array_index(helper->sections, i);
+			if (xb_silo_query_helper_is_done(helper))
+				continue;
+			all_done = FALSE;
+
+			/* each query counts its own position() */
+			helper->query_data->sn = sn;
+			helper->query_data->position = item->position;
+			if (!xb_silo_query_node_matches(self,
+							xb_silo_get_machine(self),
+							sn,
+							section,
+							helper->query_data,
+							helper->bindings,
+							item->bindings_offset,
+							&bindings_offset_end,
+							&result,
+							error))
+				return FALSE;
+			item->position = helper->query_data->position;
+			if (!result)
+				continue;
 			if (i == helper->sections->len - 1) {
-				if (xb_silo_query_section_add_result(self, helper, sn))
-					break;
-			} else {
-				if (!xb_silo_query_section_root(self,
-								sn,
-								i + 1,
-								bindings_offset_end,
-								helper,
-								error))
-					return FALSE;
-				if (helper->results->len > 0 &&
-				    helper->results->len == helper->limit)
-					break;
+				xb_silo_query_section_add_result(self, helper, sn);
+			} else if ((xb_silo_node_get_bloom(sn) & section->bloom) ==
+				   section->bloom) {
+				XbSiloQueryBatchItem child = {
+				    .helper = helper,
+				    .bindings_offset = bindings_offset_end,
+				};
+				if (children == NULL) {
+					children =
+					    g_array_new(FALSE, FALSE, sizeof(XbSiloQueryBatchItem));
+				}
+				g_array_append_val(children, child);
 			}
 		}
-		if (sn->next == 0x0)
+		if (all_done)
+			break;
+
+		/* all the queries that matched this node share the walk of its children */
+		if (children != NULL &&
+		    !xb_silo_query_batch_section(self, sn, i + 1, children, error))
+			return FALSE;
+
+		next = xb_silo_node_get_next(sn, wide);
+		if (next == 0x0)
 			break;
-		sn = _xb_silo_get_node(self, sn->next);
+		sn = _xb_silo_get_node(self, next);
 	} while (TRUE);
 	return TRUE;
 }
 
+/* sets the sections, bindings, limit and flags from @query and @context */
+static void
+xb_silo_query_helper_init(XbSiloQueryHelper *helper,
+			  XbQuery *query,
+			  XbQueryContext *context,
+			  gboolean first_result_only)
+{
+	G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+	XbQueryFlags query_flags = (context != NULL) ? xb_query_context_get_flags(context)
+						     : xb_query_get_flags(query);
+	helper->bindings = (context != NULL) ? xb_query_context_get_bindings(context) : NULL;
+	helper->limit = first_result_only     ? 1
+			: (context != NULL) ? xb_query_context_get_limit(context)
+					    : xb_query_get_limit(query);
+	G_GNUC_END_IGNORE_DEPRECATIONS
+	helper->offset = (context != NULL) ? xb_query_context_get_offset(context) : 0;
+
+	/* find each section */
+	helper->sections = xb_query_get_sections(query);
+	for (guint i = 0; i < helper->sections->len; i++) {
+		XbQuerySection *section = g_ptr_array_index(helper->sections, i);
+		if (section->kind == XB_SILO_QUERY_KIND_PARENT || section->descendant)
+			helper->dedup_skipped = TRUE;
+	}
+	if (query_flags & XB_QUERY_FLAG_FORCE_NODE_CACHE)
+		helper->flags |= XB_SILO_QUERY_HELPER_FORCE_NODE_CACHE;
+	if (query_flags & XB_QUERY_FLAG_PARALLEL)
+		helper->flags |= XB_SILO_QUERY_HELPER_PARALLEL;
+	if (query_flags & XB_QUERY_FLAG_REVERSE)
+		helper->flags |= XB_SILO_QUERY_HELPER_REVERSE;
+}
+
 static gboolean
 xb_silo_query_part(XbSilo *self,
 		   XbSiloNode *sroot,
@@ -247,38 +895,34 @@ xb_silo_query_part(XbSilo *self,
 		   gboolean first_result_only,
 		   XbSiloQueryData *query_data,
 		   XbSiloQueryHelperFlags flags,
+		   XbSiloQueryResultFunc result_func,
+		   gpointer result_data,
 		   GError **error)
 {
-	G_GNUC_BEGIN_IGNORE_DEPRECATIONS
 	XbSiloQueryHelper helper = {
 	    .results = results,
-	    .bindings = (context != NULL) ? xb_query_context_get_bindings(context) : NULL,
-	    .limit = first_result_only	 ? 1
-		     : (context != NULL) ? xb_query_context_get_limit(context)
-					 : xb_query_get_limit(query),
 	    .flags = flags,
 	    .results_hash = results_hash,
 	    .query_data = query_data,
+	    .result_func = result_func,
+	    .result_data = result_data,
 	};
-	XbQueryFlags query_flags = (context != NULL) ? xb_query_context_get_flags(context)
-						     : xb_query_get_flags(query);
-	G_GNUC_END_IGNORE_DEPRECATIONS
-
-	/* find each section */
-	helper.sections = xb_query_get_sections(query);
-	if (query_flags & XB_QUERY_FLAG_FORCE_NODE_CACHE)
-		helper.flags |= XB_SILO_QUERY_HELPER_FORCE_NODE_CACHE;
+	xb_silo_query_helper_init(&helper, query, context, first_result_only);
 	return xb_silo_query_section_root(self, sroot, 0, 0, &helper, error);
 }
 
 /* Returns an array with (element-type XbSiloNode) if
- * %XB_SILO_QUERY_HELPER_USE_SN is set, and (element-type XbNode) otherwise. */
+ * %XB_SILO_QUERY_HELPER_USE_SN is set, and (element-type XbNode) otherwise.
+ * If @result_func is set then it is called for each result instead, and the
+ * returned array is always empty. */
 static GPtrArray *
 silo_query_with_root(XbSilo *self,
 		     XbNode *n,
 		     const gchar *xpath,
 		     guint limit,
 		     XbSiloQueryHelperFlags flags,
+		     XbSiloQueryResultFunc result_func,
+		     gpointer result_data,
 		     GError **error)
 {
 	XbSiloNode *sn = NULL;
@@ -286,7 +930,7 @@ silo_query_with_root(XbSilo *self,
 	g_autoptr(GHashTable) results_hash = g_hash_table_new(g_direct_hash, g_direct_equal);
 	g_autoptr(GPtrArray) results = NULL;
 	g_autoptr(GTimer) timer = xb_silo_start_profile(self);
-	XbSiloQueryData query_data = {
+	g_auto(XbSiloQueryData) query_data = {
 	    .sn = NULL,
 	    .position = 0,
 	};
@@ -317,8 +961,8 @@ silo_query_with_root(XbSilo *self,
 			return NULL;
 		}
 	} else {
-		/* assume it's just a root query */
-		if (xpath[0] == '/')
+		/* assume it's just a root query, unless it is for descendants */
+		if (xpath[0] == '/' && xpath[1] != '/')
 			xpath++;
 	}
 
@@ -355,6 +999,8 @@ silo_query_with_root(XbSilo *self,
 					FALSE,
 					&query_data,
 					flags,
+					result_func,
+					result_data,
 					error)) {
 			return NULL;
 		}
@@ -372,7 +1018,7 @@ silo_query_with_root(XbSilo *self,
 	}
 
 	/* nothing found */
-	if (results->len == 0) {
+	if (results->len == 0 && result_func == NULL) {
 		g_set_error(error,
 			    G_IO_ERROR,
 			    G_IO_ERROR_NOT_FOUND,
@@ -405,7 +1051,14 @@ silo_query_with_root(XbSilo *self,
 GPtrArray *
 xb_silo_query_with_root(XbSilo *self, XbNode *n, const gchar *xpath, guint limit, GError **error)
 {
-	return silo_query_with_root(self, n, xpath, limit, XB_SILO_QUERY_HELPER_NONE, error);
+	return silo_query_with_root(self,
+				    n,
+				    xpath,
+				    limit,
+				    XB_SILO_QUERY_HELPER_NONE,
+				    NULL,
+				    NULL,
+				    error);
 }
 
 /**
@@ -427,18 +1080,14 @@ xb_silo_query_with_root(XbSilo *self, XbNode *n, const gchar *xpath, guint limit
 GPtrArray *
 xb_silo_query_sn_with_root(XbSilo *self, XbNode *n, const gchar *xpath, guint limit, GError **error)
 {
-	return silo_query_with_root(self, n, xpath, limit, XB_SILO_QUERY_HELPER_USE_SN, error);
-}
-
-static void
-_g_ptr_array_reverse(GPtrArray *array)
-{
-	guint last_idx = array->len - 1;
-	for (guint i = 0; i < array->len / 2; i++) {
-		gpointer tmp = array->pdata[i];
-		array->pdata[i] = array->pdata[last_idx - i];
-		array->pdata[last_idx - i] = tmp;
-	}
+	return silo_query_with_root(self,
+				    n,
+				    xpath,
+				    limit,
+				    XB_SILO_QUERY_HELPER_USE_SN,
+				    NULL,
+				    NULL,
+				    error);
 }
 
 /**
@@ -477,7 +1126,7 @@ xb_silo_query_with_root_full(XbSilo *self,
 	g_autoptr(GPtrArray) results =
 	    g_ptr_array_new_with_free_func((GDestroyNotify)g_object_unref);
 	g_autoptr(GTimer) timer = xb_silo_start_profile(self);
-	XbSiloQueryData query_data = {
+	g_auto(XbSiloQueryData) query_data = {
 	    .sn = NULL,
 	    .position = 0,
 	};
@@ -513,6 +1162,8 @@ xb_silo_query_with_root_full(XbSilo *self,
 				first_result_only,
 				&query_data,
 				XB_SILO_QUERY_HELPER_NONE,
+				NULL,
+				NULL,
 				error))
 		return NULL;
 
@@ -554,10 +1205,6 @@ xb_silo_query_with_root_full(XbSilo *self,
 		return NULL;
 	}
 
-	/* reverse order */
-	if (query_flags & XB_QUERY_FLAG_REVERSE)
-		_g_ptr_array_reverse(results);
-
 	return g_steal_pointer(&results);
 }
 
@@ -613,6 +1260,98 @@ xb_silo_query_with_context(XbSilo *self, XbQuery *query, XbQueryContext *context
 	return xb_silo_query_with_root_full(self, NULL, query, context, FALSE, error);
 }
 
+/**
+ * xb_silo_query_batch:
+ * @self: a #XbSilo
+ * @queries: (element-type XbQuery): queries
+ * @contexts: (nullable) (element-type XbQueryContext): a context for each query, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Searches the silo using several XPath queries at the same time.
+ *
+ * Each node is only visited once for all the queries that could match it,
+ * which is much faster than running each query in turn when the queries
+ * share a common prefix, e.g. `components/component`.
+ *
+ * If @contexts is set it must have the same length as @queries, although
+ * each element may be %NULL.
+ *
+ * It is safe to call this function from a different thread to the one that
+ * created the #XbSilo.
+ *
+ * Returns: (transfer container) (element-type GPtrArray): an array of results
+ *    for each query, which may be empty, or %NULL for error
+ *
+ * Since: 0.3.12
+ **/
+GPtrArray *
+xb_silo_query_batch(XbSilo *self, GPtrArray *queries, GPtrArray *contexts, GError **error)
+{
+	XbSiloQueryData *query_data;
+	XbSiloQueryHelper *helpers;
+	g_autoptr(GArray) items = g_array_new(FALSE, FALSE, sizeof(XbSiloQueryBatchItem));
+	g_autoptr(GPtrArray) results_all =
+	    g_ptr_array_new_with_free_func((GDestroyNotify)g_ptr_array_unref);
+	g_autoptr(GTimer) timer = xb_silo_start_profile(self);
+	gboolean ret;
+
+	g_return_val_if_fail(XB_IS_SILO(self), NULL);
+	g_return_val_if_fail(queries != NULL, NULL);
+	g_return_val_if_fail(contexts == NULL || contexts->len == queries->len, NULL);
+	g_return_val_if_fail(error == NULL || *error == NULL, NULL);
+
+	/* empty silo */
+	if (xb_silo_is_empty(self)) {
+		g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "silo has no data");
+		return NULL;
+	}
+
+	/* set up each query */
+	query_data = g_new0(XbSiloQueryData, queries->len);
+	helpers = g_new0(XbSiloQueryHelper, queries->len);
+	for (guint i = 0; i < queries->len; i++) {
+		XbQuery *query = g_ptr_array_index(queries, i);
+		XbQueryContext *context = contexts != NULL ? g_ptr_array_index(contexts, i) : NULL;
+		XbSiloQueryBatchItem item = {
+		    .helper = &helpers[i],
+		};
+
+		/* convert the XB_OPCODE_KIND_BOUND_TEXT into a XB_OPCODE_KIND_BOUND_INDEXED_TEXT */
+		if (context != NULL &&
+		    xb_query_context_get_flags(context) & XB_QUERY_FLAG_USE_INDEXES) {
+			XbValueBindings *bindings = xb_query_context_get_bindings(context);
+			if (!xb_value_bindings_indexed_text_lookup(bindings, self, error))
+				break;
+		}
+		helpers[i].results =
+		    g_ptr_array_new_with_free_func((GDestroyNotify)g_object_unref);
+		helpers[i].results_hash = g_hash_table_new(g_direct_hash, g_direct_equal);
+		helpers[i].query_data = &query_data[i];
+		xb_silo_query_helper_init(&helpers[i], query, context, FALSE);
+		g_array_append_val(items, item);
+		g_ptr_array_add(results_all, helpers[i].results);
+	}
+
+	/* walk the shared prefix once */
+	ret = items->len == queries->len &&
+	      xb_silo_query_batch_section(self, NULL, 0, items, error);
+	for (guint i = 0; i < queries->len; i++) {
+		if (helpers[i].results_hash != NULL)
+			g_hash_table_unref(helpers[i].results_hash);
+		xb_silo_query_data_clear(&query_data[i]);
+	}
+	g_free(helpers);
+	g_free(query_data);
+	if (!ret)
+		return NULL;
+
+	/* profile */
+	if (xb_silo_get_profile_flags(self) & XB_SILO_PROFILE_FLAG_XPATH)
+		xb_silo_add_profile(self, timer, "batch query of %u queries", queries->len);
+
+	return g_steal_pointer(&results_all);
+}
+
 /**
  * xb_silo_query_first_full:
  * @self: a #XbSilo
@@ -725,6 +1464,318 @@ xb_silo_query_first(XbSilo *self, const gchar *xpath, GError **error)
 	return g_object_ref(g_ptr_array_index(results, 0));
 }
 
+typedef struct {
+	XbSiloNode *sn;
+	guint score;
+	guint position; /* in document order, so ties are stable */
+} XbSiloSearchResult;
+
+/* the top of the heap is the worst result that is being kept */
+static gboolean
+xb_silo_search_result_worse(const XbSiloSearchResult *r1, const XbSiloSearchResult *r2)
+{
+	if (r1->score != r2->score)
+		return r1->score < r2->score;
+	return r1->position > r2->position;
+}
+
+static void
+xb_silo_search_heap_sift_up(GArray *heap, guint i)
+{
+	while (i > 0) {
+		guint parent = (i - 1) / 2;
+		XbSiloSearchResult *r = &g_array_index(heap, XbSiloSearchResult, i);
+		XbSiloSearchResult *rp = &g_array_index(heap, XbSiloSearchResult, parent);
+		XbSiloSearchResult tmp;
+		if (!xb_silo_search_result_worse(r, rp))
+			break;
+		tmp = *r;
+		*r = *rp;
+		*rp = tmp;
+		i = parent;
+	}
+}
+
+static void
+xb_silo_search_heap_sift_down(GArray *heap, guint i)
+{
+	for (;;) {
+		guint worst = i;
+		guint left = 2 * i + 1;
+		guint right = 2 * i + 2;
+		XbSiloSearchResult tmp;
+		if (left < heap->len &&
+		    xb_silo_search_result_worse(&g_array_index(heap, XbSiloSearchResult, left),
+						&g_array_index(heap, XbSiloSearchResult, worst)))
+			worst = left;
+		if (right < heap->len &&
+		    xb_silo_search_result_worse(&g_array_index(heap, XbSiloSearchResult, right),
+						&g_array_index(heap, XbSiloSearchResult, worst)))
+			worst = right;
+		if (worst == i)
+			break;
+		tmp = g_array_index(heap, XbSiloSearchResult, i);
+		g_array_index(heap, XbSiloSearchResult, i) =
+		    g_array_index(heap, XbSiloSearchResult, worst);
+		g_array_index(heap, XbSiloSearchResult, worst) = tmp;
+		i = worst;
+	}
+}
+
+/* only keeps the best @limit results, or all of them if @limit is 0 */
+static void
+xb_silo_search_heap_add(GArray *heap, guint limit, const XbSiloSearchResult *result)
+{
+	if (limit == 0 || heap->len < limit) {
+		g_array_append_val(heap, *result);
+		xb_silo_search_heap_sift_up(heap, heap->len - 1);
+		return;
+	}
+	if (!xb_silo_search_result_worse(&g_array_index(heap, XbSiloSearchResult, 0), result))
+		return;
+	g_array_index(heap, XbSiloSearchResult, 0) = *result;
+	xb_silo_search_heap_sift_down(heap, 0);
+}
+
+static gint
+xb_silo_search_result_cmp(gconstpointer a, gconstpointer b)
+{
+	const XbSiloSearchResult *r1 = a;
+	const XbSiloSearchResult *r2 = b;
+	if (xb_silo_search_result_worse(r2, r1))
+		return -1;
+	if (xb_silo_search_result_worse(r1, r2))
+		return 1;
+	return 0;
+}
+
+/* an exact token match is worth twice the weight of the field, and a match of
+ * just the start of the token is worth the weight */
+static guint
+xb_silo_search_score_field(XbSilo *self, XbSiloNode *sn, guint weight, GPtrArray *search)
+{
+	guint score = 0;
+	g_auto(GStrv) ascii_tokens = NULL;
+	g_auto(GStrv) text_tokens = NULL;
+	g_autoptr(GPtrArray) tokens = g_ptr_array_new();
+
+	/* use the tokens from the builder if possible */
+	if (xb_silo_node_has_flag(sn, XB_SILO_NODE_FLAG_IS_TOKENIZED)) {
+		guint8 token_count = xb_silo_node_get_token_count(sn);
+		for (guint i = 0; i < token_count; i++) {
+			guint32 stridx = xb_silo_get_node_token_idx(self, sn, i);
+			if (stridx == XB_SILO_UNSET)
+				continue;
+			g_ptr_array_add(tokens, (gpointer)xb_silo_from_strtab(self, stridx));
+		}
+	} else {
+		const gchar *text = xb_silo_get_node_text(self, sn);
+		if (text == NULL)
+			return 0;
+		text_tokens = g_str_tokenize_and_fold(text, NULL, &ascii_tokens);
+		for (guint i = 0; text_tokens[i] != NULL; i++)
+			g_ptr_array_add(tokens, text_tokens[i]);
+		for (guint i = 0; ascii_tokens[i] != NULL; i++)
+			g_ptr_array_add(tokens, ascii_tokens[i]);
+	}
+
+	/* only the best match for each search token counts */
+	for (guint i = 0; i < search->len; i++) {
+		const gchar *search_token = g_ptr_array_index(search, i);
+		guint best = 0;
+		for (guint j = 0; j < tokens->len; j++) {
+			const gchar *token = g_ptr_array_index(tokens, j);
+			if (g_strcmp0(token, search_token) == 0) {
+				best = weight * 2;
+				break;
+			}
+			if (g_str_has_prefix(token, search_token))
+				best = weight;
+		}
+		score += best;
+	}
+	return score;
+}
+
+/* the node itself and everything in the subtree can be a field */
+static guint
+xb_silo_search_score(XbSilo *self, XbSiloNode *sn, GHashTable *weights, GPtrArray *search)
+{
+	guint64 off = xb_silo_get_offset_for_node(self, sn);
+	guint64 end = xb_silo_get_subtree_end(self, sn);
+	guint score = 0;
+	gboolean wide = xb_silo_is_wide(self);
+
+	while (off < end) {
+		XbSiloNode *sc = _xb_silo_get_node(self, off);
+		gpointer weight = NULL;
+		off += xb_silo_node_get_size(sc, wide);
+		if (!xb_silo_node_has_flag(sc, XB_SILO_NODE_FLAG_IS_ELEMENT))
+			continue;
+		if (!g_hash_table_lookup_extended(weights,
+						  GUINT_TO_POINTER(sc->element_name),
+						  NULL,
+						  &weight))
+			continue;
+		score += xb_silo_search_score_field(self, sc, GPOINTER_TO_UINT(weight), search);
+	}
+	return score;
+}
+
+typedef struct {
+	GHashTable *weights;
+	GPtrArray *search;
+	GArray *heap; /* of XbSiloSearchResult */
+	guint limit;
+	guint position;
+} XbSiloSearchHelper;
+
+/* scored as each node is found, so only @limit results are ever kept */
+static void
+xb_silo_search_result_cb(XbSilo *self, XbSiloNode *sn, gpointer user_data)
+{
+	XbSiloSearchHelper *helper = (XbSiloSearchHelper *)user_data;
+	XbSiloSearchResult result = {
+	    .sn = sn,
+	    .position = helper->position++,
+	};
+	result.score = xb_silo_search_score(self, sn, helper->weights, helper->search);
+	if (result.score == 0)
+		return;
+	xb_silo_search_heap_add(helper->heap, helper->limit, &result);
+}
+
+/**
+ * xb_silo_search_ranked:
+ * @self: a #XbSilo
+ * @xpath: an XPath for the nodes to score, e.g. `components/component`
+ * @search: the search terms, e.g. `gimp editor`
+ * @weights: (element-type utf8 guint): the weight of each field by element name
+ * @limit: maximum number of results to return, or 0 for "all"
+ * @scores: (out) (optional) (element-type guint): the score of each result
+ * @error: the #GError, or %NULL
+ *
+ * Searches the nodes matching @xpath, and returns the best @limit nodes.
+ *
+ * Each node is scored using the text of the node itself and of any node in
+ * the subtree that has an element name in @weights. For each search term an
+ * exact token match is worth twice the weight of the field, and a match of just
+ * the start of the token is worth the weight. Nodes that do not match any of
+ * the search terms are not returned.
+ *
+ * Only the best @limit results are kept while scoring, and only these are
+ * returned as #XbNode objects.
+ *
+ * It is safe to call this function from a different thread to the one that
+ * created the #XbSilo.
+ *
+ * Returns: (transfer container) (element-type XbNode): results, best first, or %NULL if unfound
+ *
+ * Since: 0.3.12
+ **/
+GPtrArray *
+xb_silo_search_ranked(XbSilo *self,
+		      const gchar *xpath,
+		      const gchar *search,
+		      GHashTable *weights,
+		      guint limit,
+		      GArray **scores,
+		      GError **error)
+{
+	GHashTableIter iter;
+	gpointer key;
+	gpointer value;
+	g_auto(GStrv) search_tokens = NULL;
+	g_autoptr(GArray) heap = g_array_new(FALSE, FALSE, sizeof(XbSiloSearchResult));
+	g_autoptr(GArray) scores_tmp = g_array_new(FALSE, FALSE, sizeof(guint));
+	g_autoptr(GHashTable) weights_idx = g_hash_table_new(g_direct_hash, g_direct_equal);
+	g_autoptr(GPtrArray) results = NULL;
+	g_autoptr(GPtrArray) search_valid = g_ptr_array_new();
+	g_autoptr(GTimer) timer = xb_silo_start_profile(self);
+	XbSiloSearchHelper helper = {
+	    .weights = weights_idx,
+	    .search = search_valid,
+	    .heap = heap,
+	    .limit = limit,
+	};
+
+	g_return_val_if_fail(XB_IS_SILO(self), NULL);
+	g_return_val_if_fail(xpath != NULL, NULL);
+	g_return_val_if_fail(search != NULL, NULL);
+	g_return_val_if_fail(weights != NULL, NULL);
+	g_return_val_if_fail(error == NULL || *error == NULL, NULL);
+
+	/* the ASCII alternates of the fields are also matched */
+	search_tokens = g_str_tokenize_and_fold(search, NULL, NULL);
+	for (guint i = 0; search_tokens[i] != NULL; i++) {
+		if (!xb_string_token_valid(search_tokens[i]))
+			continue;
+		g_ptr_array_add(search_valid, search_tokens[i]);
+	}
+	if (search_valid->len == 0) {
+		g_set_error(error,
+			    G_IO_ERROR,
+			    G_IO_ERROR_INVALID_ARGUMENT,
+			    "no valid search terms in '%s'",
+			    search);
+		return NULL;
+	}
+
+	/* element names that are not in the silo can never match */
+	g_hash_table_iter_init(&iter, weights);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		guint32 element_idx = xb_silo_get_strtab_idx(self, key);
+		if (element_idx == XB_SILO_UNSET)
+			continue;
+		g_hash_table_insert(weights_idx, GUINT_TO_POINTER(element_idx), value);
+	}
+
+	/* score the nodes without creating an XbNode for each one */
+	if (g_hash_table_size(weights_idx) > 0) {
+		g_autoptr(GPtrArray) array = silo_query_with_root(self,
+								  NULL,
+								  xpath,
+								  0,
+								  XB_SILO_QUERY_HELPER_USE_SN,
+								  xb_silo_search_result_cb,
+								  &helper,
+								  error);
+		if (array == NULL)
+			return NULL;
+	}
+	g_array_sort(heap, xb_silo_search_result_cmp);
+
+	/* profile */
+	if (xb_silo_get_profile_flags(self) & XB_SILO_PROFILE_FLAG_XPATH) {
+		xb_silo_add_profile(self,
+				    timer,
+				    "search on `%s` for `%s` limit=%u -> %u results",
+				    xpath,
+				    search,
+				    limit,
+				    heap->len);
+	}
+
+	/* nothing found */
+	if (heap->len == 0) {
+		g_set_error(error,
+			    G_IO_ERROR,
+			    G_IO_ERROR_NOT_FOUND,
+			    "no results for search '%s'",
+			    search);
+		return NULL;
+	}
+	results = g_ptr_array_new_with_free_func((GDestroyNotify)g_object_unref);
+	for (guint i = 0; i < heap->len; i++) {
+		XbSiloSearchResult *result = &g_array_index(heap, XbSiloSearchResult, i);
+		g_ptr_array_add(results, xb_silo_create_node(self, result->sn, FALSE));
+		g_array_append_val(scores_tmp, result->score);
+	}
+	if (scores != NULL)
+		*scores = g_steal_pointer(&scores_tmp);
+	return g_steal_pointer(&results);
+}
+
 /**
  * xb_silo_query_build_index:
  * @self: a #XbSilo
@@ -749,8 +1800,14 @@ xb_silo_query_build_index(XbSilo *self, const gchar *xpath, const gchar *attr, G
 	g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
 
 	/* do the query */
-	array =
-	    silo_query_with_root(self, NULL, xpath, 0, XB_SILO_QUERY_HELPER_USE_SN, &error_local);
+	array = silo_query_with_root(self,
+				     NULL,
+				     xpath,
+				     0,
+				     XB_SILO_QUERY_HELPER_USE_SN,
+				     NULL,
+				     NULL,
+				     &error_local);
 	if (array == NULL) {
 		if (g_error_matches(error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT) ||
 		    g_error_matches(error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND)) {
@@ -767,12 +1824,14 @@ xb_silo_query_build_index(XbSilo *self, const gchar *xpath, const gchar *attr, G
 		if (attr != NULL) {
 			guint8 attr_count = xb_silo_node_get_attr_count(sn);
 			for (guint8 j = 0; j < attr_count; j++) {
-				XbSiloNodeAttr *a = xb_silo_node_get_attr(sn, j);
+				XbSiloNodeAttr *a = xb_silo_get_node_attr(self, sn, j);
+				if (a == NULL)
+					continue;
 				xb_silo_strtab_index_insert(self, a->attr_name);
 				xb_silo_strtab_index_insert(self, a->attr_value);
 			}
 		} else {
-			xb_silo_strtab_index_insert(self, xb_silo_node_get_text_idx(sn));
+			xb_silo_strtab_index_insert(self, xb_silo_get_node_text_idx(self, sn));
 		}
 	}
 
@@ -22,6 +22,8 @@ GPtrArray *
 xb_silo_query_full(XbSilo *self, XbQuery *query, GError **error);
 GPtrArray *
 xb_silo_query_with_context(XbSilo *self, XbQuery *query, XbQueryContext *context, GError **error);
+GPtrArray *
+xb_silo_query_batch(XbSilo *self, GPtrArray *queries, GPtrArray *contexts, GError **error);
 
 XbNode *
 xb_silo_query_first(XbSilo *self, const gchar *xpath, GError **error);
@@ -34,6 +36,15 @@ xb_silo_query_first_with_context(XbSilo *self,
 				 XbQueryContext *context,
 				 GError **error);
 
+GPtrArray *
+xb_silo_search_ranked(XbSilo *self,
+		      const gchar *xpath,
+		      const gchar *search,
+		      GHashTable *weights,
+		      guint limit,
+		      GArray **scores,
+		      GError **error);
+
 gboolean
 xb_silo_query_build_index(XbSilo *self, const gchar *xpath, const gchar *attr, GError **error);
 
@@ -30,10 +30,6 @@
 #include <glib-object.h>
 #include <string.h>
 
-#ifdef HAVE_LIBSTEMMER
-#include <libstemmer.h>
-#endif
-
 #include "xb-builder.h"
 #include "xb-common-private.h"
 #include "xb-machine-private.h"
@@ -49,10 +45,18 @@ typedef struct {
 	gboolean valid;
 	GBytes *blob;
 	const guint8 *data; /* pointers into ->blob */
-	guint32 datasz;
-	guint32 strtab;
+	gsize datasz;
+	guint32 hdrsz;	     /* header, before the section directory */
+	gboolean wide;	     /* every node has the ->parent and ->next high bits */
+	guint64 nodetab;     /* first node */
+	guint64 nodetab_end; /* first section, or the strtab */
+	guint64 strtab;
+	gconstpointer sections[XB_SILO_SECTION_KIND_LAST];
+	guint64 sections_sz[XB_SILO_SECTION_KIND_LAST];
+	guint32 split_cnt; /* nodes in the cold sections */
 	GHashTable *strtab_tags;
 	GHashTable *strindex;
+	gint has_lang; /* (atomic) -1 until the strtab has been scanned for xml:lang */
 	gboolean enable_node_cache;
 	GHashTable *nodes; /* (mutex nodes_mutex) */
 	GMutex nodes_mutex;
@@ -65,10 +69,6 @@ typedef struct {
 	GRWLock query_cache_mutex;
 	GHashTable *query_cache;
 	GMainContext *context; /* (owned) */
-#ifdef HAVE_LIBSTEMMER
-	struct sb_stemmer *stemmer_ctx; /* lazy loaded */
-	GMutex stemmer_mutex;
-#endif
 } XbSiloPrivate;
 
 typedef struct {
@@ -154,39 +154,6 @@ xb_silo_add_profile(XbSilo *self, GTimer *timer, const gchar *fmt, ...)
 		g_timer_reset(timer);
 }
 
-/* private */
-static gchar *
-xb_silo_stem(XbSilo *self, const gchar *value)
-{
-#ifdef HAVE_LIBSTEMMER
-	XbSiloPrivate *priv = GET_PRIVATE(self);
-	const gchar *tmp;
-	gsize len_dst;
-	gsize len_src;
-	g_autofree gchar *value_casefold = NULL;
-	g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->stemmer_mutex);
-
-	g_return_val_if_fail(locker != NULL, NULL);
-
-	/* not enabled */
-	value_casefold = g_utf8_casefold(value, -1);
-	if (priv->stemmer_ctx == NULL)
-		priv->stemmer_ctx = sb_stemmer_new("en", NULL);
-
-	/* stem */
-	len_src = strlen(value_casefold);
-	tmp = (const gchar *)sb_stemmer_stem(priv->stemmer_ctx,
-					     (guchar *)value_casefold,
-					     (gint)len_src);
-	len_dst = (gsize)sb_stemmer_length(priv->stemmer_ctx);
-	if (len_src == len_dst)
-		return g_steal_pointer(&value_casefold);
-	return g_strndup(tmp, len_dst);
-#else
-	return g_utf8_casefold(value, -1);
-#endif
-}
-
 /* private */
 const gchar *
 xb_silo_from_strtab(XbSilo *self, guint32 offset)
@@ -228,16 +195,45 @@ xb_silo_strtab_index_lookup(XbSilo *self, const gchar *str)
 	return GPOINTER_TO_INT(val);
 }
 
+/* private: the offset of @str anywhere in the deduplicated strtab, or
+ * %XB_SILO_UNSET if not found or if the builder did not write the sorted
+ * section, which can be checked using xb_silo_get_section() */
+guint32
+xb_silo_strtab_find(XbSilo *self, const gchar *str)
+{
+	const guint32 *sorted;
+	guint64 sz = 0;
+	gsize lo = 0;
+	gsize hi;
+
+	/* binary search */
+	sorted = xb_silo_get_section(self, XB_SILO_SECTION_KIND_STRTAB_SORTED, &sz);
+	if (sorted == NULL)
+		return XB_SILO_UNSET;
+	hi = sz / sizeof(guint32);
+	while (lo < hi) {
+		gsize mid = lo + (hi - lo) / 2;
+		gint rc = g_strcmp0(str, xb_silo_from_strtab(self, sorted[mid]));
+		if (rc == 0)
+			return sorted[mid];
+		if (rc < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return XB_SILO_UNSET;
+}
+
 /* private */
 XbSiloNode *
-xb_silo_get_node(XbSilo *self, guint32 off)
+xb_silo_get_node(XbSilo *self, guint64 off)
 {
 	XbSiloPrivate *priv = GET_PRIVATE(self);
 	return (XbSiloNode *)(priv->data + off);
 }
 
 /* private */
-guint32
+guint64
 xb_silo_get_offset_for_node(XbSilo *self, XbSiloNode *n)
 {
 	XbSiloPrivate *priv = GET_PRIVATE(self);
@@ -245,7 +241,17 @@ xb_silo_get_offset_for_node(XbSilo *self, XbSiloNode *n)
 }
 
 /* private */
-guint32
+gconstpointer
+xb_silo_get_section(XbSilo *self, XbSiloSectionKind kind, guint64 *size)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	if (size != NULL)
+		*size = priv->sections_sz[kind];
+	return priv->sections[kind];
+}
+
+/* private */
+guint64
 xb_silo_get_strtab(XbSilo *self)
 {
 	XbSiloPrivate *priv = GET_PRIVATE(self);
@@ -259,36 +265,41 @@ xb_silo_get_root_node(XbSilo *self)
 	XbSiloPrivate *priv = GET_PRIVATE(self);
 	if (priv->blob == NULL)
 		return NULL;
-	if (g_bytes_get_size(priv->blob) <= sizeof(XbSiloHeader))
+	if (priv->datasz <= priv->nodetab)
 		return NULL;
-	return _xb_silo_get_node(self, sizeof(XbSiloHeader));
+	return _xb_silo_get_node(self, priv->nodetab);
 }
 
 /* private */
 XbSiloNode *
 xb_silo_get_parent_node(XbSilo *self, XbSiloNode *n)
 {
-	if (n->parent == 0x0)
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	guint64 parent = xb_silo_node_get_parent(n, priv->wide);
+	if (parent == 0x0)
 		return NULL;
-	return _xb_silo_get_node(self, n->parent);
+	return _xb_silo_get_node(self, parent);
 }
 
 /* private */
 XbSiloNode *
 xb_silo_get_next_node(XbSilo *self, XbSiloNode *n)
 {
-	if (n->next == 0x0)
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	guint64 next = xb_silo_node_get_next(n, priv->wide);
+	if (next == 0x0)
 		return NULL;
-	return _xb_silo_get_node(self, n->next);
+	return _xb_silo_get_node(self, next);
 }
 
 /* private */
 XbSiloNode *
 xb_silo_get_child_node(XbSilo *self, XbSiloNode *n)
 {
+	XbSiloPrivate *priv = GET_PRIVATE(self);
 	XbSiloNode *c;
-	guint32 off = xb_silo_get_offset_for_node(self, n);
-	off += xb_silo_node_get_size(n);
+	guint64 off = xb_silo_get_offset_for_node(self, n);
+	off += xb_silo_node_get_size(n, priv->wide);
 
 	/* check for sentinel */
 	c = _xb_silo_get_node(self, off);
@@ -297,6 +308,129 @@ xb_silo_get_child_node(XbSilo *self, XbSiloNode *n)
 	return c;
 }
 
+/* private: returns %NULL if the silo was not built with
+ * XB_BUILDER_COMPILE_FLAG_CHILD_INDEX */
+const guint64 *
+xb_silo_get_children(XbSilo *self, XbSiloNode *n, guint32 *count)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	const XbSiloChildren *children_idx = priv->sections[XB_SILO_SECTION_KIND_CHILDREN_IDX];
+	const guint64 *children = priv->sections[XB_SILO_SECTION_KIND_CHILDREN];
+	guint64 children_cnt = priv->sections_sz[XB_SILO_SECTION_KIND_CHILDREN] / sizeof(guint64);
+	guint64 parent = n != NULL ? xb_silo_get_offset_for_node(self, n) : 0;
+	gsize lo = 0;
+	gsize hi = priv->sections_sz[XB_SILO_SECTION_KIND_CHILDREN_IDX] / sizeof(XbSiloChildren);
+
+	if (children_idx == NULL || children == NULL)
+		return NULL;
+	*count = 0;
+	while (lo < hi) {
+		gsize mid = lo + (hi - lo) / 2;
+		if (children_idx[mid].parent == parent) {
+			if ((guint64)children_idx[mid].idx + children_idx[mid].count > children_cnt)
+				return children;
+			*count = children_idx[mid].count;
+			return children + children_idx[mid].idx;
+		}
+		if (children_idx[mid].parent < parent)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return children;
+}
+
+/* private: returns %NULL if the silo was not built with
+ * XB_BUILDER_COMPILE_FLAG_ELEMENT_INDEX */
+const guint64 *
+xb_silo_get_elements(XbSilo *self, guint32 element_name, guint32 *count)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	const XbSiloElements *elements_idx = priv->sections[XB_SILO_SECTION_KIND_ELEMENTS_IDX];
+	const guint64 *elements = priv->sections[XB_SILO_SECTION_KIND_ELEMENTS];
+	guint64 elements_cnt = priv->sections_sz[XB_SILO_SECTION_KIND_ELEMENTS] / sizeof(guint64);
+	gsize lo = 0;
+	gsize hi = priv->sections_sz[XB_SILO_SECTION_KIND_ELEMENTS_IDX] / sizeof(XbSiloElements);
+
+	if (elements_idx == NULL || elements == NULL)
+		return NULL;
+	*count = 0;
+	while (lo < hi) {
+		gsize mid = lo + (hi - lo) / 2;
+		if (elements_idx[mid].element_name == element_name) {
+			if ((guint64)elements_idx[mid].idx + elements_idx[mid].count > elements_cnt)
+				return elements;
+			*count = elements_idx[mid].count;
+			return elements + elements_idx[mid].idx;
+		}
+		if (elements_idx[mid].element_name < element_name)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return elements;
+}
+
+/* the end of the subtree for a node without a next sibling, or 0x0 if the silo
+ * was not built with XB_BUILDER_COMPILE_FLAG_SUBTREE_END */
+static guint64
+xb_silo_get_subtree_end_stored(XbSilo *self, guint64 offset)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	const XbSiloSubtree *subtrees = priv->sections[XB_SILO_SECTION_KIND_SUBTREE_END];
+	gsize lo = 0;
+	gsize hi = priv->sections_sz[XB_SILO_SECTION_KIND_SUBTREE_END] / sizeof(XbSiloSubtree);
+
+	if (subtrees == NULL)
+		return 0x0;
+	while (lo < hi) {
+		gsize mid = lo + (hi - lo) / 2;
+		if (subtrees[mid].offset == offset)
+			return MIN(subtrees[mid].end, priv->nodetab_end);
+		if (subtrees[mid].offset < offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return 0x0;
+}
+
+/* private: the nodetab is pre-order, so the subtree of @n is the range up to
+ * the returned offset, and no other element node starts before it; this is the
+ * next sibling of the node, the stored end, or the next sibling of the closest
+ * ancestor that has one */
+guint64
+xb_silo_get_subtree_end(XbSilo *self, XbSiloNode *n)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	guint64 end;
+
+	if (n == NULL)
+		return priv->nodetab_end;
+	end = xb_silo_node_get_next(n, priv->wide);
+	if (end != 0x0)
+		return end;
+	end = xb_silo_get_subtree_end_stored(self, xb_silo_get_offset_for_node(self, n));
+	if (end != 0x0)
+		return end;
+	while ((n = xb_silo_get_parent_node(self, n)) != NULL) {
+		end = xb_silo_node_get_next(n, priv->wide);
+		if (end != 0x0)
+			return end;
+	}
+	return priv->nodetab_end;
+}
+
+/* private: @n is a descendant if it starts inside the subtree of @ancestor */
+gboolean
+xb_silo_is_descendant(XbSilo *self, XbSiloNode *n, XbSiloNode *ancestor)
+{
+	guint64 off = xb_silo_get_offset_for_node(self, n);
+	if (off <= xb_silo_get_offset_for_node(self, ancestor))
+		return FALSE;
+	return off < xb_silo_get_subtree_end(self, ancestor);
+}
+
 /**
  * xb_silo_get_root:
  * @self: a #XbSilo
@@ -340,8 +474,8 @@ xb_silo_get_strtab_idx(XbSilo *self, const gchar *element)
 gchar *
 xb_silo_to_string(XbSilo *self, GError **error)
 {
-	guint32 off = sizeof(XbSiloHeader);
 	XbSiloPrivate *priv = GET_PRIVATE(self);
+	guint64 off = priv->nodetab;
 	XbSiloHeader *hdr = (XbSiloHeader *)priv->data;
 	g_autoptr(GString) str = g_string_new(NULL);
 
@@ -349,23 +483,36 @@ xb_silo_to_string(XbSilo *self, GError **error)
 	g_return_val_if_fail(error == NULL || *error == NULL, NULL);
 
 	/* sanity check */
-	if (hdr->strtab > priv->datasz) {
+	if (priv->strtab > priv->datasz) {
 		g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "strtab invalid");
 		return NULL;
 	}
 
 	g_string_append_printf(str, "magic:        %08x\n", (guint)hdr->magic);
+	g_string_append_printf(str, "version:      %08x\n", (guint)hdr->version);
 	g_string_append_printf(str, "guid:         %s\n", priv->guid);
-	g_string_append_printf(str, "strtab:       @%" G_GUINT32_FORMAT "\n", hdr->strtab);
+	g_string_append_printf(str, "strtab:       @%" G_GUINT64_FORMAT "\n", priv->strtab);
 	g_string_append_printf(str, "strtab_ntags: %" G_GUINT16_FORMAT "\n", hdr->strtab_ntags);
-	while (off < priv->strtab) {
+	for (guint8 i = 0; i < hdr->nsections; i++) {
+		XbSiloSection sect;
+		memcpy(&sect,
+		       priv->data + priv->hdrsz + i * sizeof(XbSiloSection),
+		       sizeof(sect));
+		g_string_append_printf(str,
+				       "section:      %" G_GUINT32_FORMAT " @%" G_GUINT64_FORMAT
+				       " [%" G_GUINT64_FORMAT "]\n",
+				       sect.kind,
+				       sect.offset,
+				       sect.size);
+	}
+	while (off < priv->nodetab_end) {
 		XbSiloNode *n = _xb_silo_get_node(self, off);
 		if (xb_silo_node_has_flag(n, XB_SILO_NODE_FLAG_IS_ELEMENT)) {
 			guint32 idx;
-			g_string_append_printf(str, "NODE @%" G_GUINT32_FORMAT "\n", off);
+			g_string_append_printf(str, "NODE @%" G_GUINT64_FORMAT "\n", off);
 			g_string_append_printf(str,
 					       "size:         %" G_GUINT32_FORMAT "\n",
-					       xb_silo_node_get_size(n));
+					       xb_silo_node_get_size(n, priv->wide));
 			g_string_append_printf(str,
 					       "flags:        %x\n",
 					       xb_silo_node_get_flags(n));
@@ -374,19 +521,24 @@ xb_silo_to_string(XbSilo *self, GError **error)
 					       xb_silo_from_strtab(self, n->element_name),
 					       n->element_name);
 			g_string_append_printf(str,
-					       "next:         %" G_GUINT32_FORMAT "\n",
-					       n->next);
+					       "next:         %" G_GUINT64_FORMAT "\n",
+					       xb_silo_node_get_next(n, priv->wide));
 			g_string_append_printf(str,
-					       "parent:       %" G_GUINT32_FORMAT "\n",
-					       n->parent);
-			idx = xb_silo_node_get_text_idx(n);
+					       "parent:       %" G_GUINT64_FORMAT "\n",
+					       xb_silo_node_get_parent(n, priv->wide));
+			if (xb_silo_node_has_flag(n, XB_SILO_NODE_FLAG_HAS_BLOOM)) {
+				g_string_append_printf(str,
+						       "bloom:        %016" G_GINT64_MODIFIER "x\n",
+						       xb_silo_node_get_bloom(n));
+			}
+			idx = xb_silo_get_node_text_idx(self, n);
 			if (idx != XB_SILO_UNSET) {
 				g_string_append_printf(str,
 						       "text:         %s [%03u]\n",
 						       xb_silo_from_strtab(self, idx),
 						       idx);
 			}
-			idx = xb_silo_node_get_tail_idx(n);
+			idx = xb_silo_get_node_tail_idx(self, n);
 			if (idx != XB_SILO_UNSET) {
 				g_string_append_printf(str,
 						       "tail:         %s [%03u]\n",
@@ -394,7 +546,9 @@ xb_silo_to_string(XbSilo *self, GError **error)
 						       idx);
 			}
 			for (guint8 i = 0; i < xb_silo_node_get_attr_count(n); i++) {
-				XbSiloNodeAttr *a = xb_silo_node_get_attr(n, i);
+				XbSiloNodeAttr *a = xb_silo_get_node_attr(self, n, i);
+				if (a == NULL)
+					continue;
 				g_string_append_printf(str,
 						       "attr_name:    %s [%03u]\n",
 						       xb_silo_from_strtab(self, a->attr_name),
@@ -405,37 +559,119 @@ xb_silo_to_string(XbSilo *self, GError **error)
 						       a->attr_value);
 			}
 			for (guint8 i = 0; i < xb_silo_node_get_token_count(n); i++) {
-				guint32 idx_tmp = xb_silo_node_get_token_idx(n, i);
+				guint32 idx_tmp = xb_silo_get_node_token_idx(self, n, i);
 				g_string_append_printf(str,
 						       "token:        %s [%03u]\n",
 						       xb_silo_from_strtab(self, idx_tmp),
 						       idx_tmp);
 			}
 		} else {
-			g_string_append_printf(str, "SENT @%" G_GUINT32_FORMAT "\n", off);
+			g_string_append_printf(str, "SENT @%" G_GUINT64_FORMAT "\n", off);
 		}
-		off += xb_silo_node_get_size(n);
+		off += xb_silo_node_get_size(n, priv->wide);
 	}
 
 	/* add strtab */
-	g_string_append_printf(str, "STRTAB @%" G_GUINT32_FORMAT "\n", hdr->strtab);
-	for (off = 0; off < priv->datasz - hdr->strtab;) {
-		const gchar *tmp = xb_silo_from_strtab(self, off);
+	g_string_append_printf(str, "STRTAB @%" G_GUINT64_FORMAT "\n", priv->strtab);
+	for (guint32 idx = 0; idx < priv->datasz - priv->strtab;) {
+		const gchar *tmp = xb_silo_from_strtab(self, idx);
 		if (tmp == NULL)
 			break;
-		g_string_append_printf(str, "[%03u]: %s\n", off, tmp);
-		off += strlen(tmp) + 1;
+		g_string_append_printf(str, "[%03u]: %s\n", idx, tmp);
+		idx += strlen(tmp) + 1;
 	}
 
 	/* success */
 	return g_string_free(g_steal_pointer(&str), FALSE);
 }
 
+/* private */
+guint32
+xb_silo_get_node_text_idx(XbSilo *self, XbSiloNode *n)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	const guint32 *text = priv->sections[XB_SILO_SECTION_KIND_NODE_TEXT];
+	guint32 split_idx;
+
+	if (!xb_silo_node_has_flag(n, XB_SILO_NODE_FLAG_IS_SPLIT))
+		return xb_silo_node_get_text_idx(n);
+	split_idx = xb_silo_node_get_split_idx(n);
+	if (split_idx >= priv->split_cnt)
+		return XB_SILO_UNSET;
+	return text[split_idx];
+}
+
+/* private */
+guint32
+xb_silo_get_node_tail_idx(XbSilo *self, XbSiloNode *n)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	const guint32 *tail = priv->sections[XB_SILO_SECTION_KIND_NODE_TAIL];
+	guint32 split_idx;
+
+	if (!xb_silo_node_has_flag(n, XB_SILO_NODE_FLAG_IS_SPLIT))
+		return xb_silo_node_get_tail_idx(n);
+	split_idx = xb_silo_node_get_split_idx(n);
+	if (split_idx >= priv->split_cnt)
+		return XB_SILO_UNSET;
+	return tail[split_idx];
+}
+
+/* private */
+XbSiloNodeAttr *
+xb_silo_get_node_attr(XbSilo *self, XbSiloNode *n, guint8 idx)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	const guint32 *attrs_idx = priv->sections[XB_SILO_SECTION_KIND_NODE_ATTRS];
+	const XbSiloNodeAttr *attrs = priv->sections[XB_SILO_SECTION_KIND_ATTRS];
+	guint64 attrs_cnt = priv->sections_sz[XB_SILO_SECTION_KIND_ATTRS] / sizeof(XbSiloNodeAttr);
+	guint64 attr_idx;
+	guint32 split_idx;
+
+	if (!xb_silo_node_has_flag(n, XB_SILO_NODE_FLAG_IS_SPLIT))
+		return xb_silo_node_get_attr(n, idx);
+	split_idx = xb_silo_node_get_split_idx(n);
+	if (split_idx >= priv->split_cnt)
+		return NULL;
+	attr_idx = (guint64)attrs_idx[split_idx] + idx;
+	if (attr_idx >= attrs_cnt) {
+		g_critical("attr %" G_GUINT64_FORMAT " is outside the attrs section", attr_idx);
+		return NULL;
+	}
+	return (XbSiloNodeAttr *)&attrs[attr_idx];
+}
+
+/* private */
+guint32
+xb_silo_get_node_token_idx(XbSilo *self, XbSiloNode *n, guint idx)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	const guint32 *tokens_idx = priv->sections[XB_SILO_SECTION_KIND_NODE_TOKENS];
+	const guint32 *tokens = priv->sections[XB_SILO_SECTION_KIND_TOKENS];
+	guint64 tokens_cnt = priv->sections_sz[XB_SILO_SECTION_KIND_TOKENS] / sizeof(guint32);
+	guint64 token_idx;
+	guint32 split_idx;
+
+	if (!xb_silo_node_has_flag(n, XB_SILO_NODE_FLAG_IS_SPLIT))
+		return xb_silo_node_get_token_idx(n, idx);
+	if (!xb_silo_node_has_flag(n, XB_SILO_NODE_FLAG_IS_TOKENIZED))
+		return XB_SILO_UNSET;
+	split_idx = xb_silo_node_get_split_idx(n);
+	if (split_idx >= priv->split_cnt)
+		return XB_SILO_UNSET;
+	token_idx = (guint64)tokens_idx[split_idx] + idx;
+	if (token_idx >= tokens_cnt) {
+		g_critical("token %" G_GUINT64_FORMAT " is outside the tokens section", token_idx);
+		return XB_SILO_UNSET;
+	}
+	return tokens[token_idx];
+}
+
 /* private */
 const gchar *
 xb_silo_get_node_text(XbSilo *self, XbSiloNode *n)
 {
-	guint32 idx = xb_silo_node_get_text_idx(n);
+	guint32 idx = xb_silo_get_node_text_idx(self, n);
 	if (idx == XB_SILO_UNSET)
 		return NULL;
 	return xb_silo_from_strtab(self, idx);
@@ -445,7 +681,7 @@ xb_silo_get_node_text(XbSilo *self, XbSiloNode *n)
 const gchar *
 xb_silo_get_node_tail(XbSilo *self, XbSiloNode *n)
 {
-	guint idx = xb_silo_node_get_tail_idx(n);
+	guint idx = xb_silo_get_node_tail_idx(self, n);
 	if (idx == XB_SILO_UNSET)
 		return NULL;
 	return xb_silo_from_strtab(self, idx);
@@ -467,7 +703,9 @@ xb_silo_get_node_attr_by_str(XbSilo *self, XbSiloNode *n, const gchar *name)
 	/* calculate offset to first attribute */
 	attr_count = xb_silo_node_get_attr_count(n);
 	for (guint8 i = 0; i < attr_count; i++) {
-		XbSiloNodeAttr *a = xb_silo_node_get_attr(n, i);
+		XbSiloNodeAttr *a = xb_silo_get_node_attr(self, n, i);
+		if (a == NULL)
+			continue;
 		if (g_strcmp0(xb_silo_from_strtab(self, a->attr_name), name) == 0)
 			return a;
 	}
@@ -484,7 +722,9 @@ xb_silo_node_get_attr_by_val(XbSilo *self, XbSiloNode *n, guint32 name)
 	/* calculate offset to first attribute */
 	attr_count = xb_silo_node_get_attr_count(n);
 	for (guint8 i = 0; i < attr_count; i++) {
-		XbSiloNodeAttr *a = xb_silo_node_get_attr(n, i);
+		XbSiloNodeAttr *a = xb_silo_get_node_attr(self, n, i);
+		if (a == NULL)
+			continue;
 		if (a->attr_name == name)
 			return a;
 	}
@@ -507,16 +747,16 @@ guint
 xb_silo_get_size(XbSilo *self)
 {
 	XbSiloPrivate *priv = GET_PRIVATE(self);
-	guint32 off = sizeof(XbSiloHeader);
+	guint64 off = priv->nodetab;
 	guint nodes_cnt = 0;
 
 	g_return_val_if_fail(XB_IS_SILO(self), 0);
 
-	while (off < priv->strtab) {
+	while (off < priv->nodetab_end) {
 		XbSiloNode *n = _xb_silo_get_node(self, off);
 		if (xb_silo_node_has_flag(n, XB_SILO_NODE_FLAG_IS_ELEMENT))
 			nodes_cnt += 1;
-		off += xb_silo_node_get_size(n);
+		off += xb_silo_node_get_size(n, priv->wide);
 	}
 
 	/* success */
@@ -549,7 +789,15 @@ xb_silo_is_empty(XbSilo *self)
 {
 	XbSiloPrivate *priv = GET_PRIVATE(self);
 	g_return_val_if_fail(XB_IS_SILO(self), FALSE);
-	return priv->strtab == sizeof(XbSiloHeader);
+	return priv->nodetab_end == priv->nodetab;
+}
+
+/* private */
+gboolean
+xb_silo_is_wide(XbSilo *self)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	return priv->wide;
 }
 
 typedef struct {
@@ -624,10 +872,11 @@ xb_silo_uninvalidate(XbSilo *self)
 guint
 xb_silo_get_node_depth(XbSilo *self, XbSiloNode *n)
 {
+	XbSiloPrivate *priv = GET_PRIVATE(self);
 	guint depth = 0;
-	while (n->parent != 0) {
+	while (xb_silo_node_get_parent(n, priv->wide) != 0) {
 		depth++;
-		n = _xb_silo_get_node(self, n->parent);
+		n = _xb_silo_get_node(self, xb_silo_node_get_parent(n, priv->wide));
 	}
 	return depth;
 }
@@ -681,6 +930,88 @@ xb_silo_get_machine(XbSilo *self)
 	return priv->machine;
 }
 
+static gboolean
+xb_silo_load_sections(XbSilo *self, GError **error)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	XbSiloHeader *hdr = (XbSiloHeader *)priv->data;
+
+	/* check strtab */
+	if (hdr->version == XB_SILO_VERSION_WIDE) {
+		XbSiloHeaderWide *hdr_wide = (XbSiloHeaderWide *)priv->data;
+		if (priv->datasz < sizeof(XbSiloHeaderWide)) {
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "blob too small");
+			return FALSE;
+		}
+		priv->hdrsz = sizeof(XbSiloHeaderWide);
+		priv->strtab = hdr_wide->strtab;
+		priv->wide = TRUE;
+	} else {
+		priv->hdrsz = sizeof(XbSiloHeader);
+		priv->strtab = hdr->strtab;
+		priv->wide = FALSE;
+	}
+	if (priv->strtab > priv->datasz) {
+		g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "strtab incorrect");
+		return FALSE;
+	}
+
+	/* load the section directory */
+	memset(priv->sections, 0, sizeof(priv->sections));
+	memset(priv->sections_sz, 0, sizeof(priv->sections_sz));
+	priv->split_cnt = 0;
+	priv->nodetab = priv->hdrsz + hdr->nsections * sizeof(XbSiloSection);
+	priv->nodetab_end = priv->strtab;
+	if (priv->nodetab > priv->strtab) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "nsections incorrect");
+		return FALSE;
+	}
+	for (guint8 i = 0; i < hdr->nsections; i++) {
+		XbSiloSection sect;
+		memcpy(&sect,
+		       priv->data + priv->hdrsz + i * sizeof(XbSiloSection),
+		       sizeof(sect));
+		if (sect.offset < priv->nodetab || sect.offset > priv->strtab ||
+		    sect.size > priv->strtab - sect.offset || sect.offset % 8 != 0) {
+			g_set_error(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "section %u incorrect",
+				    (guint)i);
+			return FALSE;
+		}
+		priv->nodetab_end = MIN(priv->nodetab_end, sect.offset);
+
+		/* ignore sections added in the future */
+		if (sect.kind == XB_SILO_SECTION_KIND_UNKNOWN ||
+		    sect.kind >= XB_SILO_SECTION_KIND_LAST)
+			continue;
+		priv->sections[sect.kind] = priv->data + sect.offset;
+		priv->sections_sz[sect.kind] = sect.size;
+	}
+
+	/* the cold data for the split layout has to exist for every node */
+	if (priv->sections[XB_SILO_SECTION_KIND_NODE_TEXT] != NULL &&
+	    priv->sections[XB_SILO_SECTION_KIND_NODE_TAIL] != NULL &&
+	    priv->sections[XB_SILO_SECTION_KIND_NODE_ATTRS] != NULL &&
+	    priv->sections[XB_SILO_SECTION_KIND_NODE_TOKENS] != NULL) {
+		guint64 split_sz = priv->sections_sz[XB_SILO_SECTION_KIND_NODE_TEXT];
+		split_sz = MIN(split_sz, priv->sections_sz[XB_SILO_SECTION_KIND_NODE_TAIL]);
+		split_sz = MIN(split_sz, priv->sections_sz[XB_SILO_SECTION_KIND_NODE_ATTRS]);
+		split_sz = MIN(split_sz, priv->sections_sz[XB_SILO_SECTION_KIND_NODE_TOKENS]);
+		priv->split_cnt = MIN(split_sz / sizeof(guint32), G_MAXUINT32);
+	}
+
+	/* success */
+	return TRUE;
+}
+
 /**
  * xb_silo_load_from_bytes:
  * @self: a #XbSilo
@@ -718,6 +1049,12 @@ xb_silo_load_from_bytes(XbSilo *self, GBytes *blob, XbSiloLoadFlags flags, GErro
 
 	g_hash_table_remove_all(priv->strtab_tags);
 	g_clear_pointer(&priv->guid, g_free);
+	g_atomic_int_set(&priv->has_lang, -1);
+
+	/* queries may have been optimized using the old strtab */
+	g_rw_lock_writer_lock(&priv->query_cache_mutex);
+	g_hash_table_remove_all(priv->query_cache);
+	g_rw_lock_writer_unlock(&priv->query_cache_mutex);
 
 	/* refcount internally */
 	if (priv->blob != NULL)
@@ -726,7 +1063,7 @@ xb_silo_load_from_bytes(XbSilo *self, GBytes *blob, XbSiloLoadFlags flags, GErro
 
 	/* update pointers into blob */
 	priv->data = g_bytes_get_data(priv->blob, &sz);
-	priv->datasz = (guint32)sz;
+	priv->datasz = sz;
 
 	/* check size */
 	if (sz < sizeof(XbSiloHeader)) {
@@ -744,7 +1081,7 @@ xb_silo_load_from_bytes(XbSilo *self, GBytes *blob, XbSiloLoadFlags flags, GErro
 					    "magic incorrect");
 			return FALSE;
 		}
-		if (hdr->version != XB_SILO_VERSION) {
+		if (hdr->version != XB_SILO_VERSION && hdr->version != XB_SILO_VERSION_WIDE) {
 			g_set_error(error,
 				    G_IO_ERROR,
 				    G_IO_ERROR_INVALID_DATA,
@@ -759,12 +1096,9 @@ xb_silo_load_from_bytes(XbSilo *self, GBytes *blob, XbSiloLoadFlags flags, GErro
 	memcpy(&guid_tmp, &hdr->guid, sizeof(guid_tmp));
 	priv->guid = xb_guid_to_string(&guid_tmp);
 
-	/* check strtab */
-	priv->strtab = hdr->strtab;
-	if (priv->strtab > priv->datasz) {
-		g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "strtab incorrect");
+	/* parse the nodetab and sections */
+	if (!xb_silo_load_sections(self, error))
 		return FALSE;
-	}
 
 	/* load strtab_tags */
 	for (guint16 i = 0; i < hdr->strtab_ntags; i++) {
@@ -1223,6 +1557,107 @@ xb_silo_machine_fixup_attr_exists_cb(XbMachine *self,
 	return TRUE;
 }
 
+/* convert "'type' attr() 'desktop' eq()" -> "'type' 'desktop' attr-eq()" */
+static gboolean
+xb_silo_machine_fixup_attr_eq_cb(XbMachine *self,
+				 XbStack *opcodes,
+				 gpointer user_data,
+				 GError **error)
+{
+	XbOpcode *op_tmp;
+	g_auto(XbOpcode) op_eq = XB_OPCODE_INIT();
+	g_auto(XbOpcode) op_value = XB_OPCODE_INIT();
+	g_auto(XbOpcode) op_attr = XB_OPCODE_INIT();
+
+	/* eq() */
+	if (!xb_machine_stack_pop(self, opcodes, &op_eq, error))
+		return FALSE;
+
+	/* TEXT */
+	if (!xb_machine_stack_pop(self, opcodes, &op_value, error))
+		return FALSE;
+
+	/* attr() */
+	if (!xb_machine_stack_pop(self, opcodes, &op_attr, error))
+		return FALSE;
+
+	/* TEXT */
+	if (!xb_machine_stack_push(self, opcodes, &op_tmp, error))
+		return FALSE;
+	*op_tmp = op_value;
+	op_value.destroy_func = NULL;
+
+	/* attr-eq() */
+	if (!xb_machine_stack_push(self, opcodes, &op_tmp, error))
+		return FALSE;
+	if (!xb_machine_opcode_func_init(self, op_tmp, "attr-eq")) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_NOT_SUPPORTED,
+				    "no attr-eq opcode");
+		return FALSE;
+	}
+	xb_opcode_set_level(op_tmp, _xb_opcode_get_level(&op_eq));
+	return TRUE;
+}
+
+/* an attribute or text compared with an integer is read as a number, which
+ * avoids parsing the string for every node */
+static gboolean
+xb_silo_machine_fixup_number_cb(XbMachine *self,
+				XbStack *opcodes,
+				gpointer user_data,
+				GError **error)
+{
+	XbOpcode *op_tmp;
+	const gchar *func_name;
+	g_auto(XbOpcode) op_cmp = XB_OPCODE_INIT();
+	g_auto(XbOpcode) op_value = XB_OPCODE_INIT();
+	g_auto(XbOpcode) op_func = XB_OPCODE_INIT();
+
+	/* eq() */
+	if (!xb_machine_stack_pop(self, opcodes, &op_cmp, error))
+		return FALSE;
+
+	/* INTE */
+	if (!xb_machine_stack_pop(self, opcodes, &op_value, error))
+		return FALSE;
+
+	/* attr() or text() */
+	if (!xb_machine_stack_pop(self, opcodes, &op_func, error))
+		return FALSE;
+	if (g_strcmp0(xb_opcode_get_str(&op_func), "attr") == 0)
+		func_name = "attr-number";
+	else
+		func_name = "text-number";
+
+	/* attr-number() or text-number() */
+	if (!xb_machine_stack_push(self, opcodes, &op_tmp, error))
+		return FALSE;
+	if (!xb_machine_opcode_func_init(self, op_tmp, func_name)) {
+		g_set_error(error,
+			    G_IO_ERROR,
+			    G_IO_ERROR_NOT_SUPPORTED,
+			    "no %s opcode",
+			    func_name);
+		return FALSE;
+	}
+	xb_opcode_set_level(op_tmp, _xb_opcode_get_level(&op_func));
+
+	/* INTE */
+	if (!xb_machine_stack_push(self, opcodes, &op_tmp, error))
+		return FALSE;
+	*op_tmp = op_value;
+	op_value.destroy_func = NULL;
+
+	/* eq() */
+	if (!xb_machine_stack_push(self, opcodes, &op_tmp, error))
+		return FALSE;
+	*op_tmp = op_cmp;
+	op_cmp.destroy_func = NULL;
+	return TRUE;
+}
+
 static gboolean
 xb_silo_machine_fixup_attr_search_token_cb(XbMachine *self,
 					   XbStack *opcodes,
@@ -1312,6 +1747,56 @@ xb_silo_machine_func_attr_cb(XbMachine *self,
 	return TRUE;
 }
 
+/* returns XB_SILO_UNSET if the silo was not built with
+ * XB_BUILDER_COMPILE_FLAG_STEM or if @idx is not the text of a node */
+static guint32
+xb_silo_strtab_stem(XbSilo *self, guint32 idx, guint32 lang)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	const XbSiloStrtabStem *stems = priv->sections[XB_SILO_SECTION_KIND_STRTAB_STEM];
+	gsize lo = 0;
+	gsize hi = priv->sections_sz[XB_SILO_SECTION_KIND_STRTAB_STEM] / sizeof(XbSiloStrtabStem);
+
+	if (stems == NULL)
+		return XB_SILO_UNSET;
+	while (lo < hi) {
+		gsize mid = lo + (hi - lo) / 2;
+		if (stems[mid].idx == idx && stems[mid].lang == lang)
+			return stems[mid].idx_stem;
+		if (stems[mid].idx < idx || (stems[mid].idx == idx && stems[mid].lang < lang))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return XB_SILO_UNSET;
+}
+
+/* any node with an xml:lang attribute changes how stem() works, but the
+ * attribute names are not indexed so the strtab is scanned once */
+static gboolean
+xb_silo_has_lang(XbSilo *self)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	gint has_lang = g_atomic_int_get(&priv->has_lang);
+
+	if (has_lang == -1) {
+		const gchar *strtab = (const gchar *)(priv->data + priv->strtab);
+		gsize sz = priv->datasz - priv->strtab;
+		has_lang = FALSE;
+		for (gsize off = 0; off < sz;) {
+			const gchar *tmp = strtab + off;
+			gsize len = strnlen(tmp, sz - off);
+			if (len == strlen("xml:lang") && memcmp(tmp, "xml:lang", len) == 0) {
+				has_lang = TRUE;
+				break;
+			}
+			off += len + 1;
+		}
+		g_atomic_int_set(&priv->has_lang, has_lang);
+	}
+	return has_lang;
+}
+
 static gboolean
 xb_silo_machine_func_stem_cb(XbMachine *self,
 			     XbStack *stack,
@@ -1321,10 +1806,27 @@ xb_silo_machine_func_stem_cb(XbMachine *self,
 			     GError **error)
 {
 	XbSilo *silo = XB_SILO(user_data);
+	XbSiloQueryData *query_data = (XbSiloQueryData *)exec_data;
 	XbOpcode *head;
+	XbOpcode *op_tmp;
+	XbSiloNodeAttr *a = NULL;
+	const gchar *lang = NULL;
 	const gchar *str;
+	guint32 idx = XB_SILO_UNSET;
+	guint32 lang_idx = XB_SILO_UNSET;
 	g_auto(XbOpcode) op = XB_OPCODE_INIT();
 
+	/* optimize pass: the literal has to be stemmed the same way as the text
+	 * it is compared to, which is only known ahead of time with no languages */
+	if (query_data == NULL && xb_silo_has_lang(silo)) {
+		if (error != NULL)
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_FAILED_HANDLED,
+					    "cannot optimize: no node language");
+		return FALSE;
+	}
+
 	head = _xb_stack_peek_head(stack);
 	if (head == NULL || !xb_opcode_cmp_str(head)) {
 		if (error != NULL)
@@ -1340,9 +1842,142 @@ xb_silo_machine_func_stem_cb(XbMachine *self,
 	if (!xb_machine_stack_pop(self, stack, &op, error))
 		return FALSE;
 
+	/* use the language of the node if there is one */
+	if (query_data != NULL)
+		a = xb_silo_get_node_attr_by_str(silo, query_data->sn, "xml:lang");
+	if (a != NULL) {
+		lang_idx = a->attr_value;
+		lang = xb_silo_from_strtab(silo, lang_idx);
+	}
+
+	/* use the precomputed string from the strtab */
+	if (xb_opcode_get_kind(&op) == XB_OPCODE_KIND_INDEXED_TEXT &&
+	    xb_opcode_get_val(&op) != XB_SILO_UNSET)
+		idx = xb_silo_strtab_stem(silo, xb_opcode_get_val(&op), lang_idx);
+	if (idx != XB_SILO_UNSET) {
+		if (!xb_machine_stack_push(self, stack, &op_tmp, error))
+			return FALSE;
+		xb_opcode_init(op_tmp,
+			       XB_OPCODE_KIND_INDEXED_TEXT,
+			       xb_silo_from_strtab(silo, idx),
+			       idx,
+			       NULL);
+		return TRUE;
+	}
+
 	/* TEXT */
 	str = xb_opcode_get_str(&op);
-	return xb_machine_stack_push_text_steal(self, stack, xb_silo_stem(silo, str), error);
+	return xb_machine_stack_push_text_steal(self, stack, xb_string_stem(str, lang), error);
+}
+
+/* returns XB_SILO_UNSET if the silo was not built with XB_BUILDER_COMPILE_FLAG_CASEFOLD */
+static guint32
+xb_silo_strtab_casefold(XbSilo *self, XbSiloSectionKind kind, guint32 idx)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	const XbSiloStrtabFold *folds = priv->sections[kind];
+	gsize lo = 0;
+	gsize hi = priv->sections_sz[kind] / sizeof(XbSiloStrtabFold);
+
+	if (folds == NULL)
+		return XB_SILO_UNSET;
+	while (lo < hi) {
+		gsize mid = lo + (hi - lo) / 2;
+		if (folds[mid].idx == idx)
+			return folds[mid].idx_folded;
+		if (folds[mid].idx < idx)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	/* not changed when folded */
+	return idx;
+}
+
+static gboolean
+xb_silo_machine_func_casefold(XbMachine *self,
+			      XbStack *stack,
+			      XbSilo *silo,
+			      XbSiloSectionKind kind,
+			      GError **error)
+{
+	XbOpcode *head = _xb_stack_peek_head(stack);
+	XbOpcode *op_tmp;
+	guint32 idx = XB_SILO_UNSET;
+	g_auto(XbOpcode) op = XB_OPCODE_INIT();
+
+	if (head == NULL || !xb_opcode_cmp_str(head)) {
+		if (error != NULL)
+			g_set_error(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_NOT_SUPPORTED,
+				    "%s type not supported",
+				    (head != NULL) ? xb_opcode_kind_to_string(xb_opcode_get_kind(head))
+						   : "(null)");
+		return FALSE;
+	}
+	if (!xb_machine_stack_pop(self, stack, &op, error))
+		return FALSE;
+
+	/* use the precomputed string from the strtab */
+	if (xb_opcode_get_kind(&op) == XB_OPCODE_KIND_INDEXED_TEXT &&
+	    xb_opcode_get_val(&op) != XB_SILO_UNSET)
+		idx = xb_silo_strtab_casefold(silo, kind, xb_opcode_get_val(&op));
+	if (idx != XB_SILO_UNSET) {
+		if (!xb_machine_stack_push(self, stack, &op_tmp, error))
+			return FALSE;
+		xb_opcode_init(op_tmp,
+			       XB_OPCODE_KIND_INDEXED_TEXT,
+			       xb_silo_from_strtab(silo, idx),
+			       idx,
+			       NULL);
+		return TRUE;
+	}
+
+	/* TEXT */
+	if (kind == XB_SILO_SECTION_KIND_STRTAB_LOWER) {
+		return xb_machine_stack_push_text_steal(self,
+							stack,
+							g_utf8_strdown(xb_opcode_get_str(&op), -1),
+							error);
+	}
+	return xb_machine_stack_push_text_steal(self,
+						stack,
+						g_utf8_strup(xb_opcode_get_str(&op), -1),
+						error);
+}
+
+static gboolean
+xb_silo_machine_func_lower_cb(XbMachine *self,
+			      XbStack *stack,
+			      gboolean *result,
+			      gpointer user_data,
+			      gpointer exec_data,
+			      GError **error)
+{
+	XbSilo *silo = XB_SILO(user_data);
+	return xb_silo_machine_func_casefold(self,
+					     stack,
+					     silo,
+					     XB_SILO_SECTION_KIND_STRTAB_LOWER,
+					     error);
+}
+
+static gboolean
+xb_silo_machine_func_upper_cb(XbMachine *self,
+			      XbStack *stack,
+			      gboolean *result,
+			      gpointer user_data,
+			      gpointer exec_data,
+			      GError **error)
+{
+	XbSilo *silo = XB_SILO(user_data);
+	return xb_silo_machine_func_casefold(self,
+					     stack,
+					     silo,
+					     XB_SILO_SECTION_KIND_STRTAB_UPPER,
+					     error);
 }
 
 static gboolean
@@ -1373,7 +2008,7 @@ xb_silo_machine_func_text_cb(XbMachine *self,
 	xb_opcode_init(op,
 		       XB_OPCODE_KIND_INDEXED_TEXT,
 		       xb_silo_get_node_text(silo, query_data->sn),
-		       xb_silo_node_get_text_idx(query_data->sn),
+		       xb_silo_get_node_text_idx(silo, query_data->sn),
 		       NULL);
 
 	/* use the fast token path even if there are no valid tokens */
@@ -1383,7 +2018,9 @@ xb_silo_machine_func_text_cb(XbMachine *self,
 	/* add tokens */
 	token_count = xb_silo_node_get_token_count(query_data->sn);
 	for (guint i = 0; i < token_count; i++) {
-		guint32 stridx = xb_silo_node_get_token_idx(query_data->sn, i);
+		guint32 stridx = xb_silo_get_node_token_idx(silo, query_data->sn, i);
+		if (stridx == XB_SILO_UNSET)
+			continue;
 		xb_opcode_append_token(op, xb_silo_from_strtab(silo, stridx));
 	}
 
@@ -1417,7 +2054,7 @@ xb_silo_machine_func_tail_cb(XbMachine *self,
 	xb_opcode_init(op,
 		       XB_OPCODE_KIND_INDEXED_TEXT,
 		       xb_silo_get_node_tail(silo, query_data->sn),
-		       xb_silo_node_get_tail_idx(query_data->sn),
+		       xb_silo_get_node_tail_idx(silo, query_data->sn),
 		       NULL);
 	return TRUE;
 }
@@ -1452,6 +2089,7 @@ xb_silo_machine_func_last_cb(XbMachine *self,
 			     gpointer exec_data,
 			     GError **error)
 {
+	XbSilo *silo = XB_SILO(user_data);
 	XbSiloQueryData *query_data = (XbSiloQueryData *)exec_data;
 
 	/* optimize pass */
@@ -1463,7 +2101,9 @@ xb_silo_machine_func_last_cb(XbMachine *self,
 					    "cannot optimize: no silo to query");
 		return FALSE;
 	}
-	return _xb_stack_push_bool(stack, query_data->sn->next == 0, error);
+	return _xb_stack_push_bool(stack,
+				   xb_silo_get_next_node(silo, query_data->sn) == NULL,
+				   error);
 }
 
 static gboolean
@@ -1551,6 +2191,503 @@ xb_silo_machine_func_search_cb(XbMachine *self,
 	return _xb_stack_push_bool(stack, xb_string_search(text, search), error);
 }
 
+static gboolean
+xb_silo_uint32_bsearch(const guint32 *vals, gsize len, guint32 val)
+{
+	gsize lo = 0;
+	gsize hi = len;
+
+	while (lo < hi) {
+		gsize mid = lo + (hi - lo) / 2;
+		if (vals[mid] == val)
+			return TRUE;
+		if (vals[mid] < val)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return FALSE;
+}
+
+static const XbSiloTrigrams *
+xb_silo_trigrams_lookup(XbSilo *self, guint32 trigram)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	const XbSiloTrigrams *trigrams = priv->sections[XB_SILO_SECTION_KIND_TRIGRAMS_IDX];
+	gsize lo = 0;
+	gsize hi = priv->sections_sz[XB_SILO_SECTION_KIND_TRIGRAMS_IDX] / sizeof(XbSiloTrigrams);
+
+	while (lo < hi) {
+		gsize mid = lo + (hi - lo) / 2;
+		if (trigrams[mid].trigram == trigram)
+			return &trigrams[mid];
+		if (trigrams[mid].trigram < trigram)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return NULL;
+}
+
+static gint
+xb_silo_trigrams_count_cmp(gconstpointer a, gconstpointer b)
+{
+	const XbSiloTrigrams *tg1 = *((const XbSiloTrigrams **)a);
+	const XbSiloTrigrams *tg2 = *((const XbSiloTrigrams **)b);
+	if (tg1->count < tg2->count)
+		return -1;
+	if (tg1->count > tg2->count)
+		return 1;
+	return 0;
+}
+
+/* returns the sorted strtab offsets of the indexed strings that have every
+ * trigram of @search, or %NULL if @search cannot be checked using the index */
+static GArray *
+xb_silo_trigrams_intersect(XbSilo *self, const gchar *search)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	const guint32 *postings = priv->sections[XB_SILO_SECTION_KIND_TRIGRAMS];
+	gsize postings_len = priv->sections_sz[XB_SILO_SECTION_KIND_TRIGRAMS] / sizeof(guint32);
+	const guchar *str = (const guchar *)search;
+	const XbSiloTrigrams *tg0;
+	GArray *candidates;
+	g_autoptr(GPtrArray) tgs = g_ptr_array_new();
+
+	if (postings == NULL || priv->sections[XB_SILO_SECTION_KIND_TRIGRAMS_IDX] == NULL)
+		return NULL;
+	for (gsize i = 0; str[i] != '\0' && str[i + 1] != '\0' && str[i + 2] != '\0'; i++) {
+		guint32 trigram = ((guint32)str[i] << 16) | ((guint32)str[i + 1] << 8) |
+				  (guint32)str[i + 2];
+		const XbSiloTrigrams *tg = xb_silo_trigrams_lookup(self, trigram);
+		if (tg == NULL)
+			return g_array_new(FALSE, FALSE, sizeof(guint32));
+		if (tg->idx > postings_len || tg->count > postings_len - tg->idx) {
+			g_critical("trigram 0x%06x postings out of range", trigram);
+			return NULL;
+		}
+		g_ptr_array_add(tgs, (gpointer)tg);
+	}
+	if (tgs->len == 0)
+		return NULL;
+
+	/* start with the shortest postings list as nothing else can be added */
+	g_ptr_array_sort(tgs, xb_silo_trigrams_count_cmp);
+	tg0 = g_ptr_array_index(tgs, 0);
+	candidates = g_array_sized_new(FALSE, FALSE, sizeof(guint32), tg0->count);
+	for (guint32 j = 0; j < tg0->count; j++) {
+		guint32 idx = postings[tg0->idx + j];
+		guint i;
+		for (i = 1; i < tgs->len; i++) {
+			const XbSiloTrigrams *tg = g_ptr_array_index(tgs, i);
+			if (!xb_silo_uint32_bsearch(postings + tg->idx, tg->count, idx))
+				break;
+		}
+		if (i == tgs->len)
+			g_array_append_val(candidates, idx);
+	}
+	return candidates;
+}
+
+/* private */
+void
+xb_silo_query_data_clear(XbSiloQueryData *self)
+{
+	for (guint i = 0; i < XB_SILO_QUERY_DATA_TRIGRAMS_MAX; i++) {
+		self->trigrams_search[i] = NULL;
+		g_clear_pointer(&self->trigrams_candidates[i], g_array_unref);
+	}
+}
+
+/* returns TRUE if the indexed string at @idx cannot possibly contain @search,
+ * and FALSE if it might -- or if the string was not indexed at all; @search has
+ * to stay valid for the whole query as the postings are only intersected once */
+static gboolean
+xb_silo_trigrams_excludes(XbSilo *self,
+			  XbSiloQueryData *query_data,
+			  guint32 idx,
+			  const gchar *search)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	const guint32 *strs = priv->sections[XB_SILO_SECTION_KIND_TRIGRAMS_STRS];
+	GArray *candidates;
+	guint i;
+
+	if (strs == NULL || search == NULL)
+		return FALSE;
+	if (search[0] == '\0' || search[1] == '\0' || search[2] == '\0')
+		return FALSE;
+	if (!xb_silo_uint32_bsearch(strs,
+				    priv->sections_sz[XB_SILO_SECTION_KIND_TRIGRAMS_STRS] /
+					sizeof(guint32),
+				    idx))
+		return FALSE;
+
+	/* every trigram of the needle has to be found in the haystack; a needle
+	 * that changes for each node is not worth intersecting the postings for */
+	for (i = 0; i < XB_SILO_QUERY_DATA_TRIGRAMS_MAX; i++) {
+		if (query_data->trigrams_search[i] == search)
+			break;
+		if (query_data->trigrams_search[i] == NULL) {
+			candidates = xb_silo_trigrams_intersect(self, search);
+			query_data->trigrams_search[i] = search;
+			query_data->trigrams_candidates[i] = candidates;
+			break;
+		}
+	}
+	if (i == XB_SILO_QUERY_DATA_TRIGRAMS_MAX)
+		return FALSE;
+	candidates = query_data->trigrams_candidates[i];
+	if (candidates == NULL)
+		return FALSE;
+	return !xb_silo_uint32_bsearch((const guint32 *)candidates->data, candidates->len, idx);
+}
+
+/* overrides the XbMachine implementation so that indexed text can be
+ * rejected without comparing the strings */
+static gboolean
+xb_silo_machine_func_contains_cb(XbMachine *self,
+				 XbStack *stack,
+				 gboolean *result,
+				 gpointer user_data,
+				 gpointer exec_data,
+				 GError **error)
+{
+	XbSilo *silo = XB_SILO(user_data);
+	XbSiloQueryData *query_data = (XbSiloQueryData *)exec_data;
+	guint stack_size = _xb_stack_get_size(stack);
+
+	/* INDX:TEXT, where the needle is not owned by the stack and so stays
+	 * valid for the whole query */
+	if (query_data != NULL && stack_size >= 2) {
+		XbOpcode *head1 = _xb_stack_peek(stack, stack_size - 1);
+		XbOpcode *head2 = _xb_stack_peek(stack, stack_size - 2);
+		if (xb_opcode_cmp_str(head1) && head1->destroy_func == NULL &&
+		    xb_opcode_get_kind(head2) == XB_OPCODE_KIND_INDEXED_TEXT &&
+		    xb_opcode_get_val(head2) != XB_SILO_UNSET &&
+		    xb_silo_trigrams_excludes(silo,
+					      query_data,
+					      xb_opcode_get_val(head2),
+					      xb_opcode_get_str(head1))) {
+			g_auto(XbOpcode) op1 = XB_OPCODE_INIT();
+			g_auto(XbOpcode) op2 = XB_OPCODE_INIT();
+			if (!xb_machine_stack_pop_two(self, stack, &op1, &op2, error))
+				return FALSE;
+			return _xb_stack_push_bool(stack, FALSE, error);
+		}
+	}
+
+	/* the type checks and TEXT:TEXT are the same as XbMachine */
+	return xb_machine_func_contains_cb(self, stack, result, NULL, exec_data, error);
+}
+
+/* the same result as `'type',attr(),'desktop',eq()` without creating the
+ * intermediate opcode, comparing the string table offset where possible */
+static gboolean
+xb_silo_node_attr_eq(XbSilo *self,
+		     XbSiloNode *sn,
+		     const XbOpcode *op_name,
+		     const XbOpcode *op_value)
+{
+	XbSiloNodeAttr *a;
+
+	if (_xb_opcode_get_kind(op_name) == XB_OPCODE_KIND_INDEXED_TEXT)
+		a = xb_silo_node_get_attr_by_val(self, sn, _xb_opcode_get_val(op_name));
+	else
+		a = xb_silo_get_node_attr_by_str(self, sn, _xb_opcode_get_str(op_name));
+	if (a == NULL)
+		return _xb_opcode_get_str(op_value) == NULL;
+	if (_xb_opcode_get_kind(op_value) == XB_OPCODE_KIND_INDEXED_TEXT)
+		return a->attr_value == _xb_opcode_get_val(op_value);
+	return g_strcmp0(xb_silo_from_strtab(self, a->attr_value), _xb_opcode_get_str(op_value)) ==
+	       0;
+}
+
+/* `'type','desktop',attr-eq()`, as created by xb_silo_machine_fixup_attr_eq_cb() */
+static gboolean
+xb_silo_machine_func_attr_eq_cb(XbMachine *self,
+				XbStack *stack,
+				gboolean *result,
+				gpointer user_data,
+				gpointer exec_data,
+				GError **error)
+{
+	XbSilo *silo = XB_SILO(user_data);
+	XbSiloQueryData *query_data = (XbSiloQueryData *)exec_data;
+	XbOpcode *op_name;
+	XbOpcode *op_value;
+	gboolean ret;
+
+	/* optimize pass */
+	if (query_data == NULL) {
+		if (error != NULL)
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_FAILED_HANDLED,
+					    "cannot optimize: no silo to query");
+		return FALSE;
+	}
+
+	/* compare in place rather than popping both opcodes */
+	op_name = _xb_stack_peek(stack, _xb_stack_get_size(stack) - 2);
+	op_value = _xb_stack_peek_tail(stack);
+	if (op_name == NULL || op_value == NULL || !_xb_opcode_cmp_str(op_name) ||
+	    !_xb_opcode_cmp_str(op_value)) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_NOT_SUPPORTED,
+				    "attr-eq() requires two strings");
+		return FALSE;
+	}
+	ret = xb_silo_node_attr_eq(silo, query_data->sn, op_name, op_value);
+	_xb_opcode_clear(op_name);
+	_xb_opcode_clear(op_value);
+	if (!_xb_stack_pop_two(stack, NULL, NULL, error))
+		return FALSE;
+	return _xb_stack_push_bool(stack, ret, error);
+}
+
+/* looks up the value stored for the string at @idx in a section of
+ * XbSiloStrtabNumeric, returning %FALSE if there is none */
+static gboolean
+xb_silo_strtab_lookup_val(XbSilo *self, XbSiloSectionKind kind, guint32 idx, guint64 *val)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	const XbSiloStrtabNumeric *numbers = priv->sections[kind];
+	gsize lo = 0;
+	gsize hi = priv->sections_sz[kind] / sizeof(XbSiloStrtabNumeric);
+
+	while (lo < hi) {
+		gsize mid = lo + (hi - lo) / 2;
+		if (numbers[mid].idx == idx) {
+			*val = numbers[mid].val;
+			return TRUE;
+		}
+		if (numbers[mid].idx < idx)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return FALSE;
+}
+
+/* uses the value parsed when the silo was built with
+ * XB_BUILDER_COMPILE_FLAG_NUMERIC, falling back to parsing the string */
+static gboolean
+xb_silo_strtab_get_number(XbSilo *self, guint32 idx, guint64 *val)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+
+	if (idx == XB_SILO_UNSET)
+		return FALSE;
+	if (priv->sections[XB_SILO_SECTION_KIND_STRTAB_NUMERIC] == NULL) {
+		return g_ascii_string_to_unsigned(xb_silo_from_strtab(self, idx),
+						  10,
+						  0,
+						  G_MAXUINT64,
+						  val,
+						  NULL);
+	}
+	return xb_silo_strtab_lookup_val(self, XB_SILO_SECTION_KIND_STRTAB_NUMERIC, idx, val);
+}
+
+/* pushes the string at @idx as an integer, or a NULL string if it is not a
+ * number so that the comparison fails rather than the query */
+static gboolean
+xb_silo_machine_push_number(XbMachine *self,
+			    XbStack *stack,
+			    XbSilo *silo,
+			    guint32 idx,
+			    GError **error)
+{
+	guint64 val = 0;
+
+	if (!xb_silo_strtab_get_number(silo, idx, &val))
+		return xb_machine_stack_push_text_static(self, stack, NULL, error);
+	return xb_machine_stack_push_integer64(self, stack, val, error);
+}
+
+/* `'priority',attr-number()`, as created by xb_silo_machine_fixup_number_cb() */
+static gboolean
+xb_silo_machine_func_attr_number_cb(XbMachine *self,
+				    XbStack *stack,
+				    gboolean *result,
+				    gpointer user_data,
+				    gpointer exec_data,
+				    GError **error)
+{
+	XbSiloNodeAttr *a;
+	XbSilo *silo = XB_SILO(user_data);
+	XbSiloQueryData *query_data = (XbSiloQueryData *)exec_data;
+	g_auto(XbOpcode) op = XB_OPCODE_INIT();
+
+	/* optimize pass */
+	if (query_data == NULL) {
+		if (error != NULL)
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_FAILED_HANDLED,
+					    "cannot optimize: no silo to query");
+		return FALSE;
+	}
+
+	if (!xb_machine_stack_pop(self, stack, &op, error))
+		return FALSE;
+	if (!_xb_opcode_cmp_str(&op)) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_NOT_SUPPORTED,
+				    "attr-number() requires a string");
+		return FALSE;
+	}
+	if (xb_opcode_get_kind(&op) == XB_OPCODE_KIND_INDEXED_TEXT)
+		a = xb_silo_node_get_attr_by_val(silo, query_data->sn, xb_opcode_get_val(&op));
+	else
+		a = xb_silo_get_node_attr_by_str(silo, query_data->sn, xb_opcode_get_str(&op));
+	if (a == NULL)
+		return xb_machine_stack_push_text_static(self, stack, NULL, error);
+	return xb_silo_machine_push_number(self, stack, silo, a->attr_value, error);
+}
+
+/* `text-number()`, as created by xb_silo_machine_fixup_number_cb() */
+static gboolean
+xb_silo_machine_func_text_number_cb(XbMachine *self,
+				    XbStack *stack,
+				    gboolean *result,
+				    gpointer user_data,
+				    gpointer exec_data,
+				    GError **error)
+{
+	XbSilo *silo = XB_SILO(user_data);
+	XbSiloQueryData *query_data = (XbSiloQueryData *)exec_data;
+
+	/* optimize pass */
+	if (query_data == NULL) {
+		if (error != NULL)
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_FAILED_HANDLED,
+					    "cannot optimize: no silo to query");
+		return FALSE;
+	}
+	return xb_silo_machine_push_number(self,
+					   stack,
+					   silo,
+					   xb_silo_get_node_text_idx(silo, query_data->sn),
+					   error);
+}
+
+/* uses the key computed when the silo was built with
+ * XB_BUILDER_COMPILE_FLAG_VERSION_KEYS, or for a literal */
+static gboolean
+xb_silo_opcode_get_version_key(XbSilo *self, XbOpcode *op, guint64 *key)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+
+	if (priv->sections[XB_SILO_SECTION_KIND_STRTAB_VERSION] == NULL)
+		return FALSE;
+	if (_xb_opcode_get_kind(op) == XB_OPCODE_KIND_INDEXED_TEXT) {
+		return xb_silo_strtab_lookup_val(self,
+						 XB_SILO_SECTION_KIND_STRTAB_VERSION,
+						 _xb_opcode_get_val(op),
+						 key);
+	}
+	return xb_string_version_key(_xb_opcode_get_str(op), key);
+}
+
+/* `'version',attr(),'>=','1.2.3',vercmp()` */
+static gboolean
+xb_silo_machine_func_vercmp_cb(XbMachine *self,
+			       XbStack *stack,
+			       gboolean *result,
+			       gpointer user_data,
+			       gpointer exec_data,
+			       GError **error)
+{
+	XbSilo *silo = XB_SILO(user_data);
+	const gchar *cmp;
+	gint rc;
+	guint64 key1 = 0;
+	guint64 key2 = 0;
+	g_auto(XbOpcode) op1 = XB_OPCODE_INIT();
+	g_auto(XbOpcode) op2 = XB_OPCODE_INIT();
+	g_auto(XbOpcode) op3 = XB_OPCODE_INIT();
+
+	if (!xb_machine_stack_pop(self, stack, &op3, error))
+		return FALSE;
+	if (!xb_machine_stack_pop(self, stack, &op2, error))
+		return FALSE;
+	if (!xb_machine_stack_pop(self, stack, &op1, error))
+		return FALSE;
+	if (!_xb_opcode_cmp_str(&op1) || !_xb_opcode_cmp_str(&op2) || !_xb_opcode_cmp_str(&op3)) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_NOT_SUPPORTED,
+				    "vercmp() requires three strings");
+		return FALSE;
+	}
+
+	/* a missing attribute or text never matches */
+	if (_xb_opcode_get_str(&op1) == NULL || _xb_opcode_get_str(&op3) == NULL)
+		return _xb_stack_push_bool(stack, FALSE, error);
+
+	/* compare the precomputed keys if possible */
+	if (xb_silo_opcode_get_version_key(silo, &op1, &key1) &&
+	    xb_silo_opcode_get_version_key(silo, &op3, &key2)) {
+		rc = key1 < key2 ? -1 : key1 > key2 ? 1 : 0;
+	} else {
+		rc = xb_string_vercmp(_xb_opcode_get_str(&op1), _xb_opcode_get_str(&op3));
+	}
+
+	cmp = _xb_opcode_get_str(&op2);
+	if (g_strcmp0(cmp, "=") == 0 || g_strcmp0(cmp, "eq") == 0)
+		return _xb_stack_push_bool(stack, rc == 0, error);
+	if (g_strcmp0(cmp, "!=") == 0 || g_strcmp0(cmp, "ne") == 0)
+		return _xb_stack_push_bool(stack, rc != 0, error);
+	if (g_strcmp0(cmp, "<") == 0 || g_strcmp0(cmp, "lt") == 0)
+		return _xb_stack_push_bool(stack, rc < 0, error);
+	if (g_strcmp0(cmp, "<=") == 0 || g_strcmp0(cmp, "le") == 0)
+		return _xb_stack_push_bool(stack, rc <= 0, error);
+	if (g_strcmp0(cmp, ">") == 0 || g_strcmp0(cmp, "gt") == 0)
+		return _xb_stack_push_bool(stack, rc > 0, error);
+	if (g_strcmp0(cmp, ">=") == 0 || g_strcmp0(cmp, "ge") == 0)
+		return _xb_stack_push_bool(stack, rc >= 0, error);
+	g_set_error(error,
+		    G_IO_ERROR,
+		    G_IO_ERROR_NOT_SUPPORTED,
+		    "vercmp() comparison %s not supported",
+		    cmp);
+	return FALSE;
+}
+
+/* compiled `text(),'gimp.desktop',eq()`, matching xb_machine_func_eq_cb() */
+static gboolean
+xb_silo_machine_fusion_text_eq_cb(XbMachine *self,
+				  XbStack *stack,
+				  const XbOpcode *opcodes,
+				  gpointer user_data,
+				  gpointer exec_data,
+				  GError **error)
+{
+	XbSilo *silo = XB_SILO(user_data);
+	XbSiloQueryData *query_data = (XbSiloQueryData *)exec_data;
+	const XbOpcode *op_value = &opcodes[1];
+
+	if (query_data == NULL) {
+		g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_FAILED, "no silo to query");
+		return FALSE;
+	}
+	if (_xb_opcode_get_kind(op_value) == XB_OPCODE_KIND_INDEXED_TEXT)
+		return _xb_stack_push_bool(stack,
+					   xb_silo_get_node_text_idx(silo, query_data->sn) ==
+					       _xb_opcode_get_val(op_value),
+					   error);
+	return _xb_stack_push_bool(stack,
+				   g_strcmp0(xb_silo_get_node_text(silo, query_data->sn),
+					     _xb_opcode_get_str(op_value)) == 0,
+				   error);
+}
+
 static gboolean
 xb_silo_machine_fixup_attr_text_cb(XbMachine *self,
 				   XbStack *opcodes,
@@ -1645,6 +2782,8 @@ static void
 xb_silo_init(XbSilo *self)
 {
 	XbSiloPrivate *priv = GET_PRIVATE(self);
+	const gchar *text_eq_sigs[] = {"FUNC:text,TEXT,FUNC:eq", "FUNC:text,TEXI,FUNC:eq", NULL};
+	const gchar *number_cmps[] = {"eq", "ne", "lt", "gt", "le", "ge", NULL};
 
 	priv->file_monitors = g_hash_table_new_full(g_file_hash,
 						    (GEqualFunc)g_file_equal,
@@ -1656,6 +2795,7 @@ xb_silo_init(XbSilo *self)
 	priv->strindex = g_hash_table_new(g_str_hash, g_str_equal);
 	priv->profile_str = g_string_new(NULL);
 	priv->query_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_object_unref);
+	priv->has_lang = -1;
 	g_rw_lock_init(&priv->query_cache_mutex);
 
 	priv->nodes = NULL; /* initialised when first used */
@@ -1663,30 +2803,80 @@ xb_silo_init(XbSilo *self)
 
 	priv->context = g_main_context_ref_thread_default();
 
-#ifdef HAVE_LIBSTEMMER
-	g_mutex_init(&priv->stemmer_mutex);
-#endif
-
 	priv->machine = xb_machine_new();
-	xb_machine_add_method(priv->machine, "attr", 1, xb_silo_machine_func_attr_cb, self, NULL);
-	xb_machine_add_method(priv->machine, "stem", 1, xb_silo_machine_func_stem_cb, self, NULL);
-	xb_machine_add_method(priv->machine, "text", 0, xb_silo_machine_func_text_cb, self, NULL);
-	xb_machine_add_method(priv->machine, "tail", 0, xb_silo_machine_func_tail_cb, self, NULL);
-	xb_machine_add_method(priv->machine, "first", 0, xb_silo_machine_func_first_cb, self, NULL);
-	xb_machine_add_method(priv->machine, "last", 0, xb_silo_machine_func_last_cb, self, NULL);
-	xb_machine_add_method(priv->machine,
-			      "position",
-			      0,
-			      xb_silo_machine_func_position_cb,
-			      self,
-			      NULL);
-	xb_machine_add_method(priv->machine,
-			      "search",
-			      2,
-			      xb_silo_machine_func_search_cb,
-			      self,
-			      NULL);
+	xb_machine_add_method_fixed(priv->machine,
+				    "attr",
+				    1,
+				    xb_silo_machine_func_attr_cb,
+				    self,
+				    NULL);
+	xb_machine_add_method_fixed(priv->machine,
+				    "attr-eq",
+				    2,
+				    xb_silo_machine_func_attr_eq_cb,
+				    self,
+				    NULL);
+	xb_machine_add_method_fixed(priv->machine,
+				    "stem",
+				    1,
+				    xb_silo_machine_func_stem_cb,
+				    self,
+				    NULL);
+	xb_machine_add_method_fixed(priv->machine,
+				    "text",
+				    0,
+				    xb_silo_machine_func_text_cb,
+				    self,
+				    NULL);
+	xb_machine_add_method_fixed(priv->machine,
+				    "tail",
+				    0,
+				    xb_silo_machine_func_tail_cb,
+				    self,
+				    NULL);
+	xb_machine_add_method_fixed(priv->machine,
+				    "first",
+				    0,
+				    xb_silo_machine_func_first_cb,
+				    self,
+				    NULL);
+	xb_machine_add_method_fixed(priv->machine,
+				    "last",
+				    0,
+				    xb_silo_machine_func_last_cb,
+				    self,
+				    NULL);
+	xb_machine_override_method_fixed(priv->machine,
+					 "lower-case",
+					 1,
+					 xb_silo_machine_func_lower_cb,
+					 self,
+					 NULL);
+	xb_machine_override_method_fixed(priv->machine,
+					 "upper-case",
+					 1,
+					 xb_silo_machine_func_upper_cb,
+					 self,
+					 NULL);
+	xb_machine_add_method_fixed(priv->machine,
+				    "position",
+				    0,
+				    xb_silo_machine_func_position_cb,
+				    self,
+				    NULL);
+	xb_machine_add_method_fixed(priv->machine,
+				    "search",
+				    2,
+				    xb_silo_machine_func_search_cb,
+				    self,
+				    NULL);
 	xb_machine_add_operator(priv->machine, "~=", "search");
+	xb_machine_override_method_fixed(priv->machine,
+					 "contains",
+					 2,
+					 xb_silo_machine_func_contains_cb,
+					 self,
+					 NULL);
 	xb_machine_add_opcode_fixup(priv->machine,
 				    "INTE",
 				    xb_silo_machine_fixup_position_cb,
@@ -1697,12 +2887,57 @@ xb_silo_init(XbSilo *self)
 				    xb_silo_machine_fixup_attr_exists_cb,
 				    self,
 				    NULL);
+	xb_machine_add_opcode_fixup(priv->machine,
+				    "TEXT,FUNC:attr,TEXT,FUNC:eq",
+				    xb_silo_machine_fixup_attr_eq_cb,
+				    self,
+				    NULL);
 	xb_machine_add_opcode_fixup(priv->machine,
 				    "FUNC:text,TEXT,FUNC:search",
 				    xb_silo_machine_fixup_attr_search_token_cb,
 				    self,
 				    NULL);
+	xb_machine_add_method_fixed(priv->machine,
+				    "vercmp",
+				    3,
+				    xb_silo_machine_func_vercmp_cb,
+				    self,
+				    NULL);
+	xb_machine_add_method_fixed(priv->machine,
+				    "attr-number",
+				    1,
+				    xb_silo_machine_func_attr_number_cb,
+				    self,
+				    NULL);
+	xb_machine_add_method_fixed(priv->machine,
+				    "text-number",
+				    0,
+				    xb_silo_machine_func_text_number_cb,
+				    self,
+				    NULL);
+	for (guint i = 0; number_cmps[i] != NULL; i++) {
+		g_autofree gchar *attr_sig =
+		    g_strdup_printf("TEXT,FUNC:attr,INTE,FUNC:%s", number_cmps[i]);
+		g_autofree gchar *text_sig =
+		    g_strdup_printf("FUNC:text,INTE,FUNC:%s", number_cmps[i]);
+		xb_machine_add_opcode_fixup(priv->machine,
+					    attr_sig,
+					    xb_silo_machine_fixup_number_cb,
+					    self,
+					    NULL);
+		xb_machine_add_opcode_fixup(priv->machine,
+					    text_sig,
+					    xb_silo_machine_fixup_number_cb,
+					    self,
+					    NULL);
+	}
 	xb_machine_add_text_handler(priv->machine, xb_silo_machine_fixup_attr_text_cb, self, NULL);
+	for (guint i = 0; text_eq_sigs[i] != NULL; i++) {
+		xb_machine_add_opcode_fusion(priv->machine,
+					     text_eq_sigs[i],
+					     xb_silo_machine_fusion_text_eq_cb,
+					     self);
+	}
 }
 
 static void
@@ -1714,12 +2949,6 @@ xb_silo_finalize(GObject *obj)
 	g_clear_pointer(&priv->nodes, g_hash_table_unref);
 	g_mutex_clear(&priv->nodes_mutex);
 
-#ifdef HAVE_LIBSTEMMER
-	if (priv->stemmer_ctx != NULL)
-		sb_stemmer_delete(priv->stemmer_ctx);
-	g_mutex_clear(&priv->stemmer_mutex);
-#endif
-
 	g_clear_pointer(&priv->context, g_main_context_unref);
 
 	g_free(priv->guid);
@@ -26,6 +26,12 @@ gchar *
 xb_string_xml_escape(const gchar *str);
 gboolean
 xb_string_isspace(const gchar *str, gssize strsz);
+gint
+xb_string_vercmp(const gchar *version1, const gchar *version2);
+gboolean
+xb_string_version_key(const gchar *version, guint64 *key);
+gchar *
+xb_string_stem(const gchar *value, const gchar *lang);
 
 typedef struct __attribute__((packed)) {
 	guint32 tlo;
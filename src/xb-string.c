@@ -11,6 +11,10 @@
 #include <gio/gio.h>
 #include <string.h>
 
+#ifdef HAVE_LIBSTEMMER
+#include <libstemmer.h>
+#endif
+
 #include "xb-string-private.h"
 
 /**
@@ -281,6 +285,237 @@ xb_string_isspace(const gchar *str, gssize strsz)
 	return TRUE;
 }
 
+/* returns the epoch, e.g. 2 for `2:1.2.3`, and moves @str past it */
+static guint64
+xb_string_version_epoch(const gchar **str)
+{
+	guint64 epoch = 0;
+	const gchar *tmp = *str;
+
+	while (g_ascii_isdigit(*tmp)) {
+		epoch = epoch * 10 + (*tmp - '0');
+		tmp++;
+	}
+	if (tmp == *str || *tmp != ':')
+		return 0;
+	*str = tmp + 1;
+	return epoch;
+}
+
+/* private: compares two versions like rpmvercmp(), with an optional epoch;
+ * numeric segments are compared as numbers, a numeric segment is newer than
+ * an alpha one, and a `~` sorts before anything else, e.g. `1.2~rc1` */
+gint
+xb_string_vercmp(const gchar *version1, const gchar *version2)
+{
+	const gchar *one = version1;
+	const gchar *two = version2;
+	guint64 epoch1;
+	guint64 epoch2;
+
+	if (g_strcmp0(version1, version2) == 0)
+		return 0;
+	if (version1 == NULL)
+		return -1;
+	if (version2 == NULL)
+		return 1;
+
+	/* epoch */
+	epoch1 = xb_string_version_epoch(&one);
+	epoch2 = xb_string_version_epoch(&two);
+	if (epoch1 != epoch2)
+		return epoch1 < epoch2 ? -1 : 1;
+
+	while (*one != '\0' || *two != '\0') {
+		const gchar *str1;
+		const gchar *str2;
+		gboolean isnum;
+		gsize len1;
+		gsize len2;
+		gint rc;
+
+		/* skip separators */
+		while (*one != '\0' && !g_ascii_isalnum(*one) && *one != '~')
+			one++;
+		while (*two != '\0' && !g_ascii_isalnum(*two) && *two != '~')
+			two++;
+
+		/* pre-release */
+		if (*one == '~' || *two == '~') {
+			if (*one != '~')
+				return 1;
+			if (*two != '~')
+				return -1;
+			one++;
+			two++;
+			continue;
+		}
+		if (*one == '\0' || *two == '\0')
+			break;
+
+		/* get the next segment of the same kind */
+		str1 = one;
+		str2 = two;
+		isnum = g_ascii_isdigit(*str1);
+		if (isnum) {
+			while (g_ascii_isdigit(*str1))
+				str1++;
+			while (g_ascii_isdigit(*str2))
+				str2++;
+		} else {
+			while (g_ascii_isalpha(*str1))
+				str1++;
+			while (g_ascii_isalpha(*str2))
+				str2++;
+		}
+
+		/* segments of a different kind */
+		if (two == str2)
+			return isnum ? 1 : -1;
+
+		/* ignore leading zeros, then the longer number is larger */
+		if (isnum) {
+			while (*one == '0' && one + 1 < str1)
+				one++;
+			while (*two == '0' && two + 1 < str2)
+				two++;
+			if (str1 - one != str2 - two)
+				return str1 - one < str2 - two ? -1 : 1;
+		}
+		len1 = str1 - one;
+		len2 = str2 - two;
+		rc = strncmp(one, two, MIN(len1, len2));
+		if (rc != 0)
+			return rc < 0 ? -1 : 1;
+		if (len1 != len2)
+			return len1 < len2 ? -1 : 1;
+		one = str1;
+		two = str2;
+	}
+
+	/* whichever version has segments left over is newer */
+	if (*one == '\0' && *two == '\0')
+		return 0;
+	return *one != '\0' ? 1 : -1;
+}
+
+/* private: packs versions like `1:2.3.4` into a key that sorts in the same
+ * order as xb_string_vercmp(), using 4 bits for the epoch and 15 bits for each
+ * of up to four numeric segments, where zero means the segment is missing */
+gboolean
+xb_string_version_key(const gchar *version, guint64 *key)
+{
+	const gchar *tmp = version;
+	guint64 epoch;
+	guint64 val = 0;
+	guint segments = 0;
+
+	if (version == NULL || version[0] == '\0')
+		return FALSE;
+	epoch = xb_string_version_epoch(&tmp);
+	if (epoch > 0xf)
+		return FALSE;
+	while (TRUE) {
+		guint64 segment = 0;
+		const gchar *start = tmp;
+
+		while (g_ascii_isdigit(*tmp)) {
+			segment = segment * 10 + (*tmp - '0');
+			if (segment >= 0x7fff)
+				return FALSE;
+			tmp++;
+		}
+		if (tmp == start || segments == 4)
+			return FALSE;
+		val |= (segment + 1) << (15 * (3 - segments));
+		segments++;
+		if (*tmp == '\0')
+			break;
+		if (*tmp != '.')
+			return FALSE;
+		tmp++;
+	}
+	*key = (epoch << 60) | val;
+	return TRUE;
+}
+
+#ifdef HAVE_LIBSTEMMER
+static void
+xb_string_stemmer_free(struct sb_stemmer *stemmer)
+{
+	if (stemmer != NULL)
+		sb_stemmer_delete(stemmer);
+}
+
+static void
+xb_string_stemmers_free(GHashTable *stemmers)
+{
+	g_hash_table_unref(stemmers);
+}
+
+/* a stemmer cannot be shared between threads, so each thread has its own for
+ * each language, which are freed when the thread exits */
+static GPrivate xb_string_stemmers = G_PRIVATE_INIT((GDestroyNotify)xb_string_stemmers_free);
+
+static struct sb_stemmer *
+xb_string_get_stemmer(const gchar *lang)
+{
+	GHashTable *stemmers = g_private_get(&xb_string_stemmers);
+	struct sb_stemmer *stemmer = NULL;
+	g_autofree gchar *lang_short = NULL;
+
+	/* only the language is used, e.g. `pt` from `pt_BR.UTF-8` */
+	if (lang == NULL || g_strcmp0(lang, "C") == 0 || g_strcmp0(lang, "POSIX") == 0)
+		lang = "en";
+	lang_short = g_ascii_strdown(lang, strcspn(lang, "_-.@"));
+
+	if (stemmers == NULL) {
+		stemmers = g_hash_table_new_full(g_str_hash,
+						 g_str_equal,
+						 g_free,
+						 (GDestroyNotify)xb_string_stemmer_free);
+		g_private_set(&xb_string_stemmers, stemmers);
+	}
+
+	/* languages without a stemmer are also remembered */
+	if (g_hash_table_lookup_extended(stemmers, lang_short, NULL, (gpointer *)&stemmer))
+		return stemmer;
+	stemmer = sb_stemmer_new(lang_short, NULL);
+	g_hash_table_insert(stemmers, g_steal_pointer(&lang_short), stemmer);
+	return stemmer;
+}
+#endif
+
+/* private: case-folds @value and removes any suffix, e.g. `gimping` to `gimp`,
+ * using the rules for @lang, or English if %NULL */
+gchar *
+xb_string_stem(const gchar *value, const gchar *lang)
+{
+#ifdef HAVE_LIBSTEMMER
+	struct sb_stemmer *stemmer = xb_string_get_stemmer(lang);
+	const gchar *tmp;
+	gsize len_dst;
+	gsize len_src;
+	g_autofree gchar *value_casefold = g_utf8_casefold(value, -1);
+
+	/* no stemmer for this language */
+	if (stemmer == NULL)
+		return g_steal_pointer(&value_casefold);
+
+	/* stem */
+	len_src = strlen(value_casefold);
+	tmp = (const gchar *)sb_stemmer_stem(stemmer, (guchar *)value_casefold, (gint)len_src);
+	if (tmp == NULL)
+		return g_steal_pointer(&value_casefold);
+	len_dst = (gsize)sb_stemmer_length(stemmer);
+	if (len_src == len_dst)
+		return g_steal_pointer(&value_casefold);
+	return g_strndup(tmp, len_dst);
+#else
+	return g_utf8_casefold(value, -1);
+#endif
+}
+
 void
 xb_guid_compute_for_data(XbGuid *out, const guint8 *buf, gsize bufsz)
 {
@@ -10,7 +10,11 @@
 
 #include "xb-silo.h"
 
+typedef struct _XbValueBindingsSet XbValueBindingsSet;
+
 gchar *
 xb_value_bindings_to_string(XbValueBindings *self);
 gboolean
+xb_value_bindings_set_contains(XbValueBindingsSet *set, XbOpcode *op);
+gboolean
 xb_value_bindings_indexed_text_lookup(XbValueBindings *self, XbSilo *silo, GError **error);
@@ -14,14 +14,15 @@
 
 #include <glib.h>
 
+#include "xb-common-private.h"
 #include "xb-opcode-private.h"
 #include "xb-silo-private.h"
 #include "xb-value-bindings-private.h"
 
 typedef struct {
 	guint8 kind; /* XbBoundValueKind */
-	guint32 val;
-	gpointer ptr;
+	guint32 val; /* the low 32 bits of integers */
+	gpointer ptr; /* the high 32 bits of integers, using GUINT_TO_POINTER() */
 	GDestroyNotify destroy_func;
 } XbBoundValue;
 
@@ -30,8 +31,16 @@ typedef enum {
 	XB_BOUND_VALUE_KIND_TEXT,
 	XB_BOUND_VALUE_KIND_INTEGER,
 	XB_BOUND_VALUE_KIND_INDEXED_TEXT,
+	XB_BOUND_VALUE_KIND_SET,
 } XbBoundValueKind;
 
+/* shared between copies of the bindings, as these can be large */
+struct _XbValueBindingsSet {
+	gint ref_count;
+	GHashTable *strs; /* (nullable): of utf8 for a set of strings */
+	GHashTable *vals; /* (nullable): of guint32, or the strtab offsets of @strs */
+};
+
 typedef struct {
 	/* Currently limited to 4 values since that’s all that any client
 	 * uses. This could be expanded to dynamically allow more in future. */
@@ -44,6 +53,60 @@ G_DEFINE_BOXED_TYPE(XbValueBindings,
 		    xb_value_bindings_copy,
 		    xb_value_bindings_free)
 
+static guint64
+xb_bound_value_get_val64(const XbBoundValue *value)
+{
+	return ((guint64)GPOINTER_TO_UINT(value->ptr) << 32) | value->val;
+}
+
+static XbValueBindingsSet *
+xb_value_bindings_set_ref(XbValueBindingsSet *set)
+{
+	g_atomic_int_inc(&set->ref_count);
+	return set;
+}
+
+static void
+xb_value_bindings_set_unref(XbValueBindingsSet *set)
+{
+	if (!g_atomic_int_dec_and_test(&set->ref_count))
+		return;
+	if (set->strs != NULL)
+		g_hash_table_unref(set->strs);
+	if (set->vals != NULL)
+		g_hash_table_unref(set->vals);
+	g_free(set);
+}
+
+/* private */
+gboolean
+xb_value_bindings_set_contains(XbValueBindingsSet *set, XbOpcode *op)
+{
+	XbOpcodeKind kind = _xb_opcode_get_kind(op);
+	const gchar *str = _xb_opcode_get_str(op);
+
+	/* integers, comparing text as a number */
+	if (set->strs == NULL) {
+		guint64 val = 0;
+		if (kind == XB_OPCODE_KIND_INTEGER || kind == XB_OPCODE_KIND_BOUND_INTEGER)
+			val = _xb_opcode_get_val64(op);
+		else if (str == NULL ||
+			 !g_ascii_string_to_unsigned(str, 10, 0, G_MAXUINT32, &val, NULL))
+			return FALSE;
+		if (val > G_MAXUINT32)
+			return FALSE;
+		return g_hash_table_contains(set->vals, GUINT_TO_POINTER(val));
+	}
+
+	/* strings, using the strtab offset if possible */
+	if (set->vals != NULL &&
+	    (kind == XB_OPCODE_KIND_INDEXED_TEXT || kind == XB_OPCODE_KIND_BOUND_INDEXED_TEXT))
+		return g_hash_table_contains(set->vals, GUINT_TO_POINTER(_xb_opcode_get_val(op)));
+	if (!_xb_opcode_cmp_str(op) || str == NULL)
+		return FALSE;
+	return g_hash_table_contains(set->strs, str);
+}
+
 /**
  * xb_value_bindings_init:
  * @self: an uninitialised #XbValueBindings to initialise
@@ -113,7 +176,10 @@ xb_value_bindings_to_string(XbValueBindings *self)
 		if (str->len > 0)
 			g_string_append(str, ", ");
 		if (value->kind == XB_BOUND_VALUE_KIND_INTEGER)
-			g_string_append_printf(str, "?%u → %u", i, value->val);
+			g_string_append_printf(str,
+					       "?%u → %" G_GUINT64_FORMAT,
+					       i,
+					       xb_bound_value_get_val64(value));
 		else if (value->kind == XB_BOUND_VALUE_KIND_TEXT && value->val > 0)
 			g_string_append_printf(str,
 					       "?%u → %s [%u]",
@@ -122,6 +188,8 @@ xb_value_bindings_to_string(XbValueBindings *self)
 					       value->val);
 		else if (value->kind == XB_BOUND_VALUE_KIND_TEXT)
 			g_string_append_printf(str, "?%u → %s", i, (const gchar *)value->ptr);
+		else if (value->kind == XB_BOUND_VALUE_KIND_SET)
+			g_string_append_printf(str, "?%u → {%u}", i, value->val);
 	}
 	return g_string_free(g_steal_pointer(&str), FALSE);
 }
@@ -244,6 +312,25 @@ xb_value_bindings_bind_str(XbValueBindings *self,
  */
 void
 xb_value_bindings_bind_val(XbValueBindings *self, guint idx, guint32 val)
+{
+	xb_value_bindings_bind_val64(self, idx, val);
+}
+
+/**
+ * xb_value_bindings_bind_val64:
+ * @self: an #XbValueBindings
+ * @idx: 0-based index to bind to
+ * @val: a 64 bit integer to bind to @idx
+ *
+ * Bind @val to @idx in the value bindings, for values such as timestamps or
+ * sizes that do not fit in 32 bits.
+ *
+ * This will overwrite any previous binding at @idx.
+ *
+ * Since: 0.3.12
+ */
+void
+xb_value_bindings_bind_val64(XbValueBindings *self, guint idx, guint64 val)
 {
 	RealValueBindings *_self = (RealValueBindings *)self;
 
@@ -256,10 +343,91 @@ xb_value_bindings_bind_val(XbValueBindings *self, guint idx, guint32 val)
 	xb_value_bindings_clear_index(self, idx);
 
 	_self->values[idx].kind = XB_BOUND_VALUE_KIND_INTEGER;
-	_self->values[idx].val = val;
+	_self->values[idx].val = val & G_MAXUINT32;
+	_self->values[idx].ptr = GUINT_TO_POINTER(val >> 32);
 	_self->values[idx].destroy_func = NULL;
 }
 
+static void
+xb_value_bindings_bind_set_internal(XbValueBindings *self, guint idx, XbValueBindingsSet *set)
+{
+	RealValueBindings *_self = (RealValueBindings *)self;
+
+	xb_value_bindings_clear_index(self, idx);
+
+	_self->values[idx].kind = XB_BOUND_VALUE_KIND_SET;
+	_self->values[idx].val = g_hash_table_size(set->strs != NULL ? set->strs : set->vals);
+	_self->values[idx].ptr = set;
+	_self->values[idx].destroy_func = (GDestroyNotify)xb_value_bindings_set_unref;
+}
+
+/**
+ * xb_value_bindings_bind_set:
+ * @self: an #XbValueBindings
+ * @idx: 0-based index to bind to
+ * @values: (array zero-terminated=1): strings to bind to @idx
+ *
+ * Bind a set of strings to @idx in the value bindings, for instance to match
+ * any of thousands of IDs using `id[text()=?]` in a single query.
+ *
+ * The strings are copied into a hash table, so checking if a node value is in
+ * the set does not depend on the number of values. If %XB_QUERY_FLAG_USE_INDEXES
+ * is used then the strings are also converted to string table offsets.
+ *
+ * This will overwrite any previous binding at @idx.
+ *
+ * Since: 0.3.12
+ */
+void
+xb_value_bindings_bind_set(XbValueBindings *self, guint idx, const gchar *const *values)
+{
+	RealValueBindings *_self = (RealValueBindings *)self;
+	XbValueBindingsSet *set;
+
+	g_return_if_fail(self != NULL);
+	g_return_if_fail(values != NULL);
+	g_return_if_fail(idx < G_N_ELEMENTS(_self->values));
+
+	set = g_new0(XbValueBindingsSet, 1);
+	set->ref_count = 1;
+	set->strs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	for (guint i = 0; values[i] != NULL; i++)
+		g_hash_table_add(set->strs, g_strdup(values[i]));
+	xb_value_bindings_bind_set_internal(self, idx, set);
+}
+
+/**
+ * xb_value_bindings_bind_set_val:
+ * @self: an #XbValueBindings
+ * @idx: 0-based index to bind to
+ * @vals: (array length=n_vals): integers to bind to @idx
+ * @n_vals: number of integers in @vals
+ *
+ * Bind a set of integers to @idx in the value bindings. Text values are
+ * converted to integers when checking if they are in the set.
+ *
+ * This will overwrite any previous binding at @idx.
+ *
+ * Since: 0.3.12
+ */
+void
+xb_value_bindings_bind_set_val(XbValueBindings *self, guint idx, const guint32 *vals, gsize n_vals)
+{
+	RealValueBindings *_self = (RealValueBindings *)self;
+	XbValueBindingsSet *set;
+
+	g_return_if_fail(self != NULL);
+	g_return_if_fail(vals != NULL || n_vals == 0);
+	g_return_if_fail(idx < G_N_ELEMENTS(_self->values));
+
+	set = g_new0(XbValueBindingsSet, 1);
+	set->ref_count = 1;
+	set->vals = g_hash_table_new(g_direct_hash, g_direct_equal);
+	for (gsize i = 0; i < n_vals; i++)
+		g_hash_table_add(set->vals, GUINT_TO_POINTER(vals[i]));
+	xb_value_bindings_bind_set_internal(self, idx, set);
+}
+
 /**
  * xb_value_bindings_lookup_opcode:
  * @self: an #XbValueBindings
@@ -294,15 +462,19 @@ xb_value_bindings_lookup_opcode(XbValueBindings *self, guint idx, XbOpcode *opco
 			       NULL);
 		break;
 	case XB_BOUND_VALUE_KIND_INTEGER:
+		xb_opcode_init(opcode_out, XB_OPCODE_KIND_BOUND_INTEGER, NULL, 0, NULL);
+		xb_opcode_set_val64(opcode_out, xb_bound_value_get_val64(&_self->values[idx]));
+		break;
+	case XB_BOUND_VALUE_KIND_INDEXED_TEXT:
 		xb_opcode_init(opcode_out,
-			       XB_OPCODE_KIND_BOUND_INTEGER,
-			       NULL,
+			       XB_OPCODE_KIND_BOUND_INDEXED_TEXT,
+			       _self->values[idx].ptr,
 			       _self->values[idx].val,
 			       NULL);
 		break;
-	case XB_BOUND_VALUE_KIND_INDEXED_TEXT:
+	case XB_BOUND_VALUE_KIND_SET:
 		xb_opcode_init(opcode_out,
-			       XB_OPCODE_KIND_BOUND_INDEXED_TEXT,
+			       XB_OPCODE_KIND_BOUND_SET,
 			       _self->values[idx].ptr,
 			       _self->values[idx].val,
 			       NULL);
@@ -348,12 +520,20 @@ xb_value_bindings_copy_binding(XbValueBindings *self,
 		xb_value_bindings_bind_str(dest, dest_idx, _self->values[idx].ptr, NULL);
 		break;
 	case XB_BOUND_VALUE_KIND_INTEGER:
-		xb_value_bindings_bind_val(dest, dest_idx, _self->values[idx].val);
+		xb_value_bindings_bind_val64(dest,
+					     dest_idx,
+					     xb_bound_value_get_val64(&_self->values[idx]));
 		break;
 	case XB_BOUND_VALUE_KIND_INDEXED_TEXT:
 		xb_value_bindings_bind_str(dest, dest_idx, _self->values[idx].ptr, NULL);
-		_dest->values[idx].kind = XB_BOUND_VALUE_KIND_INDEXED_TEXT;
-		_dest->values[idx].val = _self->values[idx].val;
+		_dest->values[dest_idx].kind = XB_BOUND_VALUE_KIND_INDEXED_TEXT;
+		_dest->values[dest_idx].val = _self->values[idx].val;
+		break;
+	case XB_BOUND_VALUE_KIND_SET:
+		xb_value_bindings_bind_set_internal(
+		    dest,
+		    dest_idx,
+		    xb_value_bindings_set_ref(_self->values[idx].ptr));
 		break;
 	case XB_BOUND_VALUE_KIND_NONE:
 	default:
@@ -368,6 +548,9 @@ gboolean
 xb_value_bindings_indexed_text_lookup(XbValueBindings *self, XbSilo *silo, GError **error)
 {
 	RealValueBindings *_self = (RealValueBindings *)self;
+	gboolean sorted =
+	    xb_silo_get_section(silo, XB_SILO_SECTION_KIND_STRTAB_SORTED, NULL) != NULL;
+
 	for (guint i = 0; i < G_N_ELEMENTS(_self->values); i++) {
 		XbBoundValue *value = &_self->values[i];
 		if (value->kind == XB_BOUND_VALUE_KIND_TEXT) {
@@ -382,6 +565,28 @@ xb_value_bindings_indexed_text_lookup(XbValueBindings *self, XbSilo *silo, GErro
 			}
 			value->kind = XB_BOUND_VALUE_KIND_INDEXED_TEXT;
 			value->val = val;
+		} else if (value->kind == XB_BOUND_VALUE_KIND_SET) {
+			XbValueBindingsSet *set = value->ptr;
+			XbValueBindingsSet *set_new;
+			GHashTableIter iter;
+			gpointer key;
+
+			/* the offsets can only be found using the sorted strtab */
+			if (set->strs == NULL || !sorted)
+				continue;
+
+			/* a new set, as the old one may be shared with other bindings */
+			set_new = g_new0(XbValueBindingsSet, 1);
+			set_new->ref_count = 1;
+			set_new->strs = g_hash_table_ref(set->strs);
+			set_new->vals = g_hash_table_new(g_direct_hash, g_direct_equal);
+			g_hash_table_iter_init(&iter, set->strs);
+			while (g_hash_table_iter_next(&iter, &key, NULL)) {
+				guint32 val = xb_silo_strtab_find(silo, key);
+				if (val != XB_SILO_UNSET)
+					g_hash_table_add(set_new->vals, GUINT_TO_POINTER(val));
+			}
+			xb_value_bindings_bind_set_internal(self, i, set_new);
 		}
 	}
 	return TRUE;
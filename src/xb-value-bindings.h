@@ -89,6 +89,12 @@ xb_value_bindings_bind_str(XbValueBindings *self,
 			   GDestroyNotify destroy_func);
 void
 xb_value_bindings_bind_val(XbValueBindings *self, guint idx, guint32 val);
+void
+xb_value_bindings_bind_val64(XbValueBindings *self, guint idx, guint64 val);
+void
+xb_value_bindings_bind_set(XbValueBindings *self, guint idx, const gchar *const *values);
+void
+xb_value_bindings_bind_set_val(XbValueBindings *self, guint idx, const guint32 *vals, gsize n_vals);
 
 gboolean
 xb_value_bindings_lookup_opcode(XbValueBindings *self, guint idx, XbOpcode *opcode_out);